@@ -3,8 +3,13 @@
 
 #include <algorithm>
 #include <array>
+#include <cstring>
 #include <iterator>
+#include <limits>
+#include <string_view>
 #include <tuple>
+#include <type_traits>
+#include <utility>
 #include <variant>
 
 namespace cpp_box::arm {
@@ -117,6 +122,7 @@ struct Instruction : Strongly_Typed<std::uint32_t, Instruction>
   friend struct Multiply_Long;
   friend struct Branch;
   friend struct Load_And_Store_Multiple;
+  friend struct Single_Data_Swap;
 };
 
 struct Single_Data_Transfer : Strongly_Typed<std::uint32_t, Single_Data_Transfer>
@@ -134,7 +140,7 @@ struct Single_Data_Transfer : Strongly_Typed<std::uint32_t, Single_Data_Transfer
   [[nodiscard]] constexpr auto offset_register() const noexcept { return offset() & 0b1111; }
   [[nodiscard]] constexpr auto offset_shift() const noexcept { return offset() >> 4; }
   [[nodiscard]] constexpr auto offset_shift_type() const noexcept { return static_cast<Shift_Type>((offset_shift() >> 1) & 0b11); }
-  [[nodiscard]] constexpr auto offset_shift_amount() const noexcept { return offset_shift() >> 4; }
+  [[nodiscard]] constexpr auto offset_shift_amount() const noexcept { return offset_shift() >> 3; }
 
   constexpr explicit Single_Data_Transfer(Instruction ins) noexcept : Strongly_Typed{ ins.m_val } {}
 };
@@ -153,6 +159,17 @@ struct Load_And_Store_Multiple : Strongly_Typed<std::uint32_t, Load_And_Store_Mu
   constexpr explicit Load_And_Store_Multiple(Instruction ins) noexcept : Strongly_Typed{ ins.m_val } {}
 };
 
+struct Single_Data_Swap : Strongly_Typed<std::uint32_t, Single_Data_Swap>
+{
+  [[nodiscard]] constexpr bool byte_transfer() const noexcept { return test_bit(22); }
+
+  [[nodiscard]] constexpr auto base_register() const noexcept { return (m_val >> 16) & 0b1111; }
+  [[nodiscard]] constexpr auto destination_register() const noexcept { return (m_val >> 12) & 0b1111; }
+  [[nodiscard]] constexpr auto source_register() const noexcept { return m_val & 0b1111; }
+
+  constexpr explicit Single_Data_Swap(Instruction ins) noexcept : Strongly_Typed{ ins.m_val } {}
+};
+
 struct Multiply_Long : Strongly_Typed<std::uint32_t, Multiply_Long>
 {
   [[nodiscard]] constexpr bool unsigned_mul() const noexcept { return test_bit(22); }
@@ -239,7 +256,8 @@ enum class Instruction_Type {
   Coprocessor_Data_Operation,
   Coprocessor_Register_Transfer,
   Software_Interrupt,
-  Load_And_Store_Multiple
+  Load_And_Store_Multiple,
+  Breakpoint  // never decoded, marks a cached instruction that has a breakpoint armed on it
 };
 
 struct Lookup_Table
@@ -298,6 +316,123 @@ struct Lookup_Table
   return table;
 }
 
+// RAM_Type customization points, detected so that plain std::array / std::vector RAM keeps working
+
+// contiguous storage can be bulk copied into
+template<typename RAM_Type, typename = void> struct has_contiguous_storage : std::false_type
+{
+};
+template<typename RAM_Type>
+struct has_contiguous_storage<RAM_Type, std::void_t<decltype(std::declval<RAM_Type &>().data())>> : std::true_type
+{
+};
+template<typename RAM_Type> constexpr bool has_contiguous_storage_v = has_contiguous_storage<RAM_Type>::value;
+
+// storage that can reference an image in place, via `attach(image, address)`, which returns
+// how many bytes of the image fit in RAM
+template<typename RAM_Type, typename Image, typename = void> struct can_attach_image : std::false_type
+{
+};
+template<typename RAM_Type, typename Image>
+struct can_attach_image<RAM_Type,
+                        Image,
+                        std::void_t<decltype(std::declval<RAM_Type &>().attach(std::declval<const Image &>(), std::uint32_t{}))>>
+  : std::true_type
+{
+};
+template<typename RAM_Type, typename Image> constexpr bool can_attach_image_v = can_attach_image<RAM_Type, Image>::value;
+
+// storage that can hand out an already decoded Instruction_Type, via `predecoded(loc)`
+template<typename RAM_Type, typename = void> struct has_predecoded : std::false_type
+{
+};
+template<typename RAM_Type>
+struct has_predecoded<RAM_Type, std::void_t<decltype(std::declval<const RAM_Type &>().predecoded(std::uint32_t{}))>> : std::true_type
+{
+};
+template<typename RAM_Type> constexpr bool has_predecoded_v = has_predecoded<RAM_Type>::value;
+
+// storage that can swap memory atomically with respect to other users of the same memory,
+// via `exchange_word(loc, value)` / `exchange_byte(loc, value)`
+template<typename RAM_Type, typename = void> struct has_atomic_exchange : std::false_type
+{
+};
+template<typename RAM_Type>
+struct has_atomic_exchange<RAM_Type,
+                           std::void_t<decltype(std::declval<RAM_Type &>().exchange_word(std::uint32_t{}, std::uint32_t{})),
+                                       decltype(std::declval<RAM_Type &>().exchange_byte(std::uint32_t{}, std::uint8_t{}))>>
+  : std::true_type
+{
+};
+template<typename RAM_Type> constexpr bool has_atomic_exchange_v = has_atomic_exchange<RAM_Type>::value;
+
+// storage that handles word and half word accesses itself, via `read_word(loc)` /
+// `write_word(loc, value)` and the half word equivalents, eg so that another core can't see
+// an aligned store half done
+template<typename RAM_Type, typename = void> struct has_word_access : std::false_type
+{
+};
+template<typename RAM_Type>
+struct has_word_access<RAM_Type,
+                       std::void_t<decltype(std::declval<const RAM_Type &>().read_word(std::uint32_t{})),
+                                   decltype(std::declval<const RAM_Type &>().read_half_word(std::uint32_t{})),
+                                   decltype(std::declval<RAM_Type &>().write_word(std::uint32_t{}, std::uint32_t{})),
+                                   decltype(std::declval<RAM_Type &>().write_half_word(std::uint32_t{}, std::uint16_t{}))>>
+  : std::true_type
+{
+};
+template<typename RAM_Type> constexpr bool has_word_access_v = has_word_access<RAM_Type>::value;
+
+enum class Stop_Reason {
+  Exited,                 // returned from the entry point
+  Budget_Exhausted,       // executed the requested number of instructions
+  Unhandled_Instruction,  // hit an instruction the emulator does not implement
+  Breakpoint,             // about to execute an instruction with a breakpoint armed on it
+  Watchpoint,             // a memory hook stopped the run after an access it watches
+};
+
+[[nodiscard]] constexpr std::string_view to_string(const Stop_Reason reason) noexcept
+{
+  switch (reason) {
+  case Stop_Reason::Exited: return "exited";
+  case Stop_Reason::Budget_Exhausted: return "budget_exhausted";
+  case Stop_Reason::Unhandled_Instruction: return "unhandled_instruction";
+  case Stop_Reason::Breakpoint: return "breakpoint";
+  case Stop_Reason::Watchpoint: return "watchpoint";
+  }
+  return "unknown";
+}
+
+[[nodiscard]] constexpr std::string_view to_string(const Instruction_Type type) noexcept
+{
+  switch (type) {
+  case Instruction_Type::Data_Processing: return "data_processing";
+  case Instruction_Type::MRS: return "mrs";
+  case Instruction_Type::MSR: return "msr";
+  case Instruction_Type::MSRF: return "msrf";
+  case Instruction_Type::Multiply: return "multiply";
+  case Instruction_Type::Multiply_Long: return "multiply_long";
+  case Instruction_Type::Single_Data_Swap: return "single_data_swap";
+  case Instruction_Type::Single_Data_Transfer: return "single_data_transfer";
+  case Instruction_Type::Undefined: return "undefined";
+  case Instruction_Type::Block_Data_Transfer: return "block_data_transfer";
+  case Instruction_Type::Branch: return "branch";
+  case Instruction_Type::Coprocessor_Data_Transfer: return "coprocessor_data_transfer";
+  case Instruction_Type::Coprocessor_Data_Operation: return "coprocessor_data_operation";
+  case Instruction_Type::Coprocessor_Register_Transfer: return "coprocessor_register_transfer";
+  case Instruction_Type::Software_Interrupt: return "software_interrupt";
+  case Instruction_Type::Load_And_Store_Multiple: return "load_and_store_multiple";
+  case Instruction_Type::Breakpoint: return "breakpoint";
+  }
+  return "unknown";
+}
+
+struct Run_Result
+{
+  Stop_Reason reason;
+  std::uint64_t instructions;
+};
+
 struct NO_MMIO
 {
   [[nodiscard]] constexpr bool is_mmio_range([[maybe_unused]] const std::uint32_t loc) const noexcept { return false; }
@@ -306,12 +441,125 @@ struct NO_MMIO
   [[nodiscard]] constexpr std::uint8_t read_byte([[maybe_unused]] const std::uint32_t loc) const noexcept { return 0; }
 };
 
-template<std::size_t RAM_Size = 1024, typename RAM_Type = std::array<std::uint8_t, RAM_Size>, typename MMIO_Callback = NO_MMIO> struct System
+// Timing policy, told about every instruction executed so that it can model how long it would
+// have taken on real hardware. See timing.hpp for the ARM7TDMI model; this one compiles away.
+struct NO_TIMING
+{
+  constexpr void condition_failed() noexcept {}
+  constexpr void data_processing([[maybe_unused]] const bool shift_by_register, [[maybe_unused]] const bool writes_pc) noexcept {}
+  constexpr void branch() noexcept {}
+  constexpr void single_data_transfer([[maybe_unused]] const bool load, [[maybe_unused]] const bool writes_pc) noexcept {}
+  constexpr void block_data_transfer([[maybe_unused]] const bool load,
+                                     [[maybe_unused]] const std::uint32_t register_count,
+                                     [[maybe_unused]] const bool writes_pc) noexcept
+  {
+  }
+  constexpr void single_data_swap() noexcept {}
+  constexpr void multiply_long([[maybe_unused]] const bool accumulate,
+                               [[maybe_unused]] const bool unsigned_mul,
+                               [[maybe_unused]] const std::uint32_t multiplier) noexcept
+  {
+  }
+};
+
+// Memory hooks policy, seeing the loads and stores made by guest instructions. Reads by the
+// I-cache or anything inspecting the System from outside don't count. `read` / `write` are only
+// called for locations `is_hooked` returns true for, this one compiles away entirely. Stores only
+// read back what they overwrite for policies that set `wants_old_value`, the others get 0. So do
+// stores to MMIO, reading a device back would consume its data.
+struct NO_MEMORY_HOOKS
+{
+  static constexpr bool wants_old_value = false;
+
+  [[nodiscard]] constexpr bool is_hooked([[maybe_unused]] const std::uint32_t loc) const noexcept { return false; }
+
+  template<typename System>
+  constexpr void read([[maybe_unused]] System &sys,
+                      [[maybe_unused]] const std::uint32_t loc,
+                      [[maybe_unused]] const std::uint32_t size,
+                      [[maybe_unused]] const std::uint32_t value) noexcept
+  {
+  }
+
+  template<typename System>
+  constexpr void write([[maybe_unused]] System &sys,
+                       [[maybe_unused]] const std::uint32_t loc,
+                       [[maybe_unused]] const std::uint32_t size,
+                       [[maybe_unused]] const std::uint32_t old_value,
+                       [[maybe_unused]] const std::uint32_t new_value) noexcept
+  {
+  }
+};
+
+// Memory hooks policy made of several others, each of which is still only called for the
+// locations it hooks itself. Their own members stay reachable through inheritance.
+template<typename... Hooks> struct Memory_Hooks_Set : Hooks...
+{
+  static constexpr bool wants_old_value = (Hooks::wants_old_value || ...);
+
+  [[nodiscard]] constexpr bool is_hooked(const std::uint32_t loc) const noexcept { return (Hooks::is_hooked(loc) || ...); }
+
+  template<typename System> constexpr void read(System &sys, const std::uint32_t loc, const std::uint32_t size, const std::uint32_t value) noexcept
+  {
+    ((Hooks::is_hooked(loc) ? Hooks::read(sys, loc, size, value) : void()), ...);
+  }
+
+  template<typename System>
+  constexpr void
+    write(System &sys, const std::uint32_t loc, const std::uint32_t size, const std::uint32_t old_value, const std::uint32_t new_value) noexcept
+  {
+    ((Hooks::is_hooked(loc) ? Hooks::write(sys, loc, size, old_value, new_value) : void()), ...);
+  }
+};
+
+// Statistics policy, counting what the emulator itself spends its time on rather than what the
+// guest does. Instructions are counted as they're dispatched, cache hits are worked out from the
+// fetches each run_for reports once it's done. This one compiles away, see stats.hpp for a real one.
+struct NO_STATS
+{
+  constexpr void run_slice([[maybe_unused]] const std::uint64_t fetches) noexcept {}
+  constexpr void instruction([[maybe_unused]] const Instruction_Type type) noexcept {}
+  constexpr void cache_miss() noexcept {}
+  constexpr void cache_refill() noexcept {}
+  constexpr void mmio_read([[maybe_unused]] const std::uint32_t loc) noexcept {}
+  constexpr void invalid_write([[maybe_unused]] const std::uint32_t loc) noexcept {}
+};
+
+// Tracing policy for next_operation / run_for / run, called with the System, PC and instruction
+// before every instruction executes. This one compiles away, see trace.hpp for a real one.
+struct NO_TRACER
+{
+  template<typename System>
+  constexpr void operator()([[maybe_unused]] const System &sys, [[maybe_unused]] const std::uint32_t pc, [[maybe_unused]] const Instruction ins) const
+    noexcept
+  {
+  }
+};
+
+template<std::size_t RAM_Size    = 1024,
+         typename RAM_Type      = std::array<std::uint8_t, RAM_Size>,
+         typename MMIO_Callback = NO_MMIO,
+         typename Timing        = NO_TIMING,
+         typename Memory_Hooks  = NO_MEMORY_HOOKS,
+         typename Stats         = NO_STATS>
+struct System
 {
   std::uint32_t CSPR{};
 
   std::array<std::uint32_t, 16> registers{};
   bool invalid_memory_write{ false };
+  Stop_Reason stop_reason{ Stop_Reason::Exited };
+
+  static constexpr std::size_t max_breakpoints = 32;
+
+  // only looked at when the I-cache is filled, see `add_breakpoint`
+  std::array<std::uint32_t, max_breakpoints> breakpoints{};
+  std::size_t breakpoint_count{ 0 };
+
+  // the breakpoint we stopped in front of, so that continuing from there executes the instruction
+  // instead of stopping again. Never an instruction address when there's nothing to step over.
+  static constexpr std::uint32_t not_resuming = 0xFFFF'FFFF;
+  std::uint32_t resume_pc{ not_resuming };
 
   [[nodiscard]] constexpr auto &SP() noexcept { return registers[13]; }
   [[nodiscard]] constexpr const auto &SP() const noexcept { return registers[13]; }
@@ -345,14 +593,69 @@ template<std::size_t RAM_Size = 1024, typename RAM_Type = std::array<std::uint8_
 
   RAM_Type builtin_ram{ init_ram(builtin_ram) };  // just passing ourselves in to resolve the type
   MMIO_Callback mmio_callback{};
+  Timing timing{};
+  Memory_Hooks memory_hooks{};
+  // mutable, MMIO reads and I-cache refills happen through const member functions
+  mutable Stats stats{};
+
+  constexpr void unhandled_instruction([[maybe_unused]] const Instruction ins, [[maybe_unused]] const Instruction_Type type) noexcept
+  {
+    stop(Stop_Reason::Unhandled_Instruction);
+  }
+
+  // ends the current run_for / run after the instruction being executed
+  constexpr void stop(const Stop_Reason reason) noexcept
+  {
+    stop_reason            = reason;
+    instructions_remaining = 0;
+  }
+
+  // Stops run_for / run in front of the instruction at `address`. Breakpoints are marked in the
+  // I-cache as it is filled, so with none armed executing an instruction costs nothing extra.
+  // Returns false if max_breakpoints are already armed.
+  constexpr bool add_breakpoint(const std::uint32_t address) noexcept
+  {
+    if (has_breakpoint(address)) { return true; }
+    if (breakpoint_count == breakpoints.size()) { return false; }
+
+    breakpoints[breakpoint_count++] = address;
+    i_cache.fill_cache(*this);
+    return true;
+  }
+
+  constexpr void remove_breakpoint(const std::uint32_t address) noexcept
+  {
+    for (std::size_t idx = 0; idx < breakpoint_count; ++idx) {
+      if (breakpoints[idx] == address) {
+        breakpoints[idx] = breakpoints[--breakpoint_count];
+        i_cache.fill_cache(*this);
+        return;
+      }
+    }
+  }
+
+  constexpr void clear_breakpoints() noexcept
+  {
+    breakpoint_count = 0;
+    i_cache.fill_cache(*this);
+  }
 
-  constexpr void unhandled_instruction([[maybe_unused]] const Instruction ins, [[maybe_unused]] const Instruction_Type type) { abort(); }
+  [[nodiscard]] constexpr bool has_breakpoint(const std::uint32_t address) const noexcept
+  {
+    for (std::size_t idx = 0; idx < breakpoint_count; ++idx) {
+      if (breakpoints[idx] == address) { return true; }
+    }
+    return false;
+  }
 
 
   // read past end of allocated memory will return an unspecified value
   [[nodiscard]] constexpr std::uint8_t read_byte(const std::uint32_t loc) const noexcept
   {
-    if (mmio_callback.is_mmio_range(loc)) { return mmio_callback.read_byte(loc); }
+    if (mmio_callback.is_mmio_range(loc)) {
+      stats.mmio_read(loc);
+      return mmio_callback.read_byte(loc);
+    }
 
     if (loc < RAM_Size) {
       return builtin_ram[loc];
@@ -367,22 +670,24 @@ template<std::size_t RAM_Size = 1024, typename RAM_Type = std::array<std::uint8_
       builtin_ram[loc] = value;
     } else {
       invalid_memory_write = true;
+      stats.invalid_write(loc);
     }
   }
 
   // read past end of allocated memory will return an unspecified value
   [[nodiscard]] constexpr std::uint16_t read_half_word(const std::uint32_t loc) const noexcept
   {
-    if (mmio_callback.is_mmio_range(loc)) { return mmio_callback.read_half_word(loc); }
+    if (mmio_callback.is_mmio_range(loc)) {
+      stats.mmio_read(loc);
+      return mmio_callback.read_half_word(loc);
+    }
 
-    const std::uint8_t *data = [&]() -> const std::uint8_t * {
-      if (loc + 1 < RAM_Size) { return &builtin_ram[loc]; }
-      return nullptr;
-    }();
+    // bytes are indexed individually so that RAM_Type need not be contiguous
+    if (loc < RAM_Size - 1) {
+      if constexpr (has_word_access_v<RAM_Type>) { return builtin_ram.read_half_word(loc); }
 
-    if (data != nullptr) {
-      const std::uint32_t byte_1 = data[0];  // NOLINT
-      const std::uint32_t byte_2 = data[1];  // NOLINT
+      const std::uint32_t byte_1 = builtin_ram[loc];
+      const std::uint32_t byte_2 = builtin_ram[loc + 1];
 
       return static_cast<std::uint16_t>(byte_1 | (byte_2 << 8));
     } else {
@@ -394,18 +699,18 @@ template<std::size_t RAM_Size = 1024, typename RAM_Type = std::array<std::uint8_
   // read past end of allocated memory will return an unspecified value
   [[nodiscard]] constexpr std::uint32_t read_word(const std::uint32_t loc) const noexcept
   {
-    if (mmio_callback.is_mmio_range(loc)) { return mmio_callback.read_word(loc); }
+    if (mmio_callback.is_mmio_range(loc)) {
+      stats.mmio_read(loc);
+      return mmio_callback.read_word(loc);
+    }
 
-    const std::uint8_t *data = [&]() -> const std::uint8_t * {
-      if (loc + 3 < RAM_Size) { return &builtin_ram[loc]; }
-      return nullptr;
-    }();
+    if (loc < RAM_Size - 3) {
+      if constexpr (has_word_access_v<RAM_Type>) { return builtin_ram.read_word(loc); }
 
-    if (data != nullptr) {
-      const std::uint32_t byte_1 = data[0];  // NOLINT
-      const std::uint32_t byte_2 = data[1];  // NOLINT
-      const std::uint32_t byte_3 = data[2];  // NOLINT
-      const std::uint32_t byte_4 = data[3];  // NOLINT
+      const std::uint32_t byte_1 = builtin_ram[loc];
+      const std::uint32_t byte_2 = builtin_ram[loc + 1];
+      const std::uint32_t byte_3 = builtin_ram[loc + 2];
+      const std::uint32_t byte_4 = builtin_ram[loc + 3];
 
       return byte_1 | (byte_2 << 8) | (byte_3 << 16) | (byte_4 << 24);
     } else {
@@ -415,33 +720,56 @@ template<std::size_t RAM_Size = 1024, typename RAM_Type = std::array<std::uint8_
 
   constexpr void write_half_word(const std::uint32_t loc, const std::uint16_t value) noexcept
   {
-    auto *data = [&]() -> std::uint8_t * {
-      if (loc + 1 <= RAM_Size) { return &builtin_ram[loc]; }
-      return nullptr;
-    }();
+    if (loc < RAM_Size - 1) {
+      if constexpr (has_word_access_v<RAM_Type>) {
+        builtin_ram.write_half_word(loc, value);
+        return;
+      }
 
-    if (data != nullptr) {
-      data[0] = static_cast<std::uint8_t>(value & 0xFF);         // NOLINT
-      data[1] = static_cast<std::uint8_t>((value >> 8) & 0xFF);  // NOLINT
+      builtin_ram[loc]     = static_cast<std::uint8_t>(value & 0xFF);
+      builtin_ram[loc + 1] = static_cast<std::uint8_t>((value >> 8) & 0xFF);
     } else {
       invalid_memory_write = true;
+      stats.invalid_write(loc);
     }
   }
 
   constexpr void write_word(const std::uint32_t loc, const std::uint32_t value) noexcept
   {
-    auto *data = [&]() -> std::uint8_t * {
-      if (loc + 3 <= RAM_Size) { return &builtin_ram[loc]; }
-      return nullptr;
-    }();
+    if (loc < RAM_Size - 3) {
+      if constexpr (has_word_access_v<RAM_Type>) {
+        builtin_ram.write_word(loc, value);
+        return;
+      }
 
-    if (data != nullptr) {
-      data[0] = static_cast<std::uint8_t>(value & 0xFF);          // NOLINT
-      data[1] = static_cast<std::uint8_t>((value >> 8) & 0xFF);   // NOLINT
-      data[2] = static_cast<std::uint8_t>((value >> 16) & 0xFF);  // NOLINT
-      data[3] = static_cast<std::uint8_t>((value >> 24) & 0xFF);  // NOLINT
+      builtin_ram[loc]     = static_cast<std::uint8_t>(value & 0xFF);
+      builtin_ram[loc + 1] = static_cast<std::uint8_t>((value >> 8) & 0xFF);
+      builtin_ram[loc + 2] = static_cast<std::uint8_t>((value >> 16) & 0xFF);
+      builtin_ram[loc + 3] = static_cast<std::uint8_t>((value >> 24) & 0xFF);
     } else {
       invalid_memory_write = true;
+      stats.invalid_write(loc);
+    }
+  }
+
+  // Bounds checks the destination once and copies the `size` bytes at `image` in one go.
+  // Any part of the image that would land past the end of RAM is dropped and
+  // reported the same way as any other out of range write.
+  void load_image(const std::uint8_t *image, const std::size_t size, const std::uint32_t address) noexcept
+  {
+    if (size == 0) { return; }
+
+    const auto available = address < RAM_Size ? RAM_Size - address : std::size_t{ 0 };
+    const auto to_copy   = std::min(size, available);
+
+    if constexpr (has_contiguous_storage_v<RAM_Type>) {
+      if (to_copy != 0) { std::memcpy(&builtin_ram[address], image, to_copy); }
+    } else {
+      for (std::size_t loc = 0; loc < to_copy; ++loc) { builtin_ram[address + loc] = image[loc]; }
+    }
+    if (to_copy != size) {
+      invalid_memory_write = true;
+      stats.invalid_write(static_cast<std::uint32_t>(address + to_copy));
     }
   }
 
@@ -453,12 +781,20 @@ template<std::size_t RAM_Size = 1024, typename RAM_Type = std::array<std::uint8_
   constexpr System()                          = default;
 
   template<typename Container>
-  constexpr explicit System(const Container &memory,
-                            const std::uint32_t start_location = 0,
-                            MMIO_Callback &&t_mmio_callback    = MMIO_Callback{}) noexcept
+  explicit System(const Container &memory, const std::uint32_t start_location = 0, MMIO_Callback &&t_mmio_callback = MMIO_Callback{}) noexcept
     : mmio_callback{ std::move(t_mmio_callback) }
   {
-    for (std::size_t loc = 0; loc < memory.size(); ++loc) { write_byte(static_cast<std::uint32_t>(loc + start_location), memory[loc]); }
+    if constexpr (can_attach_image_v<RAM_Type, Container>) {
+      // the backing store can reference the image directly instead of copying it
+      const auto attached = builtin_ram.attach(memory, start_location);
+      if (attached != memory->size) {
+        // reported the same as load_image() reports an image that doesn't fit
+        invalid_memory_write = true;
+        stats.invalid_write(static_cast<std::uint32_t>(start_location + attached));
+      }
+    } else {
+      load_image(memory.data(), memory.size(), start_location);
+    }
     i_cache.fill_cache(*this);
   }
 
@@ -470,6 +806,7 @@ template<std::size_t RAM_Size = 1024, typename RAM_Type = std::array<std::uint8_
   {
     static_assert(Size <= RAM_Size);
 
+    // byte at a time so that this stays usable in a constexpr context
     for (std::size_t loc = 0; loc < Size; ++loc) { write_byte(static_cast<std::uint32_t>(loc + start_location), memory[loc]); }
 
     i_cache.fill_cache(*this);
@@ -484,13 +821,15 @@ template<std::size_t RAM_Size = 1024, typename RAM_Type = std::array<std::uint8_
     LR() = RAM_Size - 4;
     PC() = loc + 4;
     SP() = RAM_Size - 1;
+
+    resume_pc = not_resuming;
   }
 
-  template<typename Tracer = void (*)(const System &, std::uint32_t, Instruction)>
-  constexpr void next_operation(Tracer &&tracer = [](const System & /*unused*/, const auto /*unused*/, const auto /*unused*/) {}) noexcept
+  template<typename Tracer = NO_TRACER> constexpr void next_operation(Tracer &&tracer = NO_TRACER{}) noexcept
   {
     const auto [ins, type] = i_cache.fetch(PC() - 4, *this);
     tracer(*this, PC() - 4, ins);
+    stats.instruction(type);
     process(ins, type);
   }
 
@@ -515,38 +854,95 @@ template<std::size_t RAM_Size = 1024, typename RAM_Type = std::array<std::uint8_
 
     constexpr Cache_Elem fetch(const std::uint32_t loc, const System &sys) noexcept
     {
-      if (loc > start + (cache.size() * 4) || loc < start) {
+      if (loc >= start + (cache.size() * 4) || loc < start) {
+        sys.stats.cache_miss();
         start = loc;
         fill_cache(sys);
       }
 
-      return cache[(loc - start) / 4];
+      const auto idx = (loc - start) / 4;
+      if (!filled[idx]) { fill(idx, sys); }
+      return cache[idx];
     }
 
+    // Empties the cache, entries are decoded the first time they are fetched, so jumping
+    // somewhere only costs decoding what actually executes there
     constexpr void fill_cache(const System &sys) noexcept
     {
-      auto loc = start;
-      for (auto &elem : cache) {
-        elem.instruction = Instruction{ sys.read_word(loc) };
-        elem.type        = sys.decode(elem.instruction);
-        loc += 4;
+      sys.stats.cache_refill();
+      for (auto &elem : filled) { elem = false; }
+
+      for (std::size_t idx = 0; idx < sys.breakpoint_count; ++idx) {
+        const auto breakpoint = sys.breakpoints[idx];
+        if (breakpoint >= start && breakpoint < start + (cache.size() * 4) && (breakpoint - start) % 4 == 0) {
+          fill((breakpoint - start) / 4, sys);
+          cache[(breakpoint - start) / 4].type = Instruction_Type::Breakpoint;
+        }
       }
     }
 
   private:
+    constexpr void fill(const std::size_t idx, const System &sys) noexcept
+    {
+      const auto loc = static_cast<std::uint32_t>(start + idx * 4);
+      auto &elem     = cache[idx];
+      // fetching must not read devices, that would have side effects, like using up random numbers
+      elem.instruction = Instruction{ sys.mmio_callback.is_mmio_range(loc) ? 0 : sys.read_word(loc) };
+      if constexpr (has_predecoded_v<RAM_Type>) {
+        // reuse the decoding shared by every instance running the same image where possible
+        const auto *type = sys.builtin_ram.predecoded(loc);
+        elem.type        = type != nullptr ? *type : sys.decode(elem.instruction);
+      } else {
+        elem.type = sys.decode(elem.instruction);
+      }
+      filled[idx] = true;
+    }
+
     std::uint32_t start{ 0 };
 
     std::array<Cache_Elem, 1024> cache;
+    std::array<bool, 1024> filled{};
   };
 
   I_Cache i_cache{ *this, 0 };
 
-  template<typename Tracer = void (*)(const System &, std::uint32_t, Instruction)>
-  constexpr void run(const std::uint32_t loc,
-                     Tracer &&tracer = [](const System & /*unused*/, const auto /*unused*/, const auto /*unused*/) {}) noexcept
+  std::uint64_t instructions_remaining{ 0 };
+
+  // Continues from the current state for at most `max_instructions`, stopping
+  // early if the program exits or something calls `stop()`
+  template<typename Tracer = NO_TRACER> constexpr Run_Result run_for(const std::uint64_t max_instructions, Tracer &&tracer = NO_TRACER{}) noexcept
+  {
+    stop_reason = Stop_Reason::Budget_Exhausted;
+
+    // only step over the breakpoint if we're still in front of it
+    if (resume_pc != PC() - 4) { resume_pc = not_resuming; }
+
+    std::uint64_t executed = 0;
+    // decremented up front, so that `stop()` zeroing it ends the loop
+    for (instructions_remaining = max_instructions; instructions_remaining != 0 && operations_remaining();) {
+      --instructions_remaining;
+      next_operation(tracer);
+      ++executed;
+    }
+
+    if (stop_reason == Stop_Reason::Budget_Exhausted && !operations_remaining()) { stop_reason = Stop_Reason::Exited; }
+
+    // we stopped in front of the breakpoint, it hasn't executed yet
+    if (stop_reason == Stop_Reason::Breakpoint) {
+      --executed;
+    } else {
+      resume_pc = not_resuming;
+    }
+
+    stats.run_slice(executed);
+
+    return { stop_reason, executed };
+  }
+
+  template<typename Tracer = NO_TRACER> constexpr Run_Result run(const std::uint32_t loc, Tracer &&tracer = NO_TRACER{}) noexcept
   {
     setup_run(loc);
-    while (operations_remaining()) { next_operation(tracer); }
+    return run_for(std::numeric_limits<std::uint64_t>::max(), tracer);
   }
 
   [[nodiscard]] constexpr auto get_second_operand_shift_amount(const Data_Processing val) const noexcept
@@ -629,16 +1025,18 @@ template<std::size_t RAM_Size = 1024, typename RAM_Type = std::array<std::uint8_
     const auto load = val.load();
 
     if (val.psr()) {
-      abort();  // cannot handle PSR
+      return stop(Stop_Reason::Unhandled_Instruction);  // cannot handle PSR
     }
 
+    timing.block_data_transfer(load, bits_set, load && test_bit(register_list, 15));
+
     // incrementing, lowest # register goes first
     for (std::size_t i = 0; i < 16; ++i) {
       if (test_bit(register_list, i)) {
         if (load) {
-          registers[i] = read_word(start_address);
+          registers[i] = load_word(start_address);
         } else {
-          write_word(start_address, registers[i]);
+          store_word(start_address, registers[i]);
         }
         start_address += 4;
       }
@@ -651,6 +1049,85 @@ template<std::size_t RAM_Size = 1024, typename RAM_Type = std::array<std::uint8_
   }
 
 
+  // the guest's own loads and stores, which memory hooks get to see
+  [[nodiscard]] constexpr std::uint32_t load_word(const std::uint32_t loc) noexcept
+  {
+    const auto value = read_word(loc);
+    if (memory_hooks.is_hooked(loc)) { memory_hooks.read(*this, loc, 4, value); }
+    return value;
+  }
+
+  [[nodiscard]] constexpr std::uint8_t load_byte(const std::uint32_t loc) noexcept
+  {
+    const auto value = read_byte(loc);
+    if (memory_hooks.is_hooked(loc)) { memory_hooks.read(*this, loc, 1, value); }
+    return value;
+  }
+
+  constexpr void store_word(const std::uint32_t loc, const std::uint32_t value) noexcept
+  {
+    if (memory_hooks.is_hooked(loc)) {
+      const auto old_value = Memory_Hooks::wants_old_value && !mmio_callback.is_mmio_range(loc) ? read_word(loc) : std::uint32_t{ 0 };
+      write_word(loc, value);
+      memory_hooks.write(*this, loc, 4, old_value, value);
+    } else {
+      write_word(loc, value);
+    }
+  }
+
+  constexpr void store_byte(const std::uint32_t loc, const std::uint8_t value) noexcept
+  {
+    if (memory_hooks.is_hooked(loc)) {
+      const auto old_value = Memory_Hooks::wants_old_value && !mmio_callback.is_mmio_range(loc) ? read_byte(loc) : std::uint8_t{ 0 };
+      write_byte(loc, value);
+      memory_hooks.write(*this, loc, 1, old_value, value);
+    } else {
+      write_byte(loc, value);
+    }
+  }
+
+  // swaps `value` into memory, returning what was there
+  constexpr std::uint32_t exchange_word(const std::uint32_t loc, const std::uint32_t value) noexcept
+  {
+    if constexpr (has_atomic_exchange_v<RAM_Type>) {
+      if (!mmio_callback.is_mmio_range(loc) && loc < RAM_Size - 3) { return builtin_ram.exchange_word(loc, value); }
+    }
+
+    // nothing else can touch our memory in between
+    const auto original = read_word(loc);
+    write_word(loc, value);
+    return original;
+  }
+
+  constexpr std::uint8_t exchange_byte(const std::uint32_t loc, const std::uint8_t value) noexcept
+  {
+    if constexpr (has_atomic_exchange_v<RAM_Type>) {
+      if (!mmio_callback.is_mmio_range(loc) && loc < RAM_Size) { return builtin_ram.exchange_byte(loc, value); }
+    }
+
+    const auto original = read_byte(loc);
+    write_byte(loc, value);
+    return original;
+  }
+
+  constexpr void process(const Single_Data_Swap val) noexcept
+  {
+    const auto location = registers[val.base_register()];
+    const auto source   = registers[val.source_register()];
+
+    timing.single_data_swap();
+
+    const auto size     = val.byte_transfer() ? 1U : 4U;
+    const auto original = val.byte_transfer() ? exchange_byte(location, static_cast<std::uint8_t>(source & 0xFF)) : exchange_word(location, source);
+
+    if (memory_hooks.is_hooked(location)) {
+      memory_hooks.read(*this, location, size, original);
+      memory_hooks.write(*this, location, size, original, val.byte_transfer() ? (source & 0xFF) : source);
+    }
+
+    registers[val.destination_register()] = original;
+  }
+
   constexpr auto offset(const Single_Data_Transfer val) const noexcept
   {
     const auto offset = [=]() -> std::int64_t {
@@ -679,18 +1156,20 @@ template<std::size_t RAM_Size = 1024, typename RAM_Type = std::array<std::uint8_
     const auto src_dest_register = val.src_dest_register();
     const auto indexed_location  = static_cast<std::uint32_t>(base_location + index_offset);
 
+    timing.single_data_transfer(val.load(), val.load() && src_dest_register == 15);
+
     if (val.byte_transfer()) {
       if (const auto location = pre_indexed ? indexed_location : base_location; val.load()) {
-        registers[src_dest_register] = read_byte(location);
+        registers[src_dest_register] = load_byte(location);
       } else {
-        write_byte(location, static_cast<std::uint8_t>(registers[src_dest_register] & 0xFF));
+        store_byte(location, static_cast<std::uint8_t>(registers[src_dest_register] & 0xFF));
       }
     } else {
       // word transfer
       if (const auto location = pre_indexed ? indexed_location : base_location; val.load()) {
-        registers[src_dest_register] = read_word(location);
+        registers[src_dest_register] = load_word(location);
       } else {
-        write_word(location, registers[src_dest_register]);
+        store_word(location, registers[src_dest_register]);
       }
     }
 
@@ -707,6 +1186,10 @@ template<std::size_t RAM_Size = 1024, typename RAM_Type = std::array<std::uint8_
     const auto destination_register = val.destination_register();
     auto &destination               = registers[destination_register];
 
+    const auto opcode    = val.get_opcode();
+    const bool test_only = opcode == OpCode::TST || opcode == OpCode::TEQ || opcode == OpCode::CMP || opcode == OpCode::CMN;
+    timing.data_processing(!val.immediate_operand() && !val.operand_2_immediate_shift(), destination_register == 15 && !test_only);
+
     const auto update_logical_flags = [=, &destination, carry_out = carry_out](const bool write, const auto result) {
       if (val.set_condition_code() && destination_register != 15) {
         c_flag(carry_out);
@@ -733,18 +1216,18 @@ template<std::size_t RAM_Size = 1024, typename RAM_Type = std::array<std::uint8_
         const bool carry_result = (result & (1ull << 32)) != 0;
         c_flag(invert_carry ? !carry_result : carry_result);
 
-        const auto first_op_sign  = test_bit(static_cast<std::uint32_t>(first_operand), 31);
-        const auto second_op_sign = test_bit(static_cast<std::uint32_t>(second_operand), 31);
-        const auto result_sign    = test_bit(static_cast<std::uint32_t>(result), 31);
-
-        v_flag((first_op_sign == second_op_sign) && (result_sign != first_op_sign));
+        // signed overflow: the operation on the signed operands doesn't fit in 32 bits
+        const auto signed_result = op(static_cast<std::int64_t>(static_cast<std::int32_t>(first_operand)),
+                                      static_cast<std::int64_t>(static_cast<std::int32_t>(second_operand)),
+                                      static_cast<std::int64_t>(carry));
+        v_flag(signed_result != static_cast<std::int32_t>(result));
       }
 
       if (write) { destination = static_cast<std::uint32_t>(result); }
     };
 
 
-    switch (val.get_opcode()) {
+    switch (opcode) {
     case OpCode::AND: return update_logical_flags(true, first_operand & second_operand);
     case OpCode::EOR: return update_logical_flags(true, first_operand ^ second_operand);
     case OpCode::TST: return update_logical_flags(false, first_operand & second_operand);
@@ -767,6 +1250,8 @@ template<std::size_t RAM_Size = 1024, typename RAM_Type = std::array<std::uint8_
 
   constexpr void process(const Branch instruction) noexcept
   {
+    timing.branch();
+
     if (instruction.link()) {
       // Link bit set, get PC, which is already pointing at the next instruction
       LR() = PC();
@@ -777,6 +1262,8 @@ template<std::size_t RAM_Size = 1024, typename RAM_Type = std::array<std::uint8_
 
   constexpr void process(const Multiply_Long val) noexcept
   {
+    timing.multiply_long(val.accumulate(), val.unsigned_mul(), registers[val.operand_1()]);
+
     const auto result = [val, lhs = registers[val.operand_1()], rhs = registers[val.operand_2()]]() {
       if (val.unsigned_mul()) {
         return static_cast<std::uint64_t>(lhs) * static_cast<std::uint64_t>(rhs);
@@ -827,23 +1314,28 @@ template<std::size_t RAM_Size = 1024, typename RAM_Type = std::array<std::uint8_
   constexpr void v_flag(const bool val) noexcept { set_or_clear_bit(CSPR, v_bit, val); }
 
   /// \sa Condition enumeration
-  [[nodiscard]] constexpr bool check_condition(const Instruction instruction) const noexcept
+  [[nodiscard]] static constexpr bool check_condition(const Condition condition, const std::uint32_t cspr) noexcept
   {
-    switch (instruction.get_condition()) {
-    case Condition::EQ: return z_flag();
-    case Condition::NE: return !z_flag();
-    case Condition::HS: return c_flag();
-    case Condition::LO: return !c_flag();
-    case Condition::MI: return n_flag();
-    case Condition::PL: return !n_flag();
-    case Condition::VS: return v_flag();
-    case Condition::VC: return !v_flag();
-    case Condition::HI: return c_flag() && !z_flag();
-    case Condition::LS: return !c_flag() && z_flag();
-    case Condition::GE: return (n_flag() && v_flag()) || (!n_flag() && !v_flag());
-    case Condition::LT: return (n_flag() && !v_flag()) || (!n_flag() && v_flag());
-    case Condition::GT: return !z_flag() && ((n_flag() && v_flag()) || (!n_flag() && !v_flag()));
-    case Condition::LE: return z_flag() || (n_flag() && !v_flag()) || (!n_flag() && v_flag());
+    const bool n = cspr & n_bit;
+    const bool z = cspr & z_bit;
+    const bool c = cspr & c_bit;
+    const bool v = cspr & v_bit;
+
+    switch (condition) {
+    case Condition::EQ: return z;
+    case Condition::NE: return !z;
+    case Condition::HS: return c;
+    case Condition::LO: return !c;
+    case Condition::MI: return n;
+    case Condition::PL: return !n;
+    case Condition::VS: return v;
+    case Condition::VC: return !v;
+    case Condition::HI: return c && !z;
+    case Condition::LS: return !c || z;
+    case Condition::GE: return n == v;
+    case Condition::LT: return n != v;
+    case Condition::GT: return !z && (n == v);
+    case Condition::LE: return z || (n != v);
     case Condition::AL: return true;
     case Condition::NV:  // Reserved
       return false;
@@ -852,6 +1344,11 @@ template<std::size_t RAM_Size = 1024, typename RAM_Type = std::array<std::uint8_
     return false;
   }
 
+  [[nodiscard]] constexpr bool check_condition(const Instruction instruction) const noexcept
+  {
+    return check_condition(instruction.get_condition(), CSPR);
+  }
+
   // make this constexpr static and it gets initialized exactly once, no question
   constexpr static auto lookup_table = get_lookup_table();
 
@@ -877,23 +1374,43 @@ template<std::size_t RAM_Size = 1024, typename RAM_Type = std::array<std::uint8_
       case Instruction_Type::Single_Data_Transfer: process(Single_Data_Transfer{ instruction }); break;
       case Instruction_Type::Branch: process(Branch{ instruction }); break;
       case Instruction_Type::Load_And_Store_Multiple: process(Load_And_Store_Multiple{ instruction }); break;
+      case Instruction_Type::Single_Data_Swap: process(Single_Data_Swap{ instruction }); break;
       case Instruction_Type::MRS:
       case Instruction_Type::MSR:
       case Instruction_Type::MSRF:
       case Instruction_Type::Multiply:
-      case Instruction_Type::Single_Data_Swap:
       case Instruction_Type::Undefined:
       case Instruction_Type::Block_Data_Transfer:
       case Instruction_Type::Coprocessor_Data_Transfer:
       case Instruction_Type::Coprocessor_Data_Operation:
       case Instruction_Type::Coprocessor_Register_Transfer:
       case Instruction_Type::Software_Interrupt: unhandled_instruction(instruction, type); break;
+      case Instruction_Type::Breakpoint: breakpoint(instruction); break;
       }
+    } else if (type == Instruction_Type::Breakpoint) {
+      // stop whether or not the condition passes, like a debugger would
+      breakpoint(instruction);
+    } else {
+      timing.condition_failed();
     }
 
     // discount prefetch
     // PC() -= 4;
   }
+
+  // A tracer sees an instruction we stopped in front of again when execution continues
+  constexpr void breakpoint(const Instruction instruction) noexcept
+  {
+    PC() -= 4;
+
+    if (resume_pc == PC() - 4) {
+      resume_pc = not_resuming;
+      process(instruction, decode(instruction));
+    } else {
+      resume_pc = PC() - 4;
+      stop(Stop_Reason::Breakpoint);
+    }
+  }
 };
 
 
@@ -39,6 +39,9 @@ struct Loaded_Files
 
 Loaded_Files load_unknown(const std::filesystem::path &t_path, spdlog::logger &logger);
 
+// where, relative to the start of the image, each run of instructions generated for `line_number` begins
+std::vector<std::uint32_t> line_addresses(const Loaded_Files &files, const int line_number);
+
 
 std::pair<bool, std::string> test_clang(const std::filesystem::path &p);
 
@@ -0,0 +1,64 @@
+#ifndef CPP_BOX_COVERAGE_HPP
+#define CPP_BOX_COVERAGE_HPP
+
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#include "arm.hpp"
+
+namespace cpp_box {
+struct Loaded_Files;
+}  // namespace cpp_box
+
+namespace cpp_box::arm {
+
+// Tracer setting one bit per executed instruction word in [base, base + size), so whether a
+// line ran is exact, even for lines in the middle of a basic block. Setting a bit that's
+// already set is all it costs once the guest's code has warmed up.
+class Coverage
+{
+public:
+  Coverage() = default;
+  Coverage(const std::uint32_t t_base, const std::uint32_t t_size) : m_base{ t_base }, m_words{ t_size / 4 }, m_bits((m_words + 63) / 64) {}
+
+  template<typename System>
+  void operator()([[maybe_unused]] const System &sys, const std::uint32_t pc, [[maybe_unused]] const Instruction ins) noexcept
+  {
+    // anything below `base` wraps around to a large index
+    const auto word = (pc - m_base) / 4;
+    if (word < m_words) { m_bits[word / 64] |= std::uint64_t{ 1 } << (word % 64); }
+  }
+
+  // `offset` is relative to `base`
+  [[nodiscard]] bool covered(const std::uint32_t offset) const noexcept
+  {
+    const auto word = offset / 4;
+    return word < m_words && (m_bits[word / 64] & (std::uint64_t{ 1 } << (word % 64))) != 0;
+  }
+
+  [[nodiscard]] std::uint32_t base() const noexcept { return m_base; }
+
+private:
+  std::uint32_t m_base{ 0 };
+  std::uint32_t m_words{ 0 };
+  std::vector<std::uint64_t> m_bits;
+};
+
+}  // namespace cpp_box::arm
+
+namespace cpp_box {
+
+struct Coverage_Summary
+{
+  std::size_t lines{ 0 };
+  std::size_t lines_hit{ 0 };
+};
+
+// Writes an lcov tracefile, with a record per source file in `files.location_data`. Hit counts
+// are 0 or 1, the bitmap only knows whether a line ran.
+Coverage_Summary write_lcov(std::ostream &os, const arm::Coverage &coverage, const Loaded_Files &files);
+
+}  // namespace cpp_box
+
+#endif
@@ -0,0 +1,254 @@
+#ifndef CPP_BOX_DIFFERENTIAL_HPP
+#define CPP_BOX_DIFFERENTIAL_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "arm.hpp"
+#include "lockstep.hpp"
+
+namespace cpp_box::arm {
+
+// Memory_Hooks policy remembering which 4KB pages the guest has stored to since it was last
+// cleared, so that Differential only has to compare the memory that can have changed.
+template<std::size_t RAM_Size> class Dirty_Pages
+{
+public:
+  static constexpr std::uint32_t page_bits = 12;
+  static constexpr std::uint32_t page_size = 1U << page_bits;
+  static constexpr std::size_t page_count  = (RAM_Size + page_size - 1) >> page_bits;
+
+  static constexpr bool wants_old_value = false;
+
+  // never allocates while the guest runs
+  Dirty_Pages() { m_pages.reserve(page_count); }
+
+  [[nodiscard]] constexpr bool is_hooked([[maybe_unused]] const std::uint32_t loc) const noexcept { return true; }
+
+  template<typename System>
+  constexpr void read([[maybe_unused]] System &sys,
+                      [[maybe_unused]] const std::uint32_t loc,
+                      [[maybe_unused]] const std::uint32_t size,
+                      [[maybe_unused]] const std::uint32_t value) noexcept
+  {
+  }
+
+  template<typename System>
+  void write([[maybe_unused]] System &sys,
+             const std::uint32_t loc,
+             const std::uint32_t size,
+             [[maybe_unused]] const std::uint32_t old_value,
+             [[maybe_unused]] const std::uint32_t new_value) noexcept
+  {
+    // an unaligned store can straddle two pages
+    mark(loc);
+    mark(loc + size - 1);
+  }
+
+  // page numbers, in the order they were first stored to
+  [[nodiscard]] const std::vector<std::uint32_t> &pages() const noexcept { return m_pages; }
+
+  void clear() noexcept
+  {
+    for (const auto page : m_pages) { m_dirty[page] = false; }
+    m_pages.clear();
+  }
+
+private:
+  void mark(const std::uint32_t loc) noexcept
+  {
+    if (const auto page = loc >> page_bits; page < page_count && !m_dirty[page]) {
+      m_dirty[page] = true;
+      m_pages.push_back(page);
+    }
+  }
+
+  std::array<bool, page_count> m_dirty{};
+  std::vector<std::uint32_t> m_pages;
+};
+
+// Where two engines running the same program first disagreed
+struct Divergence
+{
+  enum class Kind {
+    Stop_Reason,    // expected / actual are Stop_Reasons
+    Instructions,   // executed a different number of instructions before stopping
+    Register,       // `where` is the register number
+    CSPR,
+    Memory,         // `where` is the address of the first differing byte on a page
+    Invalid_Write,  // one of them wrote outside of RAM
+  };
+
+  struct Difference
+  {
+    Kind kind;
+    std::uint32_t where;
+    std::uint64_t expected;
+    std::uint64_t actual;
+  };
+
+  std::uint64_t instructions;  // executed by each engine when the difference was found
+  std::uint64_t last_match;    // executed by each engine at the last comparison that passed
+  std::uint32_t pc;            // of the last instruction the reference executed
+  Instruction instruction{ 0 };
+  std::vector<Difference> differences;
+};
+
+// A Lockstep_System of lanes that all run the same thing, standing in for one System so that
+// the lockstep engine can be checked against the scalar one. Its results are read from lane 0.
+template<typename Scalar_System, std::size_t Lanes> struct Lockstep_Engine
+{
+  explicit Lockstep_Engine(const Scalar_System &prototype) : lanes{ prototype } {}
+
+  Run_Result run_for(const std::uint64_t max_instructions) { return lanes.run_for(max_instructions)[0]; }
+
+  Lockstep_System<Scalar_System, Lanes> lanes;
+};
+
+// The System holding an engine's registers and memory. Engines that aren't a System themselves
+// overload this.
+template<std::size_t RAM_Size, typename RAM_Type, typename MMIO_Callback, typename Timing, typename Memory_Hooks, typename Stats>
+[[nodiscard]] constexpr auto &engine_system(System<RAM_Size, RAM_Type, MMIO_Callback, Timing, Memory_Hooks, Stats> &sys) noexcept
+{
+  return sys;
+}
+
+template<typename Scalar_System, std::size_t Lanes>
+[[nodiscard]] constexpr Scalar_System &engine_system(Lockstep_Engine<Scalar_System, Lanes> &engine) noexcept
+{
+  return engine.lanes.lane(0);
+}
+
+// Runs a candidate engine side by side with a reference one on the same program, comparing
+// the run results, registers, CSPR and the memory either has stored to every `interval`
+// instructions. An `interval` of 0 compares them at the end of every basic block, whenever the
+// reference's PC does anything but move on to the next instruction.
+//
+// Both engines must have been set up identically, including their MMIO devices, and both
+// must use Dirty_Pages memory hooks.
+template<typename Reference, typename Candidate> class Differential
+{
+public:
+  Differential(Reference &reference, Candidate &candidate, const std::uint64_t interval)
+    : m_reference{ reference }, m_candidate{ candidate }, m_interval{ interval }
+  {
+  }
+
+  // instructions each engine has executed so far
+  [[nodiscard]] std::uint64_t instructions() const noexcept { return m_instructions; }
+
+  // Runs both engines for at most `max_instructions`, or until the program stops, returning
+  // what was different at the first comparison that failed
+  std::optional<Divergence> run_for(const std::uint64_t max_instructions)
+  {
+    for (std::uint64_t executed = 0; executed < max_instructions;) {
+      const auto expected = run_reference(max_instructions - executed);
+      const auto actual   = m_candidate.run_for(expected.instructions);
+      executed += expected.instructions;
+      m_instructions += expected.instructions;
+
+      if (auto divergence = compare(expected, actual); divergence) { return divergence; }
+      m_last_match = m_instructions;
+
+      if (expected.reason != Stop_Reason::Budget_Exhausted) { break; }
+    }
+
+    return std::nullopt;
+  }
+
+  // Runs both engines for `instructions` without comparing them, to get back to just before a
+  // divergence found with a coarse interval and look at it again with a finer one
+  void skip(const std::uint64_t instructions)
+  {
+    m_reference.run_for(instructions);
+    m_candidate.run_for(instructions);
+    m_instructions += instructions;
+    m_last_match = m_instructions;
+    engine_system(m_reference).memory_hooks.clear();
+    engine_system(m_candidate).memory_hooks.clear();
+  }
+
+private:
+  Run_Result run_reference(const std::uint64_t budget)
+  {
+    auto &sys          = engine_system(m_reference);
+    const auto tracer = [this](const auto &, const std::uint32_t pc, const Instruction ins) {
+      m_last_pc          = pc;
+      m_last_instruction = ins;
+    };
+
+    if (m_interval != 0) { return m_reference.run_for(std::min(budget, m_interval), tracer); }
+
+    Run_Result total{ Stop_Reason::Budget_Exhausted, 0 };
+    while (total.instructions < budget) {
+      const auto next = sys.PC() + 4;
+      const auto step = m_reference.run_for(1, tracer);
+      total           = { step.reason, total.instructions + step.instructions };
+      if (step.reason != Stop_Reason::Budget_Exhausted || sys.PC() != next) { break; }
+    }
+    return total;
+  }
+
+  std::optional<Divergence> compare(const Run_Result expected, const Run_Result actual)
+  {
+    auto &reference = engine_system(m_reference);
+    auto &candidate = engine_system(m_candidate);
+
+    std::vector<Divergence::Difference> differences;
+    const auto check = [&](const Divergence::Kind kind, const std::uint32_t where, const std::uint64_t lhs, const std::uint64_t rhs) {
+      if (lhs != rhs) { differences.push_back({ kind, where, lhs, rhs }); }
+    };
+
+    check(Divergence::Kind::Stop_Reason, 0, static_cast<std::uint64_t>(expected.reason), static_cast<std::uint64_t>(actual.reason));
+    check(Divergence::Kind::Instructions, 0, expected.instructions, actual.instructions);
+    for (std::uint32_t reg = 0; reg < 16; ++reg) { check(Divergence::Kind::Register, reg, reference.registers[reg], candidate.registers[reg]); }
+    check(Divergence::Kind::CSPR, 0, reference.CSPR, candidate.CSPR);
+    check(Divergence::Kind::Invalid_Write, 0, reference.invalid_memory_write, candidate.invalid_memory_write);
+
+    // raw RAM through const references, reading through the System could touch devices and
+    // non-const access to copy-on-write RAM would copy pages
+    const auto &expected_ram = std::as_const(reference).builtin_ram;
+    const auto &actual_ram   = std::as_const(candidate).builtin_ram;
+    const auto compare_page  = [&](const std::uint32_t page) {
+      using Hooks      = std::decay_t<decltype(reference.memory_hooks)>;
+      const auto start = page << Hooks::page_bits;
+      const auto end   = static_cast<std::uint32_t>(std::min<std::size_t>(start + Hooks::page_size, expected_ram.size()));
+      for (auto loc = start; loc < end; ++loc) {
+        if (expected_ram[loc] != actual_ram[loc]) {
+          check(Divergence::Kind::Memory, loc, expected_ram[loc], actual_ram[loc]);
+          return;
+        }
+      }
+    };
+
+    for (const auto page : reference.memory_hooks.pages()) { compare_page(page); }
+    for (const auto page : candidate.memory_hooks.pages()) {
+      if (std::find(reference.memory_hooks.pages().begin(), reference.memory_hooks.pages().end(), page) == reference.memory_hooks.pages().end()) {
+        compare_page(page);
+      }
+    }
+
+    reference.memory_hooks.clear();
+    candidate.memory_hooks.clear();
+
+    if (differences.empty()) { return std::nullopt; }
+    return Divergence{ m_instructions, m_last_match, m_last_pc, m_last_instruction, std::move(differences) };
+  }
+
+  Reference &m_reference;
+  Candidate &m_candidate;
+  std::uint64_t m_interval;
+  std::uint64_t m_instructions{ 0 };
+  std::uint64_t m_last_match{ 0 };
+  std::uint32_t m_last_pc{ 0 };
+  Instruction m_last_instruction{ 0 };
+};
+
+}  // namespace cpp_box::arm
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef CPP_BOX_DISASSEMBLER_HPP
+#define CPP_BOX_DISASSEMBLER_HPP
+
+#include <cstdint>
+#include <string>
+
+#include "arm.hpp"
+
+namespace cpp_box::arm {
+
+// One instruction in the usual ARM assembler syntax, "addne r0, r1, r2, lsl #2", for reporting
+// where the guest is without needing llvm-objdump or a line table. `address` is where the
+// instruction is, so that branch targets can be given as absolute addresses. Only the
+// instructions the emulator executes are decoded operand by operand, anything else is given by
+// its type and encoding.
+[[nodiscard]] std::string disassemble(const Instruction instruction, const std::uint32_t address);
+
+}  // namespace cpp_box::arm
+
+#endif
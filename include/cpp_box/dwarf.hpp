@@ -0,0 +1,30 @@
+#ifndef CPP_BOX_DWARF_HPP
+#define CPP_BOX_DWARF_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cpp_box::elf {
+struct File_Header;
+}  // namespace cpp_box::elf
+
+namespace cpp_box::dwarf {
+
+// The instructions in [begin, end), as file offsets, were generated for `line` of `file`
+struct Line_Range
+{
+  std::uint64_t begin;
+  std::uint64_t end;
+  std::string file;
+  int line;
+};
+
+// Reads the DWARF 2 to 5 line number programs in .debug_line. In relocatable files addresses
+// are resolved through .rel.debug_line, otherwise through the address of the section they're
+// in. Empty if there is no (readable) line information.
+[[nodiscard]] std::vector<Line_Range> read_line_table(const elf::File_Header &file_header);
+
+}  // namespace cpp_box::dwarf
+
+#endif
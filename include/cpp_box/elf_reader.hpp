@@ -279,6 +279,8 @@ struct Symbol_Table_Entry
 
   [[nodiscard]] constexpr auto size() const noexcept { return read(Fields::st_size); }
 
+  [[nodiscard]] constexpr auto type() const noexcept { return static_cast<Type>(read(Fields::st_info) & 0xF); }
+
 
   [[nodiscard]] constexpr auto read(const Fields field) const noexcept -> std::uint64_t
   {
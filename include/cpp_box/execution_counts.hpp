@@ -0,0 +1,84 @@
+#ifndef CPP_BOX_EXECUTION_COUNTS_HPP
+#define CPP_BOX_EXECUTION_COUNTS_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "arm.hpp"
+
+namespace cpp_box::arm {
+
+// Tracer counting how many times each instruction in [base, base + size) executed.
+//
+// Rather than touching a counter per instruction it only notices where each straight line run
+// of instructions (a basic block, give or take) starts and ends, and records the run as a +1 at
+// its first instruction and a -1 after its last one. `counts()` sums those up, so the work per
+// instruction is a compare and a store.
+class Execution_Counts
+{
+public:
+  Execution_Counts() = default;
+  Execution_Counts(const std::uint32_t t_base, const std::uint32_t t_size) : m_base{ t_base }, m_deltas(t_size / 4 + 1) {}
+
+  template<typename System>
+  void operator()([[maybe_unused]] const System &sys, const std::uint32_t pc, [[maybe_unused]] const Instruction ins) noexcept
+  {
+    if (pc != m_next) {
+      end_run();
+      m_run_start = pc;
+    }
+    m_next = pc + 4;
+  }
+
+  // one count per instruction, starting at `base`. Includes the run in progress.
+  [[nodiscard]] std::vector<std::uint64_t> counts()
+  {
+    end_run();
+    m_run_start = m_next;
+
+    std::vector<std::uint64_t> result(m_deltas.size() - 1);
+    std::int64_t running = 0;
+    for (std::size_t idx = 0; idx < result.size(); ++idx) {
+      running += m_deltas[idx];
+      result[idx] = static_cast<std::uint64_t>(running);
+    }
+    return result;
+  }
+
+  // the last instruction this was called for didn't execute after all, because a breakpoint
+  // stopped in front of it. It will be seen again when execution resumes.
+  void undo_last() noexcept { m_next -= 4; }
+
+  void clear() noexcept
+  {
+    std::fill(m_deltas.begin(), m_deltas.end(), 0);
+    m_run_start = m_next = 0;
+  }
+
+  [[nodiscard]] std::uint32_t base() const noexcept { return m_base; }
+
+private:
+  void end_run() noexcept
+  {
+    if (m_next <= m_run_start || m_deltas.empty()) { return; }
+
+    // runs reaching outside of the counted range only count the part inside of it
+    const auto last  = static_cast<std::uint32_t>(m_deltas.size() - 1);
+    const auto first = m_run_start < m_base ? 0 : std::min((m_run_start - m_base) / 4, last);
+    const auto end   = m_next < m_base ? 0 : std::min((m_next - m_base) / 4, last);
+    if (first == end) { return; }
+
+    ++m_deltas[first];
+    --m_deltas[end];
+  }
+
+  std::uint32_t m_base{ 0 };
+  std::uint32_t m_run_start{ 0 };
+  std::uint32_t m_next{ 0 };
+  std::vector<std::int64_t> m_deltas;
+};
+
+}  // namespace cpp_box::arm
+
+#endif
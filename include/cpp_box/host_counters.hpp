@@ -0,0 +1,56 @@
+#ifndef CPP_BOX_HOST_COUNTERS_HPP
+#define CPP_BOX_HOST_COUNTERS_HPP
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace cpp_box {
+
+// Hardware performance counters for the calling thread, from Linux's perf_event_open, for
+// measuring the emulator itself rather than the guest. They're opened as one group, so they
+// are all scheduled onto the CPU together and cover the same instructions. Counters the kernel
+// or the CPU won't give us are left out, `error()` says why when there are none at all.
+class Host_Counters
+{
+public:
+  enum class Event : std::size_t { Cycles, Instructions, Branch_Misses, Cache_Misses };
+  static constexpr std::size_t event_count = 4;
+
+  struct Reading
+  {
+    std::array<std::optional<std::uint64_t>, event_count> values;
+
+    [[nodiscard]] std::optional<std::uint64_t> operator[](const Event event) const noexcept { return values[static_cast<std::size_t>(event)]; }
+  };
+
+  Host_Counters();
+  ~Host_Counters();
+
+  Host_Counters(const Host_Counters &) = delete;
+  Host_Counters(Host_Counters &&)      = delete;
+  Host_Counters &operator=(const Host_Counters &) = delete;
+  Host_Counters &operator=(Host_Counters &&) = delete;
+
+  [[nodiscard]] bool available() const noexcept;
+  [[nodiscard]] const std::string &error() const noexcept { return m_error; }
+
+  // resets and starts counting
+  void start() noexcept;
+  void stop() noexcept;
+
+  // scaled up for the time the group wasn't scheduled, when other counters compete for the CPU's
+  [[nodiscard]] Reading read() const noexcept;
+
+private:
+  // the first counter that opened, the others are in its group
+  [[nodiscard]] int leader() const noexcept;
+
+  std::array<int, event_count> m_fds{ -1, -1, -1, -1 };
+  std::string m_error;
+};
+
+}  // namespace cpp_box
+
+#endif
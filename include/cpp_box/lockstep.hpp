@@ -0,0 +1,370 @@
+#ifndef CPP_BOX_LOCKSTEP_HPP
+#define CPP_BOX_LOCKSTEP_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "arm.hpp"
+
+namespace cpp_box::arm {
+
+// Runs `Lanes` instances of one program in lockstep, for sweeping a program over many inputs.
+//
+// Every lane is a full Scalar_System (use Paged_RAM to make them cheap), but while the lanes
+// agree on the PC their registers and flags live here, stored structure-of-arrays, and each
+// instruction is fetched and decoded once for all of them. Data_Processing instructions,
+// the bulk of most programs, run as plain loops across the lanes that the compiler turns into
+// vector operations; per lane conditions are applied as a mask. Everything else is handed to
+// each lane's own System. A lane whose PC stops matching the others is demoted and finishes
+// the run on its own in scalar mode.
+//
+// All lanes are assumed to be running the same code, instructions are fetched from the memory
+// of one of the lanes still in lockstep.
+template<typename Scalar_System, std::size_t Lanes> class Lockstep_System
+{
+public:
+  using Lane_Values = std::array<std::uint32_t, Lanes>;
+  using Lane_Mask   = std::array<bool, Lanes>;
+
+  explicit Lockstep_System(const Scalar_System &prototype) : m_lanes(Lanes, prototype) {}
+
+  // set up per lane inputs through here before running, and read results back after
+  [[nodiscard]] Scalar_System &lane(const std::size_t idx) noexcept { return m_lanes[idx]; }
+  [[nodiscard]] const Scalar_System &lane(const std::size_t idx) const noexcept { return m_lanes[idx]; }
+
+  [[nodiscard]] static constexpr std::size_t size() noexcept { return Lanes; }
+
+  // instructions executed in lockstep during the last run, summed over every lane
+  [[nodiscard]] std::uint64_t lockstep_instructions() const noexcept { return m_lockstep_instructions; }
+
+  // Runs every lane for at most `max_instructions`, equivalent to calling `run_for` on each lane
+  std::array<Run_Result, Lanes> run_for(const std::uint64_t max_instructions)
+  {
+    m_lockstep_instructions = 0;
+    for (std::size_t lane = 0; lane < Lanes; ++lane) {
+      m_results[lane] = { Stop_Reason::Budget_Exhausted, 0 };
+      m_state[lane]   = m_lanes[lane].operations_remaining() ? State::Lockstep : State::Finished;
+      if (m_state[lane] == State::Finished) { m_results[lane].reason = Stop_Reason::Exited; }
+
+      for (std::size_t reg = 0; reg < 16; ++reg) { m_registers[reg][lane] = m_lanes[lane].registers[reg]; }
+      m_cspr[lane] = m_lanes[lane].CSPR;
+    }
+
+    // lanes that don't start where most of them do never join in
+    converge();
+
+    for (std::uint64_t step = 0; step < max_instructions && m_leader != Lanes; ++step) { next_operation(); }
+
+    for (std::size_t lane = 0; lane < Lanes; ++lane) {
+      if (m_state[lane] == State::Lockstep) { store_lane(lane); }
+
+      if (m_state[lane] != State::Finished) {
+        auto &result       = m_results[lane];
+        const auto scalar  = m_lanes[lane].run_for(max_instructions - result.instructions);
+        result.reason      = scalar.reason;
+        result.instructions += scalar.instructions;
+      }
+    }
+
+    return m_results;
+  }
+
+private:
+  enum class State { Lockstep, Demoted, Finished };
+
+  static constexpr auto n_bit = static_cast<std::uint32_t>(Scalar_System::n_bit);
+  static constexpr auto z_bit = static_cast<std::uint32_t>(Scalar_System::z_bit);
+  static constexpr auto c_bit = static_cast<std::uint32_t>(Scalar_System::c_bit);
+  static constexpr auto v_bit = static_cast<std::uint32_t>(Scalar_System::v_bit);
+
+  void store_lane(const std::size_t lane) noexcept
+  {
+    for (std::size_t reg = 0; reg < 16; ++reg) { m_lanes[lane].registers[reg] = m_registers[reg][lane]; }
+    m_lanes[lane].CSPR = m_cspr[lane];
+  }
+
+  struct Register_List
+  {
+    std::array<std::uint32_t, 16> registers{};
+    std::size_t count{ 0 };
+  };
+
+  // Every register System::process can read or write for `ins`, the PC always among them. Only
+  // these have to be moved between the register file here and a lane's System to run it
+  // there, the System's copy of any other register is stale until the lane leaves lockstep.
+  [[nodiscard]] static constexpr Register_List touched_registers(const Instruction ins, const Instruction_Type type) noexcept
+  {
+    const auto reg    = [ins](const std::uint32_t lowest_bit) { return 1U << ((ins.data() >> lowest_bit) & 0b1111); };
+    constexpr auto pc = 1U << 15;
+
+    const auto mask = [&]() -> std::uint32_t {
+      switch (type) {
+      case Instruction_Type::Single_Data_Transfer:
+      case Instruction_Type::Single_Data_Swap: return pc | reg(16) | reg(12) | reg(0);
+      case Instruction_Type::Multiply_Long: return pc | reg(16) | reg(12) | reg(8) | reg(0);
+      case Instruction_Type::Load_And_Store_Multiple: return pc | reg(16) | (ins & 0xFFFF);
+      case Instruction_Type::Branch: return pc | (1U << 14);
+      default: return 0xFFFF;
+      }
+    }();
+
+    Register_List list;
+    for (std::uint32_t reg_num = 0; reg_num < 16; ++reg_num) {
+      if ((mask & (1U << reg_num)) != 0) { list.registers[list.count++] = reg_num; }
+    }
+    return list;
+  }
+
+  // true if the leader is still in lockstep and every other lane in lockstep is at its PC
+  [[nodiscard]] bool lanes_agree() const noexcept
+  {
+    if (m_leader == Lanes || m_state[m_leader] != State::Lockstep) { return false; }
+
+    bool agree = true;
+    for (std::size_t lane = 0; lane < Lanes; ++lane) {
+      agree &= m_state[lane] != State::Lockstep || m_registers[15][lane] == m_registers[15][m_leader];
+    }
+    return agree;
+  }
+
+  // follows the PC the most lanes agree on, demotes every other lane and retires them all if the program has returned
+  void converge() noexcept
+  {
+    // nearly always every lane took the same path, there's nothing to vote on
+    if (!lanes_agree()) {
+      m_leader               = Lanes;
+      std::size_t best_count = 0;
+      for (std::size_t lane = 0; lane < Lanes; ++lane) {
+        if (m_state[lane] != State::Lockstep) { continue; }
+
+        std::size_t count = 0;
+        for (std::size_t other = 0; other < Lanes; ++other) {
+          count += (m_state[other] == State::Lockstep && m_registers[15][other] == m_registers[15][lane]) ? 1U : 0U;
+        }
+
+        if (count > best_count) {
+          m_leader   = lane;
+          best_count = count;
+        }
+      }
+
+      if (m_leader == Lanes) { return; }
+
+      for (std::size_t lane = 0; lane < Lanes; ++lane) {
+        if (m_state[lane] == State::Lockstep && m_registers[15][lane] != m_registers[15][m_leader]) {
+          store_lane(lane);
+          m_state[lane] = State::Demoted;
+        }
+      }
+    }
+
+    auto &leader = m_lanes[m_leader];
+    leader.PC()  = m_registers[15][m_leader];
+    if (!leader.operations_remaining()) {
+      for (std::size_t lane = 0; lane < Lanes; ++lane) {
+        if (m_state[lane] != State::Lockstep) { continue; }
+        store_lane(lane);
+        m_state[lane]          = State::Finished;
+        m_results[lane].reason = Stop_Reason::Exited;
+      }
+      m_leader = Lanes;
+    }
+  }
+
+  void next_operation()
+  {
+    auto &leader           = m_lanes[m_leader];
+    const auto [ins, type] = leader.i_cache.fetch(m_registers[15][m_leader] - 4, leader);
+
+    Lane_Mask active{};
+    for (std::size_t lane = 0; lane < Lanes; ++lane) {
+      const bool lockstep = m_state[lane] == State::Lockstep;
+      m_results[lane].instructions += lockstep ? 1U : 0U;
+      m_lockstep_instructions += lockstep ? 1U : 0U;
+      active[lane] = lockstep && (ins.unconditional() || Scalar_System::check_condition(ins.get_condition(), m_cspr[lane]));
+    }
+
+    if (type == Instruction_Type::Data_Processing) {
+      // account for prefetch, as System::process does
+      for (auto &pc : m_registers[15]) { pc += 4; }
+      process(Data_Processing{ ins }, active);
+    } else {
+      const auto touched = touched_registers(ins, type);
+      for (std::size_t lane = 0; lane < Lanes; ++lane) {
+        if (m_state[lane] == State::Lockstep) { process_scalar(lane, ins, type, touched); }
+      }
+    }
+
+    converge();
+  }
+
+  // anything without a vector implementation is executed by the lane itself
+  void process_scalar(const std::size_t lane, const Instruction ins, const Instruction_Type type, const Register_List &touched)
+  {
+    auto &sys = m_lanes[lane];
+    for (std::size_t idx = 0; idx < touched.count; ++idx) { sys.registers[touched.registers[idx]] = m_registers[touched.registers[idx]][lane]; }
+    sys.CSPR        = m_cspr[lane];
+    sys.stop_reason = Stop_Reason::Budget_Exhausted;
+    sys.process(ins, type);
+    for (std::size_t idx = 0; idx < touched.count; ++idx) { m_registers[touched.registers[idx]][lane] = sys.registers[touched.registers[idx]]; }
+    m_cspr[lane] = sys.CSPR;
+
+    if (sys.stop_reason != Stop_Reason::Budget_Exhausted) {
+      // the lane leaves lockstep, its System needs the rest of the registers too
+      store_lane(lane);
+      m_state[lane]          = State::Finished;
+      m_results[lane].reason = sys.stop_reason;
+    }
+  }
+
+  void second_operand(const Data_Processing val, Lane_Values &operand, Lane_Mask &carry) const
+  {
+    if (val.immediate_operand()) {
+      const auto immediate = val.operand_2_immediate();
+      for (std::size_t lane = 0; lane < Lanes; ++lane) {
+        operand[lane] = immediate;
+        carry[lane]   = (m_cspr[lane] & c_bit) != 0;
+      }
+      return;
+    }
+
+    const auto &value = m_registers[val.operand_2_register()];
+    if (val.operand_2_immediate_shift() && val.operand_2_shift_type() == Shift_Type::Logical_Left && val.operand_2_shift_amount() == 0) {
+      // plain register operand, by far the most common case
+      for (std::size_t lane = 0; lane < Lanes; ++lane) {
+        operand[lane] = value[lane];
+        carry[lane]   = (m_cspr[lane] & c_bit) != 0;
+      }
+      return;
+    }
+
+    const auto &shift_register = m_registers[val.operand_2_shift_register()];
+    for (std::size_t lane = 0; lane < Lanes; ++lane) {
+      const auto shift_amount = val.operand_2_immediate_shift() ? val.operand_2_shift_amount() : 0xFF & shift_register[lane];
+      const auto [carry_out, result] =
+        m_lanes[m_leader].shift_register((m_cspr[lane] & c_bit) != 0, val.operand_2_shift_type(), shift_amount, value[lane]);
+      operand[lane] = result;
+      carry[lane]   = carry_out;
+    }
+  }
+
+  // the lane loops below mirror System::process(Data_Processing) exactly, with every write masked by `active`
+  template<typename Op>
+  void logical(const Lane_Mask &active,
+               const bool write,
+               const bool set_flags,
+               const Lane_Values &first_operand,
+               const Lane_Values &second_operand,
+               const Lane_Mask &carry_out,
+               Lane_Values &destination,
+               const Op op) noexcept
+  {
+    for (std::size_t lane = 0; lane < Lanes; ++lane) {
+      const std::uint32_t result = op(first_operand[lane], second_operand[lane]);
+
+      if (set_flags) {
+        const auto flags = (carry_out[lane] ? c_bit : 0) | (result == 0 ? z_bit : 0) | (result & n_bit);
+        m_cspr[lane]     = active[lane] ? ((m_cspr[lane] & ~(n_bit | z_bit | c_bit)) | flags) : m_cspr[lane];
+      }
+
+      if (write) { destination[lane] = active[lane] ? result : destination[lane]; }
+    }
+  }
+
+  template<typename Op>
+  void arithmetic(const Lane_Mask &active,
+                  const bool write,
+                  const bool set_flags,
+                  const bool invert_carry,
+                  const Lane_Values &first_operand,
+                  const Lane_Values &second_operand,
+                  Lane_Values &destination,
+                  const Op op) noexcept
+  {
+    for (std::size_t lane = 0; lane < Lanes; ++lane) {
+      const std::uint64_t carry  = (m_cspr[lane] & c_bit) != 0 ? 1U : 0U;
+      const std::uint64_t result = op(std::uint64_t{ first_operand[lane] }, std::uint64_t{ second_operand[lane] }, carry);
+      const auto low             = static_cast<std::uint32_t>(result);
+
+      if (set_flags) {
+        const bool carry_result  = (result & (1ull << 32)) != 0;
+        const auto signed_result = op(std::int64_t{ static_cast<std::int32_t>(first_operand[lane]) },
+                                      std::int64_t{ static_cast<std::int32_t>(second_operand[lane]) },
+                                      static_cast<std::int64_t>(carry));
+
+        const auto flags = (low & n_bit) | (low == 0 ? z_bit : 0) | (carry_result != invert_carry ? c_bit : 0)
+                           | (signed_result != static_cast<std::int32_t>(low) ? v_bit : 0);
+        m_cspr[lane] = active[lane] ? ((m_cspr[lane] & ~(n_bit | z_bit | c_bit | v_bit)) | flags) : m_cspr[lane];
+      }
+
+      if (write) { destination[lane] = active[lane] ? low : destination[lane]; }
+    }
+  }
+
+  void process(const Data_Processing val, const Lane_Mask &active)
+  {
+    const auto first_operand = m_registers[val.operand_1_register()];
+    Lane_Values second{};
+    Lane_Mask carry_out{};
+    second_operand(val, second, carry_out);
+
+    const auto destination_register = val.destination_register();
+    const bool set_flags            = val.set_condition_code() && destination_register != 15;
+    auto &destination               = m_registers[destination_register];
+
+    // keep each lane's timing policy up to date, this loop is empty for NO_TIMING
+    const auto opcode            = val.get_opcode();
+    const bool test_only         = opcode == OpCode::TST || opcode == OpCode::TEQ || opcode == OpCode::CMP || opcode == OpCode::CMN;
+    const bool shift_by_register = !val.immediate_operand() && !val.operand_2_immediate_shift();
+    const bool writes_pc         = destination_register == 15 && !test_only;
+    for (std::size_t lane = 0; lane < Lanes; ++lane) {
+      if (m_state[lane] != State::Lockstep) { continue; }
+      if (active[lane]) {
+        m_lanes[lane].timing.data_processing(shift_by_register, writes_pc);
+      } else {
+        m_lanes[lane].timing.condition_failed();
+      }
+    }
+
+    const auto lhs = [&](const bool write, const auto op) { logical(active, write, set_flags, first_operand, second, carry_out, destination, op); };
+    const auto math = [&](const bool write, const bool invert_carry, const auto op) {
+      arithmetic(active, write, set_flags, invert_carry, first_operand, second, destination, op);
+    };
+
+    switch (opcode) {
+    case OpCode::AND: return lhs(true, [](const auto op_1, const auto op_2) { return op_1 & op_2; });
+    case OpCode::EOR: return lhs(true, [](const auto op_1, const auto op_2) { return op_1 ^ op_2; });
+    case OpCode::TST: return lhs(false, [](const auto op_1, const auto op_2) { return op_1 & op_2; });
+    case OpCode::TEQ: return lhs(false, [](const auto op_1, const auto op_2) { return op_1 ^ op_2; });
+    case OpCode::ORR: return lhs(true, [](const auto op_1, const auto op_2) { return op_1 | op_2; });
+    case OpCode::MOV: return lhs(true, [](const auto, const auto op_2) { return op_2; });
+    case OpCode::BIC: return lhs(true, [](const auto op_1, const auto op_2) { return op_1 & (~op_2); });
+    case OpCode::MVN: return lhs(true, [](const auto, const auto op_2) { return ~op_2; });
+
+    case OpCode::SUB: return math(true, true, [](const auto op_1, const auto op_2, const auto) { return op_1 - op_2; });
+    case OpCode::RSB: return math(true, true, [](const auto op_1, const auto op_2, const auto) { return op_2 - op_1; });
+    case OpCode::ADD: return math(true, false, [](const auto op_1, const auto op_2, const auto) { return op_1 + op_2; });
+    case OpCode::ADC: return math(true, false, [](const auto op_1, const auto op_2, const auto c) { return op_1 + op_2 + c; });
+    case OpCode::SBC: return math(true, true, [](const auto op_1, const auto op_2, const auto c) { return op_1 - op_2 + c - 1; });
+    case OpCode::RSC: return math(true, true, [](const auto op_1, const auto op_2, const auto c) { return op_2 - op_1 + c - 1; });
+    case OpCode::CMP: return math(false, true, [](const auto op_1, const auto op_2, const auto) { return op_1 - op_2; });
+    case OpCode::CMN: return math(false, false, [](const auto op_1, const auto op_2, const auto) { return op_1 + op_2; });
+    }
+  }
+
+  std::vector<Scalar_System> m_lanes;
+
+  // structure-of-arrays register file, only meaningful for lanes in lockstep
+  std::array<Lane_Values, 16> m_registers{};
+  Lane_Values m_cspr{};
+
+  std::array<State, Lanes> m_state{};
+  std::array<Run_Result, Lanes> m_results{};
+  std::size_t m_leader{ Lanes };
+  std::uint64_t m_lockstep_instructions{ 0 };
+};
+
+}  // namespace cpp_box::arm
+
+#endif
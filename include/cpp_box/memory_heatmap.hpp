@@ -0,0 +1,76 @@
+#ifndef CPP_BOX_MEMORY_HEATMAP_HPP
+#define CPP_BOX_MEMORY_HEATMAP_HPP
+
+#include <array>
+#include <cstdint>
+
+#include "arm.hpp"
+
+namespace cpp_box::arm {
+
+// Memory_Hooks policy counting the guest's reads and writes to each 4KB page, which shows its
+// working set, how deep its stack goes and how much it draws to the screen. Every load and store
+// goes through here while it's in use, NO_MEMORY_HOOKS leaves nothing of it behind.
+template<std::size_t RAM_Size> class Page_Heatmap
+{
+public:
+  static constexpr std::uint32_t page_bits = 12;
+  static constexpr std::uint32_t page_size = 1U << page_bits;
+  static constexpr std::size_t page_count  = (RAM_Size + page_size - 1) >> page_bits;
+
+  // only counting, so stores don't have to read what they overwrite
+  static constexpr bool wants_old_value = false;
+
+  [[nodiscard]] constexpr bool is_hooked([[maybe_unused]] const std::uint32_t loc) const noexcept { return true; }
+
+  template<typename System>
+  constexpr void read([[maybe_unused]] System &sys,
+                      const std::uint32_t loc,
+                      [[maybe_unused]] const std::uint32_t size,
+                      [[maybe_unused]] const std::uint32_t value) noexcept
+  {
+    count(m_reads, loc);
+  }
+
+  template<typename System>
+  constexpr void write([[maybe_unused]] System &sys,
+                       const std::uint32_t loc,
+                       [[maybe_unused]] const std::uint32_t size,
+                       [[maybe_unused]] const std::uint32_t old_value,
+                       [[maybe_unused]] const std::uint32_t new_value) noexcept
+  {
+    count(m_writes, loc);
+  }
+
+  [[nodiscard]] constexpr std::uint64_t reads(const std::size_t page) const noexcept { return m_reads[page]; }
+  [[nodiscard]] constexpr std::uint64_t writes(const std::size_t page) const noexcept { return m_writes[page]; }
+
+  // pages read or written at least once
+  [[nodiscard]] constexpr std::size_t pages_touched() const noexcept
+  {
+    std::size_t touched = 0;
+    for (std::size_t page = 0; page < page_count; ++page) {
+      if (m_reads[page] != 0 || m_writes[page] != 0) { ++touched; }
+    }
+    return touched;
+  }
+
+  constexpr void reset_counts() noexcept
+  {
+    m_reads  = {};
+    m_writes = {};
+  }
+
+private:
+  static constexpr void count(std::array<std::uint64_t, page_count> &counts, const std::uint32_t loc) noexcept
+  {
+    if (const auto page = loc >> page_bits; page < page_count) { ++counts[page]; }
+  }
+
+  std::array<std::uint64_t, page_count> m_reads{};
+  std::array<std::uint64_t, page_count> m_writes{};
+};
+
+}  // namespace cpp_box::arm
+
+#endif
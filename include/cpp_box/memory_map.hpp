@@ -1,6 +1,8 @@
 #ifndef CPP_BOX_MEMORY_MAP_HPP
 #define CPP_BOX_MEMORY_MAP_HPP
 
+#include <cstdint>
+
 namespace cpp_box::system {
 
 constexpr static std::uint32_t TOTAL_RAM = 1024 * 1024 * 10;  // 10 MB
@@ -30,11 +32,28 @@ enum struct Memory_Map : std::uint32_t {
   // 0xA000B,  // 8bit Vertical aspect
   SCREEN_BUFFER  = REGISTER_START + 0x000C,  // 32bit pointer to current framebuffer
   RANDOM_DEVICE  = REGISTER_START + 0x0010,  // 32bits of random data
+  CORE_ID        = REGISTER_START + 0x0014,  // 32bit id of the core reading it, 0 is the core that runs the entry point
+  CORE_COUNT     = REGISTER_START + 0x0018,  // 32bit number of cores
+  CORE_START     = REGISTER_START + 0x0100,  // 32bit start address per core, at CORE_START + (4 * id). Every core but 0 is parked until
+  // its start address is written. It then runs from there with its own stack, and returning clears the address and parks the core again.
   USER_RAM_START = REGISTER_START + 0x1000,  // leave more space for registers, this is where binaries will load
 };
 
 constexpr static std::uint32_t DEFAULT_SCREEN_BUFFER = TOTAL_RAM - (1024 * 1024 * 2);  // by default VRAM is 2 MB from top
 constexpr static std::uint32_t STACK_START           = TOTAL_RAM - 1;
+constexpr static std::uint32_t MAX_CORES             = 32;
+constexpr static std::uint32_t CORE_STACK_SIZE       = 1024 * 64;  // core N's stack starts at STACK_START - (N * CORE_STACK_SIZE)
+
+// populate the hardware registers with the values a freshly loaded program expects
+template<typename System> constexpr void setup_hardware_registers(System &sys) noexcept
+{
+  sys.write_word(static_cast<std::uint32_t>(Memory_Map::RAM_SIZE), TOTAL_RAM);
+  sys.write_half_word(static_cast<std::uint32_t>(Memory_Map::SCREEN_WIDTH), 64);
+  sys.write_half_word(static_cast<std::uint32_t>(Memory_Map::SCREEN_HEIGHT), 64);
+  sys.write_byte(static_cast<std::uint32_t>(Memory_Map::SCREEN_BPP), 32);
+  sys.write_word(static_cast<std::uint32_t>(Memory_Map::SCREEN_BUFFER), DEFAULT_SCREEN_BUFFER);
+  sys.write_word(static_cast<std::uint32_t>(Memory_Map::CORE_COUNT), 1);
+}
 
 }  // namespace cpp_box
 
@@ -0,0 +1,141 @@
+#ifndef CPP_BOX_MMIO_HPP
+#define CPP_BOX_MMIO_HPP
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "memory_map.hpp"
+
+namespace cpp_box::system {
+
+// MMIO_Callback for RANDOM_DEVICE. The generator is held by value, so copying a System (to
+// rewind it, for instance) copies the numbers it will go on to read. std::mt19937's output is
+// fully specified by the standard, so a given seed produces the same numbers everywhere.
+struct Random_Device
+{
+  Random_Device() : Random_Device(std::random_device{}()) {}
+  explicit Random_Device(const std::uint32_t t_seed) : seed{ t_seed }, generator{ t_seed } {}
+
+  std::uint32_t seed;
+  mutable std::mt19937 generator;
+
+  [[nodiscard]] constexpr bool is_mmio_range(const std::uint32_t loc) const noexcept
+  {
+    return loc == static_cast<std::uint32_t>(Memory_Map::RANDOM_DEVICE);
+  }
+
+  [[nodiscard]] std::uint32_t read_word([[maybe_unused]] const std::uint32_t loc) const noexcept { return static_cast<std::uint32_t>(generator()); }
+  [[nodiscard]] std::uint16_t read_half_word([[maybe_unused]] const std::uint32_t loc) const noexcept
+  {
+    return static_cast<std::uint16_t>(generator());
+  }
+  [[nodiscard]] std::uint8_t read_byte([[maybe_unused]] const std::uint32_t loc) const noexcept { return static_cast<std::uint8_t>(generator()); }
+};
+
+// Every value a guest read from MMIO, in the order it read them. Values are stored in the width
+// they were read with and nothing else, replaying relies on the guest reading in the same order.
+struct MMIO_Log
+{
+  std::vector<std::uint8_t> data;
+
+  // appends at `position`, dropping anything previously recorded from there on
+  template<typename T> void record(std::size_t &position, const T value)
+  {
+    data.resize(position);
+    for (std::size_t byte = 0; byte < sizeof(T); ++byte) { data.push_back(static_cast<std::uint8_t>(value >> (byte * 8))); }
+    position += sizeof(T);
+  }
+
+  // nullopt once the log has been used up
+  template<typename T> [[nodiscard]] std::optional<T> replay(std::size_t &position) const noexcept
+  {
+    if (data.size() - position < sizeof(T)) { return std::nullopt; }
+
+    T value{};
+    for (std::size_t byte = 0; byte < sizeof(T); ++byte) { value = static_cast<T>(value | (T{ data[position++] } << (byte * 8))); }
+    return value;
+  }
+
+  [[nodiscard]] bool save(const std::filesystem::path &path) const;
+  [[nodiscard]] static std::optional<MMIO_Log> load(const std::filesystem::path &path);
+};
+
+// Written once at the start of an MMIO log file, followed by the raw log
+struct MMIO_Log_Header
+{
+  std::array<char, 8> magic{ 'C', 'P', 'P', 'B', 'O', 'X', 'I', 'O' };
+  std::uint32_t version{ 1 };
+  std::uint32_t reserved{ 0 };
+};
+
+enum class MMIO_Mode {
+  Live,    // reads go to the devices
+  Record,  // reads go to the devices and are appended to the log
+  Replay   // reads come from the log, the devices are never touched
+};
+
+// MMIO_Callback wrapping `Devices`, recording what the guest reads from them or replaying an
+// earlier recording, so that a run can be reproduced bit for bit. The read position is held by
+// value, so a copied (rewound) System picks up from its own point in the log.
+template<typename Devices> class Recorded_MMIO
+{
+public:
+  Recorded_MMIO() = default;
+  explicit Recorded_MMIO(Devices t_devices, const MMIO_Mode t_mode = MMIO_Mode::Live, std::shared_ptr<MMIO_Log> t_log = {})
+    : devices{ std::move(t_devices) }, mode{ t_log ? t_mode : MMIO_Mode::Live }, log{ std::move(t_log) }
+  {
+  }
+
+  Devices devices{};
+  MMIO_Mode mode{ MMIO_Mode::Live };
+  std::shared_ptr<MMIO_Log> log;
+
+  [[nodiscard]] constexpr bool is_mmio_range(const std::uint32_t loc) const noexcept { return devices.is_mmio_range(loc); }
+
+  [[nodiscard]] std::uint32_t read_word(const std::uint32_t loc) const noexcept
+  {
+    return read<std::uint32_t>([&] { return devices.read_word(loc); });
+  }
+  [[nodiscard]] std::uint16_t read_half_word(const std::uint32_t loc) const noexcept
+  {
+    return read<std::uint16_t>([&] { return devices.read_half_word(loc); });
+  }
+  [[nodiscard]] std::uint8_t read_byte(const std::uint32_t loc) const noexcept
+  {
+    return read<std::uint8_t>([&] { return devices.read_byte(loc); });
+  }
+
+  // a replay read more than was recorded, and from then on read 0s
+  [[nodiscard]] bool exhausted() const noexcept { return m_exhausted; }
+
+private:
+  template<typename T, typename Read> T read(Read &&device_read) const noexcept
+  {
+    switch (mode) {
+    case MMIO_Mode::Live: return device_read();
+    case MMIO_Mode::Record: {
+      const auto value = device_read();
+      log->record(m_position, value);
+      return value;
+    }
+    case MMIO_Mode::Replay:
+      if (const auto value = log->template replay<T>(m_position); value) { return *value; }
+      m_exhausted = true;
+      return 0;
+    }
+
+    return 0;
+  }
+
+  mutable std::size_t m_position{ 0 };
+  mutable bool m_exhausted{ false };
+};
+
+}  // namespace cpp_box::system
+
+#endif
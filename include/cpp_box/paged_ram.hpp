@@ -0,0 +1,148 @@
+#ifndef CPP_BOX_PAGED_RAM_HPP
+#define CPP_BOX_PAGED_RAM_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "arm.hpp"
+
+namespace cpp_box::arm {
+
+constexpr static std::size_t Page_Size = 4096;
+
+using Page = std::array<std::uint8_t, Page_Size>;
+
+// An immutable program image, split into pages and decoded once, which any number of
+// Paged_RAM instances can reference instead of holding their own copy
+struct Shared_Image
+{
+  explicit Shared_Image(const std::basic_string_view<std::uint8_t> image) : size{ image.size() }
+  {
+    for (std::size_t offset = 0; offset < image.size(); offset += Page_Size) {
+      auto page = std::make_shared<Page>();
+      std::memcpy(page->data(), &image[offset], std::min(Page_Size, image.size() - offset));
+      pages.push_back(std::move(page));
+    }
+
+    decoded.reserve((size + 3) / 4);
+    for (std::size_t offset = 0; offset < size; offset += 4) {
+      const auto &page           = *pages[offset / Page_Size];
+      const auto page_offset     = offset % Page_Size;
+      const std::uint32_t byte_1 = page[page_offset];
+      const std::uint32_t byte_2 = page[page_offset + 1];
+      const std::uint32_t byte_3 = page[page_offset + 2];
+      const std::uint32_t byte_4 = page[page_offset + 3];
+      decoded.push_back(System<>::decode(Instruction{ byte_1 | (byte_2 << 8) | (byte_3 << 16) | (byte_4 << 24) }));
+    }
+  }
+
+  std::size_t size;
+  // never written through, Paged_RAM copies a page before its first write to it
+  std::vector<std::shared_ptr<Page>> pages;
+  std::vector<Instruction_Type> decoded;
+};
+
+// Guest RAM made of copy-on-write pages. Untouched pages all share one zero page, pages of
+// an attached Shared_Image are shared with every other instance running that image, and a
+// page is only copied the first time the guest writes to it. Copying a Paged_RAM is cheap
+// and the copies go on to share every page until one of them writes.
+template<std::size_t RAM_Size> class Paged_RAM
+{
+public:
+  // mirrors the std::vector constructor System uses to create RAM; always zero filled
+  Paged_RAM(const std::size_t size, [[maybe_unused]] const std::uint8_t value) : m_pages((size + Page_Size - 1) / Page_Size, zero_page()) {}
+
+  [[nodiscard]] constexpr std::size_t size() const noexcept { return RAM_Size; }
+
+  [[nodiscard]] const std::uint8_t &operator[](const std::size_t loc) const noexcept { return (*m_pages[loc / Page_Size])[loc % Page_Size]; }
+
+  [[nodiscard]] std::uint8_t &operator[](const std::size_t loc) { return (*writable_page(loc / Page_Size))[loc % Page_Size]; }
+
+  // copies `count` bytes starting at `loc` into `dest`, a page at a time
+  void copy_out(std::size_t loc, std::uint8_t *dest, std::size_t count) const noexcept
+  {
+    while (count != 0) {
+      const auto offset = loc % Page_Size;
+      const auto length = std::min(count, Page_Size - offset);
+      std::memcpy(dest, &(*m_pages[loc / Page_Size])[offset], length);
+      loc += length;
+      dest += length;
+      count -= length;
+    }
+  }
+
+  // map `image` into the guest at `address` without copying it, returns how many bytes of
+  // it fit in RAM, anything past the end is dropped
+  std::size_t attach(const std::shared_ptr<const Shared_Image> &image, const std::uint32_t address)
+  {
+    const auto fits = address < RAM_Size ? std::min(image->size, RAM_Size - address) : std::size_t{ 0 };
+
+    if (address % Page_Size != 0) {
+      // pages can't be shared if they don't line up, fall back to copying
+      for (std::size_t offset = 0; offset < fits; ++offset) {
+        (*this)[address + offset] = (*image->pages[offset / Page_Size])[offset % Page_Size];
+      }
+      return fits;
+    }
+
+    for (std::size_t page = 0; page < image->pages.size() && (address / Page_Size) + page < m_pages.size(); ++page) {
+      m_pages[(address / Page_Size) + page] = image->pages[page];
+    }
+
+    m_image         = image;
+    m_image_address = address;
+    return fits;
+  }
+
+  // the shared decoding of the instruction at `loc`, if `loc` is still on an unmodified page of the attached image
+  [[nodiscard]] const Instruction_Type *predecoded(const std::uint32_t loc) const noexcept
+  {
+    // the image can run past the end of RAM, that part of it was never mapped
+    if (!m_image || loc < m_image_address || loc >= RAM_Size || loc % 4 != 0) { return nullptr; }
+
+    const auto offset = loc - m_image_address;
+    if (offset >= m_image->size || m_pages[loc / Page_Size] != m_image->pages[offset / Page_Size]) { return nullptr; }
+
+    return &m_image->decoded[offset / 4];
+  }
+
+  // calls `func` with every page this instance references, once for each place it's mapped
+  template<typename Func> void for_each_page(Func &&func) const
+  {
+    for (const auto &page : m_pages) { func(page.get()); }
+  }
+
+  // number of pages this instance has had to copy, ie, its own memory footprint
+  [[nodiscard]] std::size_t private_pages() const noexcept
+  {
+    return static_cast<std::size_t>(std::count_if(m_pages.begin(), m_pages.end(), [](const auto &page) { return page.use_count() == 1; }));
+  }
+
+private:
+  static const std::shared_ptr<Page> &zero_page()
+  {
+    static const auto page = std::make_shared<Page>();
+    return page;
+  }
+
+  // anything referenced from more than one place is shared and must be copied before writing
+  [[nodiscard]] const std::shared_ptr<Page> &writable_page(const std::size_t page)
+  {
+    auto &current = m_pages[page];
+    if (current.use_count() != 1) { current = std::make_shared<Page>(*current); }
+    return current;
+  }
+
+  std::vector<std::shared_ptr<Page>> m_pages;
+  std::shared_ptr<const Shared_Image> m_image;
+  std::uint32_t m_image_address{ 0 };
+};
+
+}  // namespace cpp_box::arm
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef CPP_BOX_PROFILER_HPP
+#define CPP_BOX_PROFILER_HPP
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "symbols.hpp"
+
+namespace cpp_box {
+
+struct Function_Samples
+{
+  std::string name;
+  std::uint64_t self{};   // samples taken in the function itself
+  std::uint64_t total{};  // samples taken in it or anything it called
+};
+
+// Guest call stacks sampled every so many instructions. Stacks are kept as raw addresses and
+// only named when reporting, so taking a sample never touches the symbol table.
+class Sampling_Profile
+{
+public:
+  // `stack` holds the sampled PC followed by the return address of each caller, innermost first
+  void add_sample(const std::vector<std::uint32_t> &stack) { ++m_stacks[stack]; }
+
+  [[nodiscard]] std::uint64_t sample_count() const noexcept;
+
+  // one line per distinct stack, "outer;inner count", for flamegraph.pl and compatible tools
+  void write_collapsed(std::ostream &os, const Symbol_Table &symbols) const;
+
+  // the `count` functions with the most samples of their own, busiest first, then by total and name
+  [[nodiscard]] std::vector<Function_Samples> top_functions(const Symbol_Table &symbols, const std::size_t count) const;
+
+private:
+  std::map<std::vector<std::uint32_t>, std::uint64_t> m_stacks;
+};
+
+}  // namespace cpp_box
+
+#endif
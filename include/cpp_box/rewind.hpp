@@ -0,0 +1,232 @@
+#ifndef CPP_BOX_REWIND_HPP
+#define CPP_BOX_REWIND_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "arm.hpp"
+#include "paged_ram.hpp"
+
+namespace cpp_box::arm {
+
+// storage made of pages that copies of it can share, listed via `for_each_page(func)`
+template<typename RAM_Type, typename = void> struct has_shared_pages : std::false_type
+{
+};
+template<typename RAM_Type>
+struct has_shared_pages<RAM_Type, std::void_t<decltype(std::declval<const RAM_Type &>().for_each_page(std::declval<void (*)(const Page *)>()))>>
+  : std::true_type
+{
+};
+template<typename RAM_Type> constexpr bool has_shared_pages_v = has_shared_pages<RAM_Type>::value;
+
+// Reverse execution for a System, by taking a checkpoint (a copy of the whole System) every
+// `interval()` instructions and re-executing forward from the closest one. Stepping back costs
+// at most one interval of instructions, no matter how long the guest has been running.
+//
+// Copies are cheap and share every page they don't write to when the System uses Paged_RAM,
+// and a page shared by several checkpoints only counts against the memory budget once.
+// Whenever the checkpoints go over their memory budget every other one is dropped and the
+// interval doubles, so memory use stays bounded and the checkpoints stay evenly spread.
+//
+// This relies on execution being deterministic, so any MMIO state must be copied along with
+// the System, and all forward execution has to go through `run_for` to be tracked.
+template<typename System> class Rewind_History
+{
+public:
+  explicit Rewind_History(const std::size_t memory_budget = 64 * 1024 * 1024, const std::uint64_t initial_interval = 100'000)
+    : m_memory_budget{ memory_budget }, m_initial_interval{ std::max<std::uint64_t>(initial_interval, 1) }, m_interval{ m_initial_interval }
+  {
+  }
+
+  // starts over with `sys` as instruction 0
+  void reset(const System &sys)
+  {
+    m_checkpoints.clear();
+    m_page_references.clear();
+    m_memory_used = 0;
+    m_interval    = m_initial_interval;
+    m_now         = 0;
+    add_checkpoint(sys);
+  }
+
+  // forwards to `sys.run_for`, taking checkpoints along the way. Re-executing while stepping back isn't traced.
+  template<typename Tracer = NO_TRACER> Run_Result run_for(System &sys, const std::uint64_t max_instructions, Tracer &&tracer = NO_TRACER{})
+  {
+    std::uint64_t executed = 0;
+    while (true) {
+      const auto next_checkpoint = (m_now / m_interval + 1) * m_interval;
+      const auto result          = sys.run_for(std::min(max_instructions - executed, next_checkpoint - m_now), tracer);
+      m_now += result.instructions;
+      executed += result.instructions;
+
+      if (m_now == next_checkpoint) { checkpoint(sys); }
+
+      if (result.reason != Stop_Reason::Budget_Exhausted || executed == max_instructions) { return { result.reason, executed }; }
+    }
+  }
+
+  // returns to just before the last instruction executed
+  bool step_back(System &sys)
+  {
+    if (m_now == 0) { return false; }
+
+    seek(sys, m_now - 1);
+    return true;
+  }
+
+  // returns to the last time a breakpoint was hit, or to the beginning if there was none
+  bool run_back_to_breakpoint(System &sys)
+  {
+    if (m_now == 0) { return false; }
+
+    for (auto end = m_now; end != 0;) {
+      const auto &from = *std::prev(std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), end - 1, [](const auto time, const auto &checkpoint) {
+        return time < checkpoint.time;
+      }));
+
+      std::optional<std::uint64_t> last_hit;
+      restore(sys, from);
+      replay(sys, end - from.time, [&](const auto time) { last_hit = time; });
+
+      if (last_hit) {
+        seek(sys, *last_hit);
+        // stop in front of the breakpoint, so continuing runs it
+        sys.run_for(1);
+        return true;
+      }
+
+      end = from.time;
+    }
+
+    seek(sys, 0);
+    return true;
+  }
+
+  // moves `sys` to just after instruction number `time`, which must not be in the future
+  void seek(System &sys, const std::uint64_t time)
+  {
+    if (time > m_now) { return; }
+
+    // anything after `time` is replaced as we run forward again
+    const auto later = std::upper_bound(
+      m_checkpoints.begin(), m_checkpoints.end(), time, [](const auto target, const auto &checkpoint) { return target < checkpoint.time; });
+    std::for_each(later, m_checkpoints.end(), [this](const auto &checkpoint) { release(checkpoint.system); });
+    m_checkpoints.erase(later, m_checkpoints.end());
+
+    restore(sys, m_checkpoints.back());
+    replay(sys, time - m_now, [](const auto /**/) {});
+  }
+
+  [[nodiscard]] std::uint64_t now() const noexcept { return m_now; }
+  [[nodiscard]] std::uint64_t interval() const noexcept { return m_interval; }
+  [[nodiscard]] std::size_t checkpoint_count() const noexcept { return m_checkpoints.size(); }
+
+  // the checkpoints themselves and every distinct page they hold on to
+  [[nodiscard]] std::size_t memory_used() const noexcept { return m_memory_used; }
+
+private:
+  struct Checkpoint
+  {
+    std::uint64_t time;
+    System system;
+  };
+
+  void add_checkpoint(const System &sys)
+  {
+    m_checkpoints.push_back({ m_now, sys });
+    m_memory_used += sizeof(System);
+    if constexpr (has_shared_pages_v<decltype(sys.builtin_ram)>) {
+      sys.builtin_ram.for_each_page([this](const Page *page) {
+        if (m_page_references[page]++ == 0) { m_memory_used += Page_Size; }
+      });
+    }
+  }
+
+  void release(const System &sys)
+  {
+    m_memory_used -= sizeof(System);
+    if constexpr (has_shared_pages_v<decltype(sys.builtin_ram)>) {
+      sys.builtin_ram.for_each_page([this](const Page *page) {
+        // every page was counted when its checkpoint was added
+        const auto references = m_page_references.find(page);
+        if (references == m_page_references.end()) { return; }
+        if (--references->second == 0) {
+          m_page_references.erase(references);
+          m_memory_used -= Page_Size;
+        }
+      });
+    }
+  }
+
+  void checkpoint(const System &sys)
+  {
+    if (m_checkpoints.back().time == m_now) { return; }
+
+    add_checkpoint(sys);
+
+    // always keep the beginning and the checkpoint we just took
+    while (m_checkpoints.size() > 2 && m_memory_used > m_memory_budget) {
+      const auto last  = m_checkpoints.size() - 1;
+      std::size_t kept = 1;
+      for (std::size_t idx = 1; idx <= last; ++idx) {
+        if (idx % 2 == 0 || idx == last) {
+          m_checkpoints[kept++] = std::move(m_checkpoints[idx]);
+        } else {
+          release(m_checkpoints[idx].system);
+        }
+      }
+      m_checkpoints.erase(std::next(m_checkpoints.begin(), static_cast<std::ptrdiff_t>(kept)), m_checkpoints.end());
+      m_interval *= 2;
+    }
+  }
+
+  // breakpoints are a property of the debugging session, not of the point in time
+  void restore(System &sys, const Checkpoint &checkpoint)
+  {
+    const auto breakpoints      = sys.breakpoints;
+    const auto breakpoint_count = sys.breakpoint_count;
+
+    sys                  = checkpoint.system;
+    sys.breakpoints      = breakpoints;
+    sys.breakpoint_count = breakpoint_count;
+    sys.i_cache.fill_cache(sys);
+
+    m_now = checkpoint.time;
+  }
+
+  // runs `count` instructions without stopping for breakpoints or watchpoints, reporting the time of each breakpoint passed
+  template<typename Func> void replay(System &sys, std::uint64_t count, Func &&on_breakpoint)
+  {
+    while (count != 0) {
+      const auto result = sys.run_for(count);
+      m_now += result.instructions;
+      count -= result.instructions;
+
+      if (result.reason == Stop_Reason::Breakpoint) {
+        on_breakpoint(m_now);
+      } else if (result.reason != Stop_Reason::Watchpoint) {
+        return;
+      }
+    }
+  }
+
+  std::size_t m_memory_budget;
+  std::uint64_t m_initial_interval;
+  std::uint64_t m_interval;
+  std::uint64_t m_now{ 0 };
+  std::vector<Checkpoint> m_checkpoints;
+
+  // how many times the checkpoints reference each page, so that a page is counted once however many share it
+  std::unordered_map<const Page *, std::size_t> m_page_references;
+  std::size_t m_memory_used{ 0 };
+};
+
+}  // namespace cpp_box::arm
+
+#endif
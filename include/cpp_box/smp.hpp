@@ -0,0 +1,275 @@
+#ifndef CPP_BOX_SMP_HPP
+#define CPP_BOX_SMP_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "arm.hpp"
+#include "memory_map.hpp"
+#include "mmio.hpp"
+
+namespace cpp_box::arm {
+
+// Guest RAM shared by every copy of it, so that several cores see the same memory.
+//
+// Every access is a single atomic operation on the word holding it, so cores running on
+// different host threads never race in the C++ sense and an aligned word or half word store
+// is never seen half done. Plain loads and stores are acquire / release: ARMv4 has no barrier
+// instructions, so guests expect one core's stores to show up on the others in order, eg
+// everything written inside a lock before the STR releasing it. SWP / SWPB are sequentially
+// consistent exchanges and are what the guest builds its locks from.
+template<std::size_t RAM_Size> class Shared_RAM
+{
+public:
+  // what indexing non-const memory returns, assigning to it stores a single byte
+  class Byte_Reference
+  {
+  public:
+    Byte_Reference(std::atomic<std::uint32_t> &word, const std::uint32_t shift) noexcept : m_word{ word }, m_shift{ shift } {}
+
+    // implicit, as it stands in for std::uint8_t &
+    operator std::uint8_t() const noexcept { return static_cast<std::uint8_t>(m_word.load(std::memory_order_acquire) >> m_shift); }
+
+    Byte_Reference &operator=(const std::uint8_t value) noexcept
+    {
+      update(m_word, 0xFFU << m_shift, std::uint32_t{ value } << m_shift, std::memory_order_release);
+      return *this;
+    }
+
+  private:
+    std::atomic<std::uint32_t> &m_word;
+    std::uint32_t m_shift;
+  };
+
+  // mirrors the std::vector constructor System uses to create RAM
+  Shared_RAM(const std::size_t size, const std::uint8_t value) : m_storage{ std::make_shared<Storage>(size, value) } {}
+
+  [[nodiscard]] constexpr std::size_t size() const noexcept { return RAM_Size; }
+
+  [[nodiscard]] Byte_Reference operator[](const std::size_t loc) noexcept { return { word(loc), shift(loc) }; }
+  [[nodiscard]] std::uint8_t operator[](const std::size_t loc) const noexcept
+  {
+    return static_cast<std::uint8_t>(word(loc).load(std::memory_order_acquire) >> shift(loc));
+  }
+
+  // System makes every word and half word access through these, an unaligned one is a single
+  // operation on each of the two words it spans
+  [[nodiscard]] std::uint32_t read_word(const std::uint32_t loc) const noexcept
+  {
+    const auto low = word(loc).load(std::memory_order_acquire);
+    if (loc % 4 == 0) { return low; }
+
+    const auto high = word(loc + 4).load(std::memory_order_acquire);
+    return (low >> shift(loc)) | (high << (32 - shift(loc)));
+  }
+
+  void write_word(const std::uint32_t loc, const std::uint32_t value) noexcept
+  {
+    if (loc % 4 == 0) {
+      word(loc).store(value, std::memory_order_release);
+      return;
+    }
+
+    update(word(loc), ~0U << shift(loc), value << shift(loc), std::memory_order_release);
+    update(word(loc + 4), ~0U >> (32 - shift(loc)), value >> (32 - shift(loc)), std::memory_order_release);
+  }
+
+  [[nodiscard]] std::uint16_t read_half_word(const std::uint32_t loc) const noexcept
+  {
+    if (loc % 4 == 3) { return static_cast<std::uint16_t>((*this)[loc] | ((*this)[loc + 1] << 8)); }
+    return static_cast<std::uint16_t>(word(loc).load(std::memory_order_acquire) >> shift(loc));
+  }
+
+  void write_half_word(const std::uint32_t loc, const std::uint16_t value) noexcept
+  {
+    if (loc % 4 == 3) {
+      (*this)[loc]     = static_cast<std::uint8_t>(value & 0xFF);
+      (*this)[loc + 1] = static_cast<std::uint8_t>((value >> 8) & 0xFF);
+      return;
+    }
+    update(word(loc), 0xFFFFU << shift(loc), std::uint32_t{ value } << shift(loc), std::memory_order_release);
+  }
+
+  [[nodiscard]] std::uint32_t exchange_word(const std::uint32_t loc, const std::uint32_t value)
+  {
+    if (loc % 4 == 0) { return word(loc).exchange(value); }
+
+    // an unaligned swap spans two words and can't be one operation, it is only atomic with
+    // respect to other unaligned swaps
+    std::lock_guard<std::mutex> lock{ m_storage->unaligned_exchange_mutex };
+    std::uint32_t original = 0;
+    for (std::uint32_t byte = 0; byte < 4; ++byte) {
+      original |= std::uint32_t{ exchange_byte(loc + byte, static_cast<std::uint8_t>(value >> (byte * 8))) } << (byte * 8);
+    }
+    return original;
+  }
+
+  [[nodiscard]] std::uint8_t exchange_byte(const std::uint32_t loc, const std::uint8_t value)
+  {
+    return static_cast<std::uint8_t>(update(word(loc), 0xFFU << shift(loc), std::uint32_t{ value } << shift(loc), std::memory_order_seq_cst) >> shift(loc));
+  }
+
+private:
+  struct Storage
+  {
+    Storage(const std::size_t size, const std::uint8_t value) : words((size + 3) / 4)
+    {
+      for (auto &elem : words) { elem.store(std::uint32_t{ value } * 0x01010101U, std::memory_order_relaxed); }
+    }
+
+    std::vector<std::atomic<std::uint32_t>> words;
+    std::mutex unaligned_exchange_mutex;
+  };
+
+  [[nodiscard]] std::atomic<std::uint32_t> &word(const std::size_t loc) const noexcept { return m_storage->words[loc / 4]; }
+  [[nodiscard]] static constexpr std::uint32_t shift(const std::size_t loc) noexcept { return static_cast<std::uint32_t>(loc % 4) * 8; }
+
+  // replaces the bits of `word` in `mask` with `bits`, returning the word as it was before
+  static std::uint32_t update(std::atomic<std::uint32_t> &word, const std::uint32_t mask, const std::uint32_t bits, const std::memory_order order) noexcept
+  {
+    auto expected = word.load(std::memory_order_relaxed);
+    while (!word.compare_exchange_weak(expected, (expected & ~mask) | bits, order, std::memory_order_relaxed)) {}
+    return expected;
+  }
+
+  std::shared_ptr<Storage> m_storage;
+};
+
+// The per core hardware registers, and the core's own random device, so that no generator is
+// shared between host threads
+struct Core_Registers
+{
+  std::uint32_t id{ 0 };
+  std::uint32_t count{ 1 };
+  system::Random_Device random{ 0 };
+
+  [[nodiscard]] constexpr bool is_mmio_range(const std::uint32_t loc) const noexcept
+  {
+    return loc == static_cast<std::uint32_t>(system::Memory_Map::CORE_ID) || loc == static_cast<std::uint32_t>(system::Memory_Map::CORE_COUNT)
+           || random.is_mmio_range(loc);
+  }
+
+  [[nodiscard]] std::uint32_t read_word(const std::uint32_t loc) const noexcept
+  {
+    if (random.is_mmio_range(loc)) { return random.read_word(loc); }
+    return loc == static_cast<std::uint32_t>(system::Memory_Map::CORE_ID) ? id : count;
+  }
+  [[nodiscard]] std::uint16_t read_half_word(const std::uint32_t loc) const noexcept
+  {
+    if (random.is_mmio_range(loc)) { return random.read_half_word(loc); }
+    return static_cast<std::uint16_t>(read_word(loc));
+  }
+  [[nodiscard]] std::uint8_t read_byte(const std::uint32_t loc) const noexcept
+  {
+    if (random.is_mmio_range(loc)) { return random.read_byte(loc); }
+    return static_cast<std::uint8_t>(read_word(loc));
+  }
+};
+
+// Several ARM cores sharing one RAM, each driven by its own host thread.
+//
+// Core 0 runs the entry point. The others are parked until the guest writes a start address
+// into their CORE_START slot, see Memory_Map. The whole machine stops when core 0 does.
+//
+// Core n's random device is seeded with `seed + n`. Each core's numbers repeat for a given
+// seed, but how the cores interleave, and so what the guest makes of them, doesn't.
+template<std::size_t RAM_Size> class SMP_System
+{
+public:
+  using Core = System<RAM_Size, Shared_RAM<RAM_Size>, Core_Registers>;
+
+  // how many instructions a running core executes between checks for the machine stopping
+  static constexpr std::uint64_t instructions_per_slice = 100'000;
+
+  template<typename Container>
+  SMP_System(const Container &image,
+             const std::uint32_t load_address,
+             const std::size_t core_count,
+             const std::uint32_t seed = std::random_device{}())
+  {
+    const auto count = static_cast<std::uint32_t>(std::clamp<std::size_t>(core_count, 1, system::MAX_CORES));
+
+    m_cores.push_back(std::make_unique<Core>(image, load_address, Core_Registers{ 0, count, system::Random_Device{ seed } }));
+    for (std::uint32_t id = 1; id < count; ++id) {
+      auto core           = std::make_unique<Core>();
+      core->builtin_ram   = m_cores.front()->builtin_ram;
+      core->mmio_callback = Core_Registers{ id, count, system::Random_Device{ seed + id } };
+      core->i_cache.fill_cache(*core);
+      m_cores.push_back(std::move(core));
+    }
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept { return m_cores.size(); }
+
+  [[nodiscard]] Core &core(const std::size_t id) noexcept { return *m_cores[id]; }
+  [[nodiscard]] const Core &core(const std::size_t id) const noexcept { return *m_cores[id]; }
+
+  // Runs core 0 from `entry_point` for at most `max_instructions`, and every other core for
+  // at most `max_instructions` in total while it does. Returns how each core stopped.
+  std::vector<Run_Result> run(const std::uint32_t entry_point, const std::uint64_t max_instructions)
+  {
+    std::vector<Run_Result> results(m_cores.size(), Run_Result{ Stop_Reason::Exited, 0 });
+    std::atomic<bool> stopping{ false };
+
+    std::vector<std::thread> threads;
+    for (std::size_t id = 1; id < m_cores.size(); ++id) {
+      threads.emplace_back([&, id] { results[id] = run_secondary(id, stopping, max_instructions); });
+    }
+
+    auto &boot = core(0);
+    boot.setup_run(entry_point);
+    results[0] = boot.run_for(max_instructions);
+
+    stopping = true;
+    for (auto &thread : threads) { thread.join(); }
+
+    return results;
+  }
+
+private:
+  Run_Result run_secondary(const std::size_t id, const std::atomic<bool> &stopping, const std::uint64_t max_instructions)
+  {
+    auto &sys          = core(id);
+    const auto mailbox = static_cast<std::uint32_t>(system::Memory_Map::CORE_START) + static_cast<std::uint32_t>(id * 4);
+
+    Run_Result total{ Stop_Reason::Exited, 0 };
+
+    while (!stopping) {
+      const auto start = sys.read_word(mailbox);
+      if (start == 0) {
+        std::this_thread::yield();
+        continue;
+      }
+
+      sys.setup_run(start);
+      sys.SP() -= static_cast<std::uint32_t>(id) * system::CORE_STACK_SIZE;
+
+      do {
+        const auto result = sys.run_for(std::min(instructions_per_slice, max_instructions - total.instructions));
+        total.instructions += result.instructions;
+        total.reason = result.reason;
+      } while (total.reason == Stop_Reason::Budget_Exhausted && total.instructions < max_instructions && !stopping);
+
+      // out of budget or broken, this core is done for good
+      if (total.reason != Stop_Reason::Exited) { return total; }
+
+      // let the guest know we've finished, and wait to be started again
+      sys.write_word(mailbox, 0);
+    }
+
+    return total;
+  }
+
+  std::vector<std::unique_ptr<Core>> m_cores;
+};
+
+}  // namespace cpp_box::arm
+
+#endif
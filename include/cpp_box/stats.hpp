@@ -0,0 +1,98 @@
+#ifndef CPP_BOX_STATS_HPP
+#define CPP_BOX_STATS_HPP
+
+#include <array>
+#include <cstdint>
+#include <utility>
+
+#include "arm.hpp"
+
+namespace cpp_box::arm {
+
+// Stats policy counting I-cache behavior, MMIO reads per device register, out of range writes
+// and instructions per Instruction_Type. Meant to be collected and reset after every run_for,
+// `+=` adds a slice onto a running total.
+//
+// Every instruction costs an increment of its type's counter, which is why it's opt-in.
+struct Emulator_Stats
+{
+  static constexpr std::size_t instruction_types = static_cast<std::size_t>(Instruction_Type::Breakpoint) + 1;
+  static constexpr std::size_t max_mmio_registers = 16;
+
+  std::uint64_t fetches{ 0 };
+  std::uint64_t cache_misses{ 0 };
+  std::uint64_t cache_refills{ 0 };  // misses, as well as arming breakpoints and restoring checkpoints
+  std::uint64_t invalid_writes{ 0 };
+  std::array<std::uint64_t, instruction_types> instructions{};
+  // (address, reads) in address order. A guest only uses a handful of device registers, reads
+  // from any past the first `max_mmio_registers` are only counted in `other_mmio_reads`.
+  std::array<std::pair<std::uint32_t, std::uint64_t>, max_mmio_registers> mmio_reads{};
+  std::size_t mmio_registers{ 0 };
+  std::uint64_t other_mmio_reads{ 0 };
+
+  // fetches made through `next_operation` outside of run_for aren't reported
+  [[nodiscard]] constexpr std::uint64_t cache_hits() const noexcept { return fetches > cache_misses ? fetches - cache_misses : 0; }
+
+  [[nodiscard]] constexpr std::uint64_t instruction_count(const Instruction_Type type) const noexcept
+  {
+    return instructions[static_cast<std::size_t>(type)];
+  }
+
+  constexpr void run_slice(const std::uint64_t slice_fetches) noexcept { fetches += slice_fetches; }
+  constexpr void instruction(const Instruction_Type type) noexcept { ++instructions[static_cast<std::size_t>(type)]; }
+  constexpr void cache_miss() noexcept { ++cache_misses; }
+  constexpr void cache_refill() noexcept { ++cache_refills; }
+  constexpr void invalid_write([[maybe_unused]] const std::uint32_t loc) noexcept { ++invalid_writes; }
+
+  void mmio_read(const std::uint32_t loc) noexcept { add_mmio_reads(loc, 1); }
+
+  // calls `func(address, reads)` for each device register read from, in address order
+  template<typename Func> constexpr void for_each_mmio_register(Func &&func) const
+  {
+    for (std::size_t idx = 0; idx < mmio_registers; ++idx) { func(mmio_reads[idx].first, mmio_reads[idx].second); }
+  }
+
+  [[nodiscard]] constexpr std::uint64_t mmio_reads_from(const std::uint32_t loc) const noexcept
+  {
+    for (std::size_t idx = 0; idx < mmio_registers; ++idx) {
+      if (mmio_reads[idx].first == loc) { return mmio_reads[idx].second; }
+    }
+    return 0;
+  }
+
+  Emulator_Stats &operator+=(const Emulator_Stats &other) noexcept
+  {
+    fetches += other.fetches;
+    cache_misses += other.cache_misses;
+    cache_refills += other.cache_refills;
+    invalid_writes += other.invalid_writes;
+    for (std::size_t type = 0; type < instruction_types; ++type) { instructions[type] += other.instructions[type]; }
+    other.for_each_mmio_register([this](const std::uint32_t loc, const std::uint64_t reads) { add_mmio_reads(loc, reads); });
+    other_mmio_reads += other.other_mmio_reads;
+    return *this;
+  }
+
+  void reset() noexcept { *this = Emulator_Stats{}; }
+
+private:
+  // never allocates, it's called from the noexcept memory reads
+  void add_mmio_reads(const std::uint32_t loc, const std::uint64_t reads) noexcept
+  {
+    std::size_t idx = 0;
+    while (idx < mmio_registers && mmio_reads[idx].first < loc) { ++idx; }
+
+    if (idx < mmio_registers && mmio_reads[idx].first == loc) {
+      mmio_reads[idx].second += reads;
+    } else if (mmio_registers == max_mmio_registers) {
+      other_mmio_reads += reads;
+    } else {
+      for (auto slot = mmio_registers; slot > idx; --slot) { mmio_reads[slot] = mmio_reads[slot - 1]; }
+      mmio_reads[idx] = { loc, reads };
+      ++mmio_registers;
+    }
+  }
+};
+
+}  // namespace cpp_box::arm
+
+#endif
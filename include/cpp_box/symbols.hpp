@@ -0,0 +1,50 @@
+#ifndef CPP_BOX_SYMBOLS_HPP
+#define CPP_BOX_SYMBOLS_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cpp_box::elf {
+struct File_Header;
+}  // namespace cpp_box::elf
+
+namespace cpp_box {
+
+struct Symbol
+{
+  std::string name;
+  std::uint32_t start{};
+  std::uint32_t size{};
+
+  [[nodiscard]] constexpr bool contains(const std::uint32_t address) const noexcept { return address >= start && address - start < size; }
+};
+
+// The function symbols of an ELF file, by the guest address they were loaded at
+class Symbol_Table
+{
+public:
+  Symbol_Table() = default;
+
+  // `load_address` is where the start of the file was loaded, the way `load_unknown` loads it
+  Symbol_Table(const elf::File_Header &file_header, const std::uint32_t load_address);
+
+  // functions already placed in memory, in any order
+  explicit Symbol_Table(std::vector<Symbol> symbols);
+
+  // the function containing `address`, if any
+  [[nodiscard]] const Symbol *lookup(const std::uint32_t address) const noexcept;
+
+  // "name+0xoffset", or just the address if it isn't in any function
+  [[nodiscard]] std::string describe(const std::uint32_t address) const;
+
+  [[nodiscard]] const std::vector<Symbol> &symbols() const noexcept { return m_symbols; }
+
+private:
+  // sorted by start address
+  std::vector<Symbol> m_symbols;
+};
+
+}  // namespace cpp_box
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef CPP_BOX_THREAD_POOL_HPP
+#define CPP_BOX_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cpp_box::utility {
+
+// Fixed size pool of worker threads. Every worker owns a queue, works from the back of
+// its own queue and steals from the front of the others' when it runs dry, so long and
+// short jobs mixed in one batch still keep every core busy.
+class Work_Stealing_Pool
+{
+public:
+  explicit Work_Stealing_Pool(const std::size_t thread_count = std::thread::hardware_concurrency());
+  ~Work_Stealing_Pool();
+
+  Work_Stealing_Pool(Work_Stealing_Pool &&)      = delete;
+  Work_Stealing_Pool(const Work_Stealing_Pool &) = delete;
+  Work_Stealing_Pool &operator=(const Work_Stealing_Pool &) = delete;
+  Work_Stealing_Pool &operator=(Work_Stealing_Pool &&) = delete;
+
+  void submit(std::function<void()> job);
+
+  // blocks until every submitted job has finished
+  void wait();
+
+  [[nodiscard]] std::size_t size() const noexcept { return m_threads.size(); }
+
+private:
+  struct Queue
+  {
+    std::mutex mutex;
+    std::deque<std::function<void()>> jobs;
+  };
+
+  [[nodiscard]] bool try_claim() noexcept;
+  [[nodiscard]] bool try_pop(const std::size_t worker, std::function<void()> &job);
+  void worker_loop(const std::size_t worker);
+
+  std::vector<Queue> m_queues;
+  std::vector<std::thread> m_threads;
+
+  // the counters are atomic so that submitting and finishing jobs don't contend on one lock,
+  // m_mutex is only taken to sleep on and to wake the condition variables
+  std::mutex m_mutex;
+  std::condition_variable m_work_available;
+  std::condition_variable m_all_done;
+  std::atomic<std::size_t> m_queued{ 0 };
+  std::atomic<std::size_t> m_unfinished{ 0 };
+  std::atomic<std::size_t> m_sleeping{ 0 };
+  std::atomic<std::size_t> m_next_queue{ 0 };
+  bool m_shutdown{ false };  // guarded by m_mutex
+};
+
+}  // namespace cpp_box::utility
+
+#endif
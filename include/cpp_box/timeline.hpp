@@ -0,0 +1,81 @@
+#ifndef CPP_BOX_TIMELINE_HPP
+#define CPP_BOX_TIMELINE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace cpp_box {
+
+// Records how long the stages of building and running a program take, from any thread, to be
+// written out in the Chrome trace_event format that chrome://tracing and Perfetto load. Nothing
+// is recorded, and scopes cost next to nothing, until it's enabled.
+class Timeline
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  // a "complete" event covering the scope's lifetime
+  class Scope
+  {
+  public:
+    Scope(Timeline &t_timeline, std::string_view t_name, std::string_view t_category);
+    ~Scope();
+
+    Scope(const Scope &) = delete;
+    Scope(Scope &&)      = delete;
+    Scope &operator=(const Scope &) = delete;
+    Scope &operator=(Scope &&) = delete;
+
+  private:
+    Timeline &timeline;
+    std::string_view name;
+    std::string_view category;
+    Clock::time_point start;
+  };
+
+  void enable() noexcept { m_enabled = true; }
+  [[nodiscard]] bool enabled() const noexcept { return m_enabled; }
+
+  void complete(std::string_view name, std::string_view category, Clock::time_point start, Clock::time_point end);
+  // something that happened at one point in time, like a key press
+  void instant(std::string_view name, std::string_view category);
+
+  [[nodiscard]] bool write(const std::filesystem::path &path) const;
+
+private:
+  struct Event
+  {
+    std::string name;
+    std::string category;
+    char phase;
+    std::int64_t timestamp;  // microseconds since m_epoch
+    std::int64_t duration;
+    std::uint32_t thread;
+  };
+
+  [[nodiscard]] std::int64_t since_epoch(Clock::time_point time) const noexcept;
+  // the caller's thread, numbered in the order threads first showed up, must hold m_mutex
+  [[nodiscard]] std::uint32_t thread_number();
+
+  std::atomic<bool> m_enabled{ false };
+  Clock::time_point m_epoch{ Clock::now() };
+
+  mutable std::mutex m_mutex;
+  std::vector<Event> m_events;
+  std::map<std::thread::id, std::uint32_t> m_threads;
+};
+
+// the process wide timeline, so that library code can be instrumented without passing it around
+[[nodiscard]] Timeline &timeline() noexcept;
+
+}  // namespace cpp_box
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef CPP_BOX_TIMING_HPP
+#define CPP_BOX_TIMING_HPP
+
+#include <cstdint>
+
+namespace cpp_box::arm {
+
+// Timing policy modeling the ARM7TDMI, per the instruction cycle timings in its datasheet.
+//
+// S (sequential) and N (non-sequential) cycles are memory accesses, I (internal) cycles are
+// not. `cycles()` weights them with the wait states of the memory system being modeled,
+// which default to zero wait state memory.
+struct ARM7TDMI_Timing
+{
+  std::uint64_t s_cycles{ 0 };
+  std::uint64_t n_cycles{ 0 };
+  std::uint64_t i_cycles{ 0 };
+
+  std::uint32_t s_wait_states{ 0 };
+  std::uint32_t n_wait_states{ 0 };
+
+  [[nodiscard]] constexpr std::uint64_t cycles() const noexcept
+  {
+    return (s_cycles * (1 + s_wait_states)) + (n_cycles * (1 + n_wait_states)) + i_cycles;
+  }
+
+  // the instruction is still fetched
+  constexpr void condition_failed() noexcept { s_cycles += 1; }
+
+  constexpr void data_processing(const bool shift_by_register, const bool writes_pc) noexcept
+  {
+    s_cycles += 1;
+    if (shift_by_register) { i_cycles += 1; }
+    if (writes_pc) { refill_pipeline(); }
+  }
+
+  constexpr void branch() noexcept
+  {
+    s_cycles += 1;
+    refill_pipeline();
+  }
+
+  constexpr void single_data_transfer(const bool load, const bool writes_pc) noexcept
+  {
+    if (load) {
+      s_cycles += 1;
+      n_cycles += 1;
+      i_cycles += 1;
+      if (writes_pc) { refill_pipeline(); }
+    } else {
+      n_cycles += 2;
+    }
+  }
+
+  constexpr void block_data_transfer(const bool load, const std::uint32_t register_count, const bool writes_pc) noexcept
+  {
+    if (load) {
+      s_cycles += register_count;
+      n_cycles += 1;
+      i_cycles += 1;
+      if (writes_pc) { refill_pipeline(); }
+    } else {
+      s_cycles += register_count > 0 ? register_count - 1 : 0;
+      n_cycles += 2;
+    }
+  }
+
+  constexpr void single_data_swap() noexcept
+  {
+    s_cycles += 1;
+    n_cycles += 2;
+    i_cycles += 1;
+  }
+
+  constexpr void multiply_long(const bool accumulate, const bool unsigned_mul, const std::uint32_t multiplier) noexcept
+  {
+    s_cycles += 1;
+    i_cycles += multiplier_cycles(unsigned_mul, multiplier) + (accumulate ? 2 : 1);
+  }
+
+  // The multiplier array handles 8 bits of the multiplier per cycle and terminates early
+  // once the remaining bits are all zero (or, for signed multiplies, all one)
+  [[nodiscard]] static constexpr std::uint32_t multiplier_cycles(const bool unsigned_mul, const std::uint32_t multiplier) noexcept
+  {
+    for (std::uint32_t m = 1; m < 4; ++m) {
+      const auto remaining = multiplier >> (8 * m);
+      if (remaining == 0 || (!unsigned_mul && remaining == (0xFFFFFFFFu >> (8 * m)))) { return m; }
+    }
+    return 4;
+  }
+
+private:
+  // a write to the PC throws away the prefetched instructions
+  constexpr void refill_pipeline() noexcept
+  {
+    s_cycles += 1;
+    n_cycles += 1;
+  }
+};
+
+}  // namespace cpp_box::arm
+
+#endif
@@ -0,0 +1,193 @@
+#ifndef CPP_BOX_TRACE_HPP
+#define CPP_BOX_TRACE_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include "arm.hpp"
+
+namespace cpp_box::arm {
+
+// One executed instruction, as stored in a binary trace file
+struct Trace_Record
+{
+  static constexpr std::uint8_t no_register = 0xFF;
+
+  std::uint32_t pc;
+  std::uint32_t instruction;
+  std::uint32_t address;           // memory accessed by a load / store / swap, or the base of a block transfer, if has_address
+  std::uint32_t register_value;    // the new value of changed_register
+  std::uint8_t changed_register;   // the lowest numbered of r0-r14 the instruction changed, or no_register
+  std::uint8_t has_address;
+  std::array<std::uint8_t, 2> reserved;
+};
+
+static_assert(sizeof(Trace_Record) == 20);
+
+// Written once at the start of a trace file, followed by nothing but records in host byte order
+struct Trace_Header
+{
+  std::array<char, 8> magic{ 'C', 'P', 'P', 'B', 'O', 'X', 'T', 'R' };
+  std::uint32_t version{ 1 };
+  std::uint32_t record_size{ sizeof(Trace_Record) };
+};
+
+// Lock-free single producer / single consumer ring buffer. The producer only publishes its
+// progress every `Publish_Interval` pushes, so the two threads aren't fighting over a cache
+// line on every record.
+template<typename T, std::size_t Capacity, std::size_t Publish_Interval = 256> class SPSC_Ring
+{
+  static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+  static_assert(Capacity % Publish_Interval == 0);
+
+public:
+  // producer side, waits for room if the consumer has fallen behind
+  void push(const T &value) noexcept
+  {
+    if (m_produced - m_consumed_cache == Capacity) {
+      publish();
+      while (m_produced - (m_consumed_cache = m_consumed.load(std::memory_order_acquire)) == Capacity) { std::this_thread::yield(); }
+    }
+
+    m_buffer[m_produced & (Capacity - 1)] = value;
+    if ((++m_produced % Publish_Interval) == 0) { publish(); }
+  }
+
+  // producer side, makes everything pushed so far visible to the consumer
+  void publish() noexcept { m_published.store(m_produced, std::memory_order_release); }
+
+  // consumer side, hands every contiguous run of published values to `f(const T *, std::size_t)`
+  template<typename Func> std::size_t drain(Func &&f)
+  {
+    const auto published = m_published.load(std::memory_order_acquire);
+    auto consumed        = m_consumed.load(std::memory_order_relaxed);
+    const auto available = published - consumed;
+
+    while (consumed != published) {
+      const auto start = consumed & (Capacity - 1);
+      const auto count = std::min(published - consumed, Capacity - start);
+      f(&m_buffer[start], count);
+      consumed += count;
+    }
+
+    m_consumed.store(consumed, std::memory_order_release);
+    return available;
+  }
+
+private:
+  alignas(64) std::atomic<std::size_t> m_published{ 0 };
+  alignas(64) std::atomic<std::size_t> m_consumed{ 0 };
+
+  // only touched by the producer
+  alignas(64) std::size_t m_produced{ 0 };
+  std::size_t m_consumed_cache{ 0 };
+
+  std::vector<T> m_buffer = std::vector<T>(Capacity);
+};
+
+// Writes Trace_Records to a file from a background thread
+class Binary_Trace_Writer
+{
+public:
+  explicit Binary_Trace_Writer(const std::filesystem::path &path);
+  ~Binary_Trace_Writer();
+
+  Binary_Trace_Writer(Binary_Trace_Writer &&)      = delete;
+  Binary_Trace_Writer(const Binary_Trace_Writer &) = delete;
+  Binary_Trace_Writer &operator=(const Binary_Trace_Writer &) = delete;
+  Binary_Trace_Writer &operator=(Binary_Trace_Writer &&) = delete;
+
+  void push(const Trace_Record &record) noexcept { m_ring.push(record); }
+
+  // makes sure everything pushed so far gets written, without waiting for it
+  void flush() noexcept { m_ring.publish(); }
+
+  [[nodiscard]] bool good() const noexcept { return m_good; }
+
+private:
+  void write_loop();
+
+  std::ofstream m_file;
+  bool m_good{ false };
+  SPSC_Ring<Trace_Record, 1 << 16> m_ring;
+  std::atomic<bool> m_done{ false };
+  std::thread m_thread;
+};
+
+// Tracer that records every instruction to a Binary_Trace_Writer.
+//
+// Which register an instruction changed is only known once it has executed, so each record
+// is completed by the following call, and the last one by `finish`.
+class Binary_Tracer
+{
+public:
+  explicit Binary_Tracer(Binary_Trace_Writer &writer) noexcept : m_writer{ writer } {}
+
+  template<typename System> void operator()(const System &sys, const std::uint32_t pc, const Instruction ins) noexcept
+  {
+    complete(sys.registers);
+
+    m_pending = Trace_Record{ pc, ins.data(), 0, 0, Trace_Record::no_register, 0, {} };
+    if (sys.check_condition(ins)) {
+      // the PC reads 8 ahead of the executing instruction, we're called when it's 4 ahead
+      const auto base = [&](const auto reg) { return reg == 15 ? sys.PC() + 4 : sys.registers[reg]; };
+      const auto data = ins.data();
+
+      // masks from the decoding lookup table, cheaper than a full decode
+      if ((data & 0x0C00'0000) == 0x0400'0000 && (data & 0x0E00'0010) != 0x0600'0010) {
+        const Single_Data_Transfer transfer{ ins };
+        const auto base_location = base(transfer.base_register());
+        m_pending.address = transfer.pre_indexing() ? static_cast<std::uint32_t>(base_location + sys.offset(transfer)) : base_location;
+        m_pending.has_address = 1;
+      } else if ((data & 0x0FB0'0FF0) == 0x0100'0090) {
+        m_pending.address     = base(Single_Data_Swap{ ins }.base_register());
+        m_pending.has_address = 1;
+      } else if ((data & 0x0E00'0000) == 0x0800'0000) {
+        m_pending.address     = base(Load_And_Store_Multiple{ ins }.base_register());
+        m_pending.has_address = 1;
+      }
+    }
+
+    m_registers   = sys.registers;
+    m_has_pending = true;
+  }
+
+  // completes the last record, call once the run is over
+  template<typename System> void finish(const System &sys) noexcept
+  {
+    complete(sys.registers);
+    m_writer.flush();
+  }
+
+private:
+  void complete(const std::array<std::uint32_t, 16> &registers) noexcept
+  {
+    if (!m_has_pending) { return; }
+
+    for (std::uint8_t reg = 0; reg < 15; ++reg) {
+      if (registers[reg] != m_registers[reg]) {
+        m_pending.changed_register = reg;
+        m_pending.register_value   = registers[reg];
+        break;
+      }
+    }
+
+    m_writer.push(m_pending);
+    m_has_pending = false;
+  }
+
+  Binary_Trace_Writer &m_writer;
+  Trace_Record m_pending{};
+  std::array<std::uint32_t, 16> m_registers{};
+  bool m_has_pending{ false };
+};
+
+}  // namespace cpp_box::arm
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef CPP_BOX_TRACE_ANALYSIS_HPP
+#define CPP_BOX_TRACE_ANALYSIS_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "trace.hpp"
+
+namespace cpp_box::arm {
+
+// registers r0-r14, the PC is never interesting for liveness
+constexpr std::uint16_t general_registers = 0x7FFF;
+
+constexpr std::uint32_t trace_page_bits = 12;
+
+constexpr std::uint16_t reg_bit(const std::uint32_t reg) noexcept { return static_cast<std::uint16_t>(1U << reg); }
+
+struct PC_Stats
+{
+  std::uint64_t count{ 0 };
+  std::uint64_t memory_accesses{ 0 };
+  std::uint32_t lowest_address{ 0xFFFF'FFFF };
+  std::uint32_t highest_address{ 0 };
+
+  // registers live before this instruction, and those whose liveness depends on what comes
+  // after the chunk it was seen in
+  std::uint16_t live{ 0 };
+  std::uint16_t transparent{ 0 };
+
+  void merge(const PC_Stats &other, const std::uint16_t live_out) noexcept
+  {
+    count += other.count;
+    memory_accesses += other.memory_accesses;
+    lowest_address  = std::min(lowest_address, other.lowest_address);
+    highest_address = std::max(highest_address, other.highest_address);
+    live |= other.live;
+    live |= other.transparent & live_out;
+  }
+};
+
+// a taken backwards branch, from the end of a loop body to its start
+constexpr std::uint64_t edge_key(const std::uint32_t head, const std::uint32_t latch) noexcept
+{
+  return (static_cast<std::uint64_t>(head) << 32) | latch;
+}
+
+// Everything learned from one contiguous slice of the trace
+struct Chunk_Stats
+{
+  std::unordered_map<std::uint32_t, PC_Stats> pcs;
+  std::unordered_map<std::uint64_t, std::uint64_t> back_edges;
+  std::unordered_map<std::uint32_t, std::uint64_t> pages;
+
+  // registers live at the start of the chunk assuming nothing is live at its end, and
+  // those the chunk neither reads nor writes
+  std::uint16_t live_in{ 0 };
+  std::uint16_t transparent{ general_registers };
+};
+
+// Everything learned from the whole trace
+struct Trace_Stats
+{
+  std::unordered_map<std::uint32_t, PC_Stats> pcs;
+  std::unordered_map<std::uint64_t, std::uint64_t> back_edges;
+  std::map<std::uint32_t, std::uint64_t> pages;
+};
+
+// A run of consecutive pages that were accessed, `end` is one past the last byte
+struct Memory_Range
+{
+  std::uint64_t begin;
+  std::uint64_t end;
+  std::uint64_t accesses;
+};
+
+// records [begin, end) of the `total` in the trace, which may look at the record after `end`
+Chunk_Stats analyze_chunk(const Trace_Record *records, const std::size_t begin, const std::size_t end, const std::size_t total);
+
+// stitches together the stats of adjacent chunks, given in trace order
+Trace_Stats merge_chunks(const std::vector<Chunk_Stats> &chunks);
+
+// the accessed pages, with neighbouring pages combined
+std::vector<Memory_Range> memory_ranges(const std::map<std::uint32_t, std::uint64_t> &pages);
+
+}  // namespace cpp_box::arm
+
+#endif
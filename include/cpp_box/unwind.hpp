@@ -0,0 +1,187 @@
+#ifndef CPP_BOX_UNWIND_HPP
+#define CPP_BOX_UNWIND_HPP
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace cpp_box::elf {
+struct File_Header;
+}  // namespace cpp_box::elf
+
+namespace cpp_box {
+
+// Walks guest call stacks, reading the guest's memory directly, for sampling profilers.
+//
+// `Frame_Pointer` follows the r11 chain guests built with `-fno-omit-frame-pointer` keep, where
+// r11 points at the caller's saved r11 with the return address just above it. `Tables` runs
+// the ARM EHABI unwind opcodes from `.ARM.exidx` / `.ARM.extab`. Neither is exact while a
+// function is in its prologue or epilogue, so any return address that lands outside of the
+// code ends the walk instead of producing garbage frames.
+class Unwinder
+{
+public:
+  enum class Method { None, Frame_Pointer, Tables };
+
+  static constexpr std::size_t max_depth = 64;
+
+  Unwinder() = default;
+
+  // `load_address` is where the start of the file was loaded, the way `load_unknown` loads it
+  Unwinder(const elf::File_Header &file_header, const std::uint32_t load_address, const std::uint32_t image_size, const Method t_method);
+
+  // from an image already laid out the way it's loaded, with a .ARM.exidx of `exidx_size` bytes
+  // at `exidx_offset` whose entries are resolved, as they are in a linked executable
+  Unwinder(const std::basic_string_view<std::uint8_t> image,
+           const std::uint32_t load_address,
+           const std::size_t exidx_offset,
+           const std::size_t exidx_size,
+           const Method t_method);
+
+  [[nodiscard]] Method method() const noexcept { return m_method; }
+
+  // false if the file has no .ARM.exidx to use for `Method::Tables`
+  [[nodiscard]] bool has_tables() const noexcept { return !m_entries.empty(); }
+
+  // replaces `stack` with the current PC followed by the call site of each caller, innermost first
+  template<typename System> void unwind(const System &sys, std::vector<std::uint32_t> &stack) const
+  {
+    stack.clear();
+
+    auto registers = sys.registers;
+    // the PC reads 4 ahead of the next instruction between run_for calls
+    registers[15] -= 4;
+    stack.push_back(registers[15]);
+
+    switch (m_method) {
+    case Method::None: return;
+    case Method::Frame_Pointer: return unwind_frame_pointers(sys, registers[11], stack);
+    case Method::Tables:
+      while (stack.size() < max_depth && step(sys, registers)) {
+        // return addresses point after the call, which might already be past the end of the caller
+        stack.push_back(registers[15] - 4);
+        registers[15] -= 4;
+      }
+      return;
+    }
+  }
+
+private:
+  struct Entry
+  {
+    std::uint32_t function;     // first address covered
+    std::uint32_t opcodes;      // offset into m_opcodes
+    std::uint32_t opcode_count;
+    bool can_unwind;
+  };
+
+  [[nodiscard]] bool in_code(const std::uint32_t address) const noexcept { return address >= m_code_start && address < m_code_end; }
+
+  [[nodiscard]] const Entry *lookup(const std::uint32_t address) const noexcept;
+
+  // `symbol_offsets` maps exidx offsets that are still relocations to the file offset of their symbol
+  void read_table(const std::basic_string_view<std::uint8_t> data,
+                  const std::uint64_t exidx_offset,
+                  const std::uint64_t exidx_size,
+                  const std::map<std::uint64_t, std::uint64_t> &symbol_offsets);
+
+  template<typename System> void unwind_frame_pointers(const System &sys, std::uint32_t frame, std::vector<std::uint32_t> &stack) const
+  {
+    // callers' frames are always further up the stack, which also guarantees this ends. Frames
+    // can't be expected to be aligned, the stack starts out at an odd address.
+    for (std::uint32_t last_frame = 0; frame > last_frame && stack.size() < max_depth;) {
+      const auto return_address = sys.read_word(frame + 4);
+      if (!in_code(return_address)) { return; }
+
+      stack.push_back(return_address - 4);
+      last_frame = std::exchange(frame, sys.read_word(frame));
+    }
+  }
+
+  // undoes the effect of the function containing registers[15] on `registers`, see the "Frame
+  // unwinding instructions" section of the EHABI
+  template<typename System> bool step(const System &sys, std::array<std::uint32_t, 16> &registers) const
+  {
+    const auto *entry = lookup(registers[15]);
+    if (entry == nullptr || !entry->can_unwind) { return false; }
+
+    auto vsp             = registers[13];
+    bool pc_popped       = false;
+    const auto pop_masks = [&](const std::uint32_t mask, const std::uint32_t first_register) {
+      for (std::uint32_t reg = 0; reg < 16; ++reg) {
+        if ((mask & (1U << reg)) != 0) {
+          registers[first_register + reg] = sys.read_word(vsp);
+          vsp += 4;
+          pc_popped = pc_popped || first_register + reg == 15;
+        }
+      }
+    };
+
+    const auto *opcodes = &m_opcodes[entry->opcodes];
+    const auto end      = entry->opcode_count;
+
+    for (std::uint32_t idx = 0; idx < end;) {
+      const std::uint32_t op = opcodes[idx++];
+      const auto next        = [&]() -> std::uint32_t { return idx < end ? opcodes[idx++] : 0xB0; };
+
+      if ((op & 0xC0) == 0x00) {
+        vsp += ((op & 0x3F) << 2) + 4;
+      } else if ((op & 0xC0) == 0x40) {
+        vsp -= ((op & 0x3F) << 2) + 4;
+      } else if ((op & 0xF0) == 0x80) {
+        const auto mask = ((op & 0x0F) << 8) | next();
+        if (mask == 0) { return false; }  // refuse to unwind
+        pop_masks(mask, 4);
+      } else if ((op & 0xF0) == 0x90) {
+        if ((op & 0x0F) == 13 || (op & 0x0F) == 15) { return false; }
+        vsp = registers[op & 0x0F];
+      } else if ((op & 0xF0) == 0xA0) {
+        // r4 to r[4 + n], and r14 as well when bit 3 is set
+        pop_masks((1U << ((op & 0x07) + 1)) - 1, 4);
+        if ((op & 0x08) != 0) { pop_masks(1, 14); }
+      } else if (op == 0xB0) {
+        break;
+      } else if (op == 0xB1) {
+        const auto mask = next();
+        if (mask == 0 || (mask & 0xF0) != 0) { return false; }
+        pop_masks(mask, 0);
+      } else if (op == 0xB2) {
+        std::uint32_t value = 0;
+        for (std::uint32_t shift = 0;; shift += 7) {
+          const auto byte = next();
+          value |= (byte & 0x7F) << shift;
+          if ((byte & 0x80) == 0 || shift > 21) { break; }
+        }
+        vsp += 0x204 + (value << 2);
+      } else if (op == 0xB3 || op == 0xC8 || op == 0xC9) {
+        // VFP registers, which we don't have, but still have to skip
+        vsp += ((next() & 0x0F) + 1) * 8 + (op == 0xB3 ? 4 : 0);
+      } else if ((op & 0xF8) == 0xB8 || (op & 0xF8) == 0xD0) {
+        vsp += ((op & 0x07) + 1) * 8 + ((op & 0xF8) == 0xB8 ? 4 : 0);
+      } else {
+        // iWMMXt or spare
+        return false;
+      }
+    }
+
+    if (!pc_popped) { registers[15] = registers[14]; }
+    registers[13] = vsp;
+
+    return in_code(registers[15]);
+  }
+
+  Method m_method{ Method::None };
+  std::uint32_t m_code_start{ 0 };
+  std::uint32_t m_code_end{ 0 };
+
+  // sorted by function
+  std::vector<Entry> m_entries;
+  std::vector<std::uint8_t> m_opcodes;
+};
+
+}  // namespace cpp_box
+
+#endif
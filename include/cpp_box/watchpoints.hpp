@@ -0,0 +1,120 @@
+#ifndef CPP_BOX_WATCHPOINTS_HPP
+#define CPP_BOX_WATCHPOINTS_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "arm.hpp"
+
+namespace cpp_box::arm {
+
+enum class Watch : std::uint32_t { Read = 0b01, Write = 0b10, Access = 0b11 };
+
+// watches [start, end)
+struct Watchpoint
+{
+  std::uint32_t start;
+  std::uint32_t end;
+  Watch kind;
+
+  [[nodiscard]] constexpr bool operator==(const Watchpoint &other) const noexcept
+  {
+    return start == other.start && end == other.end && kind == other.kind;
+  }
+};
+
+struct Watchpoint_Hit
+{
+  std::uint32_t pc;  // of the instruction making the access
+  std::uint32_t address;
+  std::uint32_t size;
+  std::uint32_t old_value;
+  std::uint32_t new_value;  // the same as old_value for reads
+  bool write;
+};
+
+// Memory_Hooks policy recording, and by default stopping on, accesses to watched address ranges.
+//
+// Like page protection, how many watchpoints touch each 4KB page is kept in a table, so only
+// accesses to pages with a watchpoint on them take the slow path of checking the ranges.
+template<std::size_t RAM_Size> class Watchpoints
+{
+public:
+  static constexpr std::uint32_t page_bits = 12;
+
+  // hits report what a store replaced
+  static constexpr bool wants_old_value = true;
+
+  bool stop_on_hit{ true };
+  std::vector<Watchpoint_Hit> hits;
+
+  void add(const Watchpoint watchpoint)
+  {
+    if (watchpoint.end <= watchpoint.start) { return; }
+
+    m_watchpoints.push_back(watchpoint);
+    for_each_page(watchpoint, [](auto &count) { ++count; });
+  }
+
+  void remove(const Watchpoint watchpoint)
+  {
+    if (const auto found = std::find(m_watchpoints.begin(), m_watchpoints.end(), watchpoint); found != m_watchpoints.end()) {
+      m_watchpoints.erase(found);
+      for_each_page(watchpoint, [](auto &count) { --count; });
+    }
+  }
+
+  void clear()
+  {
+    m_watchpoints.clear();
+    m_pages.fill(0);
+  }
+
+  [[nodiscard]] const std::vector<Watchpoint> &watchpoints() const noexcept { return m_watchpoints; }
+
+  [[nodiscard]] constexpr bool is_hooked(const std::uint32_t loc) const noexcept
+  {
+    const auto page = loc >> page_bits;
+    return page < m_pages.size() && m_pages[page] != 0;
+  }
+
+  template<typename System> void read(System &sys, const std::uint32_t loc, const std::uint32_t size, const std::uint32_t value)
+  {
+    check(sys, Watchpoint_Hit{ sys.PC() - 8, loc, size, value, value, false });
+  }
+
+  template<typename System>
+  void write(System &sys, const std::uint32_t loc, const std::uint32_t size, const std::uint32_t old_value, const std::uint32_t new_value)
+  {
+    check(sys, Watchpoint_Hit{ sys.PC() - 8, loc, size, old_value, new_value, true });
+  }
+
+private:
+  template<typename Func> void for_each_page(const Watchpoint watchpoint, Func &&func)
+  {
+    const auto last_page = std::min<std::size_t>((watchpoint.end - 1) >> page_bits, m_pages.size() - 1);
+    for (std::size_t page = watchpoint.start >> page_bits; page <= last_page; ++page) { func(m_pages[page]); }
+  }
+
+  template<typename System> void check(System &sys, const Watchpoint_Hit hit)
+  {
+    const auto kind = static_cast<std::uint32_t>(hit.write ? Watch::Write : Watch::Read);
+
+    for (const auto &watchpoint : m_watchpoints) {
+      if ((static_cast<std::uint32_t>(watchpoint.kind) & kind) != 0 && hit.address < watchpoint.end && hit.address + hit.size > watchpoint.start) {
+        hits.push_back(hit);
+        if (stop_on_hit) { sys.stop(Stop_Reason::Watchpoint); }
+        return;
+      }
+    }
+  }
+
+  std::array<std::uint16_t, (RAM_Size >> page_bits) + 1> m_pages{};
+  std::vector<Watchpoint> m_watchpoints;
+};
+
+}  // namespace cpp_box::arm
+
+#endif
@@ -2,13 +2,16 @@
 #include <spdlog/spdlog.h>
 
 
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <string>
 
 #include "../include/cpp_box/compiler.hpp"
+#include "../include/cpp_box/dwarf.hpp"
 #include "../include/cpp_box/elf_reader.hpp"
 #include "../include/cpp_box/print_utilities.hpp"
+#include "../include/cpp_box/timeline.hpp"
 #include "../include/cpp_box/utility.hpp"
 
 namespace cpp_box {
@@ -26,8 +29,26 @@ std::pair<bool, std::string> test_clang(const std::filesystem::path &p)
   return { false, "" };
 }
 
+namespace {
+  // an entry per instruction word covered by the DWARF line table, if the file has one. Ranges
+  // are clamped to the `image_size` bytes the file is loaded as, so a corrupt line program
+  // can't make up more instructions than there are.
+  std::unordered_map<std::uint32_t, Memory_Location> read_locations(const cpp_box::elf::File_Header &file_header, const std::size_t image_size)
+  {
+    std::unordered_map<std::uint32_t, Memory_Location> locations;
+    for (const auto &range : dwarf::read_line_table(file_header)) {
+      const auto end = std::min<std::uint64_t>(range.end, image_size);
+      for (auto loc = range.begin; loc < end; loc += 4) {
+        locations.try_emplace(static_cast<std::uint32_t>(loc), Memory_Location{ "", range.file, range.line, "", "" });
+      }
+    }
+    return locations;
+  }
+}  // namespace
+
 Loaded_Files load_unknown(const std::filesystem::path &t_path, spdlog::logger &logger)
 {
+  const Timeline::Scope scope{ timeline(), "load_unknown", "compile" };
   auto data = std::make_unique<std::vector<std::uint8_t>>(cpp_box::utility::read_file(t_path));
   logger.info("Loading unknown file type: '{}', file exists? {}", t_path.string(), std::filesystem::exists(t_path));
 
@@ -51,13 +72,20 @@ Loaded_Files load_unknown(const std::filesystem::path &t_path, spdlog::logger &l
       for (const auto &header : file_header.section_headers()) {
         for (const auto &symbol_table_entry : header.symbol_table_entries()) {
           if (symbol_table_entry.name(string_table) == "main") {
-            cpp_box::utility::resolve_symbols(*data, file_header, logger);
+            {
+              const Timeline::Scope resolve{ timeline(), "resolve_symbols", "compile" };
+              cpp_box::utility::resolve_symbols(*data, file_header, logger);
+            }
             std::basic_string_view<std::uint8_t> data_view{ data->data(), data->size() };
             const auto main_section     = file_header.section_header(symbol_table_entry.section_header_table_index());
             const auto main_file_offset = static_cast<std::uint32_t>(main_section.offset() + symbol_table_entry.value());
             logger.info(
               "'main' symbol found in '{}':{} file offset: {}", main_section.name(sh_string_table), symbol_table_entry.value(), main_file_offset);
-            return Loaded_Files{ "", "", std::move(data), data_view, main_file_offset, true, {}, section_offsets };
+            auto locations = [&] {
+              const Timeline::Scope read{ timeline(), "read line table", "compile" };
+              return read_locations(file_header, data->size());
+            }();
+            return Loaded_Files{ "", "", std::move(data), data_view, main_file_offset, true, std::move(locations), section_offsets };
           }
         }
       }
@@ -72,6 +100,23 @@ Loaded_Files load_unknown(const std::filesystem::path &t_path, spdlog::logger &l
 }
 
 
+std::vector<std::uint32_t> line_addresses(const Loaded_Files &files, const int line_number)
+{
+  const auto is_line = [&](const std::uint32_t loc) {
+    const auto location = files.location_data.find(loc);
+    return location != files.location_data.end() && location->second.line_number == line_number;
+  };
+
+  std::vector<std::uint32_t> addresses;
+  for (const auto &[loc, location] : files.location_data) {
+    if (location.line_number == line_number && (loc < 4 || !is_line(loc - 4))) { addresses.push_back(loc); }
+  }
+
+  std::sort(addresses.begin(), addresses.end());
+  return addresses;
+}
+
+
 // TODO: Make optimization level, standard, strongly typed things
 Loaded_Files compile(const std::string &t_str,
                      const std::filesystem::path &t_clang_compiler,
@@ -82,6 +127,7 @@ Loaded_Files compile(const std::string &t_str,
                      spdlog::logger &logger)
 {
   logger.info("Compile Starting");
+  const Timeline::Scope scope{ timeline(), "compile", "compile" };
 
   cpp_box::utility::Temp_Directory dir{};
 
@@ -92,6 +138,7 @@ Loaded_Files compile(const std::string &t_str,
   const auto disassembly_file = dir.dir() / "src.dis";
 
   if (std::ofstream ofs(cpp_file); ofs.good()) {
+    const Timeline::Scope write{ timeline(), "write source", "compile" };
     ofs.write(t_str.data(), static_cast<std::streamsize>(t_str.size()));
     ofs.flush();  // make sure OS flushes file before clang tries to load it
   }
@@ -108,9 +155,15 @@ Loaded_Files compile(const std::string &t_str,
     t_hardware_lib.string());
 
   logger.debug("Executing compile command: '{}'", build_command);
-  [[maybe_unused]] const auto [result, output, error] = cpp_box::utility::make_system_call(build_command);
-  const auto assembly                                 = cpp_box::utility::read_file(asm_file);
-  auto loaded                                         = load_unknown(obj_file, logger);
+  [[maybe_unused]] const auto [result, output, error] = [&] {
+    const Timeline::Scope clang{ timeline(), "clang", "compile" };
+    return cpp_box::utility::make_system_call(build_command);
+  }();
+  const auto assembly = [&] {
+    const Timeline::Scope read{ timeline(), "read assembly", "compile" };
+    return cpp_box::utility::read_file(asm_file);
+  }();
+  auto loaded = load_unknown(obj_file, logger);
 
   logger.debug("Compile stdout: '{}'", output);
   logger.debug("Compile stderr: '{}'", error);
@@ -119,13 +172,17 @@ Loaded_Files compile(const std::string &t_str,
                                                (t_clang_compiler.parent_path() / "llvm-objdump").string(),
                                                obj_file.string());
   logger.debug("Executing disassemble command: '{}'", disassemble_command);
-  [[maybe_unused]] const auto [disassembly_result, disassembly, disassembly_error] = cpp_box::utility::make_system_call(disassemble_command);
+  [[maybe_unused]] const auto [disassembly_result, disassembly, disassembly_error] = [&] {
+    const Timeline::Scope objdump{ timeline(), "llvm-objdump", "compile" };
+    return cpp_box::utility::make_system_call(disassemble_command);
+  }();
 
 
   const std::regex strip_attributes{ R"(\n\s+\..*)", std::regex::ECMAScript };
 //  cpp_box::utility::dump_rom(loaded.image);
 
   const auto parse_disassembly = [&logger](const std::string &file, const auto &section_offsets) {
+    const Timeline::Scope parse{ timeline(), "parse disassembly", "compile" };
     const std::regex read_disassembly{ R"(\s+([0-9a-f]+):\s+(..) (..) (..) (..) \t(.*))" };
     const std::regex read_section_name{ R"(^Disassembly of section (.*):$)" };
     const std::regex read_function_name{ R"(^(.*:)$)" };
@@ -184,8 +241,13 @@ Loaded_Files compile(const std::string &t_str,
   };
 
 
+  auto stripped_assembly = [&] {
+    const Timeline::Scope strip{ timeline(), "strip assembly attributes", "compile" };
+    return std::regex_replace(std::string{ assembly.begin(), assembly.end() }, strip_attributes, "");
+  }();
+
   return Loaded_Files{ t_str,
-                       std::regex_replace(std::string{ assembly.begin(), assembly.end() }, strip_attributes, ""),
+                       std::move(stripped_assembly),
                        std::move(loaded.binary_file),
                        loaded.image,
                        static_cast<std::uint32_t>(loaded.entry_point),
@@ -0,0 +1,40 @@
+#include "../include/cpp_box/coverage.hpp"
+#include "../include/cpp_box/compiler.hpp"
+
+#include <map>
+#include <ostream>
+
+#include <fmt/format.h>
+
+namespace cpp_box {
+
+Coverage_Summary write_lcov(std::ostream &os, const arm::Coverage &coverage, const Loaded_Files &files)
+{
+  // a line is hit if any of the instructions generated for it ran
+  std::map<std::string, std::map<int, bool>> lines;
+  for (const auto &[offset, location] : files.location_data) {
+    if (location.filename.empty() || location.line_number <= 0) { continue; }
+    auto &hit = lines[location.filename.string()][location.line_number];
+    hit       = hit || coverage.covered(offset);
+  }
+
+  Coverage_Summary total;
+  os << "TN:\n";
+  for (const auto &[file, file_lines] : lines) {
+    Coverage_Summary summary;
+    os << "SF:" << file << '\n';
+    for (const auto &[line, hit] : file_lines) {
+      os << fmt::format("DA:{},{}\n", line, hit ? 1 : 0);
+      ++summary.lines;
+      if (hit) { ++summary.lines_hit; }
+    }
+    os << fmt::format("LF:{}\nLH:{}\nend_of_record\n", summary.lines, summary.lines_hit);
+
+    total.lines += summary.lines;
+    total.lines_hit += summary.lines_hit;
+  }
+
+  return total;
+}
+
+}  // namespace cpp_box
@@ -0,0 +1,154 @@
+#include "../include/cpp_box/disassembler.hpp"
+
+#include <array>
+#include <string_view>
+
+#include <fmt/format.h>
+
+namespace cpp_box::arm {
+
+namespace {
+  constexpr std::array<std::string_view, 16> condition_names{ "eq", "ne", "hs", "lo", "mi", "pl", "vs", "vc",
+                                                              "hi", "ls", "ge", "lt", "gt", "le", "",   "nv" };
+
+  constexpr std::array<std::string_view, 16> opcode_names{ "and", "eor", "sub", "rsb", "add", "adc", "sbc", "rsc",
+                                                           "tst", "teq", "cmp", "cmn", "orr", "mov", "bic", "mvn" };
+
+  constexpr std::array<std::string_view, 4> shift_names{ "lsl", "lsr", "asr", "ror" };
+
+  std::string_view condition(const Instruction instruction) { return condition_names[static_cast<std::size_t>(instruction.get_condition())]; }
+
+  std::string reg(const std::uint32_t number)
+  {
+    switch (number) {
+    case 13: return "sp";
+    case 14: return "lr";
+    case 15: return "pc";
+    default: return fmt::format("r{}", number);
+    }
+  }
+
+  std::string immediate(const std::uint32_t value) { return value < 256 ? fmt::format("#{}", value) : fmt::format("#{:#x}", value); }
+
+  // an immediate shift of 0 means something else for every type but lsl
+  std::string shifted_register(const std::uint32_t number, const Shift_Type type, const std::uint32_t amount)
+  {
+    if (amount == 0) {
+      switch (type) {
+      case Shift_Type::Logical_Left: return reg(number);
+      case Shift_Type::Rotate_Right: return fmt::format("{}, rrx", reg(number));
+      case Shift_Type::Logical_Right:
+      case Shift_Type::Arithmetic_Right: return fmt::format("{}, {} #32", reg(number), shift_names[static_cast<std::size_t>(type)]);
+      }
+    }
+    return fmt::format("{}, {} #{}", reg(number), shift_names[static_cast<std::size_t>(type)], amount);
+  }
+
+  std::string disassemble(const Instruction instruction, const Data_Processing val)
+  {
+    const auto opcode    = val.get_opcode();
+    const bool test_only = opcode == OpCode::TST || opcode == OpCode::TEQ || opcode == OpCode::CMP || opcode == OpCode::CMN;
+    const bool move      = opcode == OpCode::MOV || opcode == OpCode::MVN;
+
+    const auto operand_2 = [&] {
+      if (val.immediate_operand()) { return immediate(val.operand_2_immediate()); }
+      if (val.operand_2_immediate_shift()) {
+        return shifted_register(val.operand_2_register(), val.operand_2_shift_type(), val.operand_2_shift_amount());
+      }
+      return fmt::format("{}, {} {}",
+                         reg(val.operand_2_register()),
+                         shift_names[static_cast<std::size_t>(val.operand_2_shift_type())],
+                         reg(val.operand_2_shift_register()));
+    }();
+
+    // the test instructions always set the flags, that's all they do
+    const auto mnemonic = fmt::format(
+      "{}{}{}", opcode_names[static_cast<std::size_t>(opcode)], condition(instruction), val.set_condition_code() && !test_only ? "s" : "");
+
+    if (test_only) { return fmt::format("{} {}, {}", mnemonic, reg(val.operand_1_register()), operand_2); }
+    if (move) { return fmt::format("{} {}, {}", mnemonic, reg(val.destination_register()), operand_2); }
+    return fmt::format("{} {}, {}, {}", mnemonic, reg(val.destination_register()), reg(val.operand_1_register()), operand_2);
+  }
+
+  std::string disassemble(const Instruction instruction, const Multiply_Long val)
+  {
+    // named by the encoding, bit 22 set is smull / smlal
+    return fmt::format("{}{}{}{} {}, {}, {}, {}",
+                       instruction.test_bit(22) ? "s" : "u",
+                       val.accumulate() ? "mlal" : "mull",
+                       condition(instruction),
+                       val.status_register_update() ? "s" : "",
+                       reg(val.low_result()),
+                       reg(val.high_result()),
+                       reg(val.operand_2()),
+                       reg(val.operand_1()));
+  }
+
+  std::string disassemble(const Instruction instruction, const Single_Data_Swap val)
+  {
+    return fmt::format("swp{}{} {}, {}, [{}]",
+                       condition(instruction),
+                       val.byte_transfer() ? "b" : "",
+                       reg(val.destination_register()),
+                       reg(val.source_register()),
+                       reg(val.base_register()));
+  }
+
+  std::string disassemble(const Instruction instruction, const Single_Data_Transfer val)
+  {
+    const auto sign   = val.up_indexing() ? "" : "-";
+    const auto offset = [&]() -> std::string {
+      if (val.immediate_offset()) { return val.offset() == 0 ? "" : fmt::format("#{}{}", sign, val.offset()); }
+      return fmt::format("{}{}", sign, shifted_register(val.offset_register(), val.offset_shift_type(), val.offset_shift_amount()));
+    }();
+
+    const auto address = [&] {
+      if (!val.pre_indexing()) {
+        return offset.empty() ? fmt::format("[{}]", reg(val.base_register())) : fmt::format("[{}], {}", reg(val.base_register()), offset);
+      }
+      return fmt::format("[{}{}{}]{}", reg(val.base_register()), offset.empty() ? "" : ", ", offset, val.write_back() ? "!" : "");
+    }();
+
+    return fmt::format(
+      "{}{}{} {}, {}", val.load() ? "ldr" : "str", condition(instruction), val.byte_transfer() ? "b" : "", reg(val.src_dest_register()), address);
+  }
+
+  std::string disassemble(const Instruction instruction, const Load_And_Store_Multiple val)
+  {
+    std::string registers;
+    for (std::uint32_t number = 0; number < 16; ++number) {
+      if (test_bit(val.register_list(), number)) { registers += fmt::format("{}{}", registers.empty() ? "" : ", ", reg(number)); }
+    }
+
+    return fmt::format("{}{}{}{} {}{}, {{{}}}{}",
+                       val.load() ? "ldm" : "stm",
+                       condition(instruction),
+                       val.up_indexing() ? "i" : "d",
+                       val.pre_indexing() ? "b" : "a",
+                       reg(val.base_register()),
+                       val.write_back() ? "!" : "",
+                       registers,
+                       val.psr() ? "^" : "");
+  }
+
+  std::string disassemble(const Instruction instruction, const Branch val, const std::uint32_t address)
+  {
+    // the PC reads 8 ahead of the branch by the time the offset is added
+    return fmt::format("b{}{} {:#x}", val.link() ? "l" : "", condition(instruction), address + 8 + static_cast<std::uint32_t>(val.offset()));
+  }
+}  // namespace
+
+std::string disassemble(const Instruction instruction, const std::uint32_t address)
+{
+  switch (const auto type = System<>::decode(instruction); type) {
+  case Instruction_Type::Data_Processing: return disassemble(instruction, Data_Processing{ instruction });
+  case Instruction_Type::Multiply_Long: return disassemble(instruction, Multiply_Long{ instruction });
+  case Instruction_Type::Single_Data_Swap: return disassemble(instruction, Single_Data_Swap{ instruction });
+  case Instruction_Type::Single_Data_Transfer: return disassemble(instruction, Single_Data_Transfer{ instruction });
+  case Instruction_Type::Load_And_Store_Multiple: return disassemble(instruction, Load_And_Store_Multiple{ instruction });
+  case Instruction_Type::Branch: return disassemble(instruction, Branch{ instruction }, address);
+  default: return fmt::format("<{}> {:#010x}", to_string(type), instruction.data());
+  }
+}
+
+}  // namespace cpp_box::arm
@@ -0,0 +1,328 @@
+#include "../include/cpp_box/dwarf.hpp"
+#include "../include/cpp_box/elf_reader.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string_view>
+
+namespace cpp_box::dwarf {
+
+namespace {
+  // reads forward through one section, giving 0s (and going bad) instead of reading past its end
+  struct Reader
+  {
+    std::basic_string_view<std::uint8_t> data;
+    std::size_t position{ 0 };
+    bool good{ true };
+
+    [[nodiscard]] bool at_end() const noexcept { return !good || position >= data.size(); }
+
+    template<std::size_t Bytes> std::uint64_t fixed() noexcept
+    {
+      if (data.size() - position < Bytes || position > data.size()) {
+        good = false;
+        return 0;
+      }
+      const auto value = elf::read_loc<Bytes>(data, position, true);
+      position += Bytes;
+      return value;
+    }
+
+    std::uint64_t uleb128() noexcept
+    {
+      std::uint64_t value = 0;
+      for (unsigned shift = 0; !at_end(); shift += 7) {
+        const auto byte = data[position++];
+        if (shift < 64) { value |= std::uint64_t{ byte & 0x7FU } << shift; }
+        if ((byte & 0x80U) == 0) { return value; }
+      }
+      good = false;
+      return value;
+    }
+
+    std::int64_t sleb128() noexcept
+    {
+      std::uint64_t value = 0;
+      for (unsigned shift = 0; !at_end(); shift += 7) {
+        const auto byte = data[position++];
+        if (shift < 64) { value |= std::uint64_t{ byte & 0x7FU } << shift; }
+        if ((byte & 0x80U) == 0) {
+          if (shift + 7 < 64 && (byte & 0x40U) != 0) { value |= ~std::uint64_t{ 0 } << (shift + 7); }
+          return static_cast<std::int64_t>(value);
+        }
+      }
+      good = false;
+      return static_cast<std::int64_t>(value);
+    }
+
+    std::string string() noexcept
+    {
+      const auto end = data.find(std::uint8_t{ 0 }, position);
+      if (end == std::basic_string_view<std::uint8_t>::npos) {
+        good = false;
+        return {};
+      }
+      std::string result{ data.begin() + static_cast<std::ptrdiff_t>(position), data.begin() + static_cast<std::ptrdiff_t>(end) };
+      position = end + 1;
+      return result;
+    }
+
+    void skip(const std::uint64_t bytes) noexcept
+    {
+      if (bytes > data.size() - position) {
+        good = false;
+        position = data.size();
+      } else {
+        position += bytes;
+      }
+    }
+  };
+
+  [[nodiscard]] std::string string_at(const std::basic_string_view<std::uint8_t> strings, const std::uint64_t offset)
+  {
+    if (offset >= strings.size()) { return {}; }
+    Reader reader{ strings, offset };
+    return reader.string();
+  }
+
+  struct Sections
+  {
+    std::basic_string_view<std::uint8_t> str;
+    std::basic_string_view<std::uint8_t> line_str;
+  };
+
+  // DWARF 5 describes its directory and file tables with a list of (content type, form) pairs
+  struct Entry_Format
+  {
+    std::uint64_t content;
+    std::uint64_t form;
+  };
+
+  constexpr std::uint64_t DW_LNCT_path            = 1;
+  constexpr std::uint64_t DW_LNCT_directory_index = 2;
+
+  // the value of an attribute, when it's a number or a string, skipping over anything else
+  std::optional<std::string> read_form(Reader &reader, const std::uint64_t form, const Sections &sections, std::uint64_t &number)
+  {
+    switch (form) {
+    case 0x08: return reader.string();                                          // DW_FORM_string
+    case 0x0e: return string_at(sections.str, reader.fixed<4>());               // DW_FORM_strp
+    case 0x1f: return string_at(sections.line_str, reader.fixed<4>());          // DW_FORM_line_strp
+    case 0x0b: number = reader.fixed<1>(); return std::nullopt;                 // DW_FORM_data1
+    case 0x05: number = reader.fixed<2>(); return std::nullopt;                 // DW_FORM_data2
+    case 0x06: number = reader.fixed<4>(); return std::nullopt;                 // DW_FORM_data4
+    case 0x07: number = reader.fixed<8>(); return std::nullopt;                 // DW_FORM_data8
+    case 0x0f: number = reader.uleb128(); return std::nullopt;                  // DW_FORM_udata
+    case 0x1e: reader.skip(16); return std::nullopt;                            // DW_FORM_data16
+    case 0x09: reader.skip(reader.uleb128()); return std::nullopt;              // DW_FORM_block
+    default: reader.good = false; return std::nullopt;
+    }
+  }
+
+  std::vector<std::pair<std::string, std::uint64_t>> read_v5_entries(Reader &reader, const Sections &sections)
+  {
+    std::vector<Entry_Format> formats(reader.fixed<1>());
+    for (auto &format : formats) { format = { reader.uleb128(), reader.uleb128() }; }
+
+    // a table never lists more entries than there are bytes left to describe them, anything
+    // larger comes from a corrupt unit
+    const auto count = reader.uleb128();
+    if (count > reader.data.size() - std::min(reader.position, reader.data.size())) {
+      reader.good = false;
+      return {};
+    }
+
+    std::vector<std::pair<std::string, std::uint64_t>> entries(count);
+    for (auto &[path, directory] : entries) {
+      for (const auto &format : formats) {
+        std::uint64_t number = 0;
+        const auto text      = read_form(reader, format.form, sections, number);
+        if (format.content == DW_LNCT_path && text) { path = *text; }
+        if (format.content == DW_LNCT_directory_index) { directory = number; }
+      }
+      if (!reader.good) { return {}; }
+    }
+    return entries;
+  }
+}  // namespace
+
+std::vector<Line_Range> read_line_table(const elf::File_Header &file_header)
+{
+  const auto sh_string_table = file_header.sh_string_table();
+
+  std::optional<elf::Section_Header> debug_line;
+  std::optional<elf::Section_Header> debug_line_relocations;
+  Sections sections;
+  for (const auto &section : file_header.section_headers()) {
+    const auto name = section.name(sh_string_table);
+    if (name == ".debug_line") { debug_line = section; }
+    if (name == ".rel.debug_line") { debug_line_relocations = section; }
+    if (name == ".debug_str") { sections.str = section.section_data(); }
+    if (name == ".debug_line_str") { sections.line_str = section.section_data(); }
+  }
+
+  if (!debug_line) { return {}; }
+
+  // DW_LNE_set_address operands in a relocatable file are offsets from a (section) symbol
+  std::map<std::uint64_t, std::uint64_t> symbol_offsets;
+  if (debug_line_relocations) {
+    const auto symbol_table = file_header.symbol_table();
+    for (const auto &relocation : debug_line_relocations->relocation_table_entries()) {
+      const auto symbol = symbol_table.symbol_table_entry(relocation.symbol());
+      symbol_offsets[relocation.file_offset()] = file_header.section_header(symbol.section_header_table_index()).offset() + symbol.value();
+    }
+  }
+
+  const auto to_file_offset = [&](const std::size_t operand, const std::uint64_t address) -> std::optional<std::uint64_t> {
+    if (const auto symbol = symbol_offsets.find(operand); symbol != symbol_offsets.end()) { return symbol->second + address; }
+    for (const auto &section : file_header.section_headers()) {
+      const auto section_address = section.read(elf::Section_Header::Fields::sh_addr);
+      if (section_address != 0 && address >= section_address && address - section_address < section.size()) {
+        return section.offset() + (address - section_address);
+      }
+    }
+    return std::nullopt;
+  };
+
+  std::vector<Line_Range> ranges;
+  Reader reader{ debug_line->section_data() };
+
+  while (!reader.at_end()) {
+    const auto unit_length = reader.fixed<4>();
+    // 64 bit DWARF isn't something a 32 bit target produces
+    if (unit_length >= 0xFFFF'FFF0) { break; }
+    const auto unit_end = reader.position + unit_length;
+
+    const auto version = reader.fixed<2>();
+    if (version < 2 || version > 5) {
+      reader.position = unit_end;
+      continue;
+    }
+
+    auto address_size = 4U;
+    if (version >= 5) {
+      address_size = static_cast<unsigned>(reader.fixed<1>());
+      reader.skip(1);  // segment selector size
+    }
+
+    const auto header_length    = reader.fixed<4>();
+    const auto program_start    = reader.position + header_length;
+    const auto min_inst_length  = reader.fixed<1>();
+    if (version >= 4) { reader.skip(1); }  // maximum operations per instruction, only meaningful for VLIW
+    reader.skip(1);  // default is_stmt, every row is used
+    const auto line_base        = static_cast<std::int8_t>(reader.fixed<1>());
+    const auto line_range       = reader.fixed<1>();
+    const auto opcode_base      = reader.fixed<1>();
+    std::vector<std::uint64_t> standard_opcode_lengths;
+    for (std::uint64_t opcode = 1; opcode < opcode_base; ++opcode) { standard_opcode_lengths.push_back(reader.fixed<1>()); }
+
+    // DWARF 5 numbers files from 0, earlier versions from 1, with directory 0 being the compilation directory
+    std::vector<std::string> directories;
+    std::vector<std::pair<std::string, std::uint64_t>> files;
+    if (version >= 5) {
+      for (auto &[path, directory] : read_v5_entries(reader, sections)) { directories.push_back(std::move(path)); }
+      files = read_v5_entries(reader, sections);
+    } else {
+      directories.emplace_back();
+      for (auto directory = reader.string(); reader.good && !directory.empty(); directory = reader.string()) { directories.push_back(directory); }
+      files.emplace_back();
+      for (auto file = reader.string(); reader.good && !file.empty(); file = reader.string()) {
+        const auto directory = reader.uleb128();
+        reader.uleb128();  // modification time
+        reader.uleb128();  // length
+        files.emplace_back(file, directory);
+      }
+    }
+
+    if (!reader.good || line_range == 0) { break; }
+    reader.position = program_start;
+
+    const auto file_name = [&](const std::uint64_t index) -> std::string {
+      if (index >= files.size()) { return {}; }
+      const auto &[name, directory] = files[index];
+      if (directory >= directories.size() || directories[directory].empty() || std::filesystem::path{ name }.is_absolute()) { return name; }
+      return (std::filesystem::path{ directories[directory] } / name).string();
+    };
+
+    struct Row
+    {
+      std::optional<std::uint64_t> address;
+      std::uint64_t file;
+      std::int64_t line;
+    };
+
+    Row row{ std::nullopt, 1, 1 };
+    std::optional<Row> previous;
+    // each row covers the instructions up to the next one in its sequence
+    const auto emit = [&](const bool end_sequence) {
+      if (previous && previous->address && row.address && *row.address > *previous->address && previous->line > 0) {
+        ranges.push_back({ *previous->address, *row.address, file_name(previous->file), static_cast<int>(previous->line) });
+      }
+      previous = row;
+      if (end_sequence) {
+        previous.reset();
+        row = Row{ std::nullopt, 1, 1 };
+      }
+    };
+    const auto advance = [&](const std::uint64_t operations) {
+      if (row.address) { *row.address += operations * min_inst_length; }
+    };
+
+    while (reader.good && reader.position < unit_end) {
+      const auto opcode = reader.fixed<1>();
+
+      if (opcode >= opcode_base) {
+        const auto adjusted = opcode - opcode_base;
+        advance(adjusted / line_range);
+        row.line += line_base + static_cast<std::int64_t>(adjusted % line_range);
+        emit(false);
+        continue;
+      }
+
+      switch (opcode) {
+      case 0: {  // extended opcodes
+        const auto length = reader.uleb128();
+        const auto start  = reader.position;
+        switch (reader.fixed<1>()) {
+        case 1: emit(true); break;  // DW_LNE_end_sequence
+        case 2: {                   // DW_LNE_set_address
+          const auto operand = reader.position;
+          const auto address = address_size == 8 ? reader.fixed<8>() : reader.fixed<4>();
+          row.address        = to_file_offset(operand, address);
+          break;
+        }
+        default: break;
+        }
+        reader.position = start;
+        reader.skip(length);
+        break;
+      }
+      case 1: emit(false); break;  // DW_LNS_copy
+      case 2: advance(reader.uleb128()); break;
+      case 3: row.line += reader.sleb128(); break;
+      case 4: row.file = reader.uleb128(); break;
+      case 5: reader.uleb128(); break;  // DW_LNS_set_column
+      case 6: break;  // DW_LNS_negate_stmt
+      case 7: break;  // DW_LNS_set_basic_block
+      case 8: advance((255 - opcode_base) / line_range); break;
+      case 9: {  // DW_LNS_fixed_advance_pc
+        const auto delta = reader.fixed<2>();
+        if (row.address) { *row.address += delta; }
+        break;
+      }
+      default:
+        // DW_LNS_prologue_end, epilogue_begin, set_isa and anything newer, all followed by ulebs
+        for (std::uint64_t operand = 0; operand < standard_opcode_lengths[opcode - 1]; ++operand) { reader.uleb128(); }
+        break;
+      }
+    }
+
+    reader.position = unit_end;
+  }
+
+  return ranges;
+}
+
+}  // namespace cpp_box::dwarf
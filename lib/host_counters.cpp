@@ -0,0 +1,115 @@
+#include "../include/cpp_box/host_counters.hpp"
+
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace cpp_box {
+
+#if defined(__linux__)
+
+namespace {
+  constexpr std::array<std::uint64_t, Host_Counters::event_count> event_configs{ PERF_COUNT_HW_CPU_CYCLES,
+                                                                                   PERF_COUNT_HW_INSTRUCTIONS,
+                                                                                   PERF_COUNT_HW_BRANCH_MISSES,
+                                                                                   PERF_COUNT_HW_CACHE_MISSES };
+
+  // the first counter opened leads the group, the rest are counted over exactly the same time
+  int open_counter(const std::uint64_t config, const int group_fd) noexcept
+  {
+    perf_event_attr attr{};
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.size           = sizeof(attr);
+    attr.config         = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    // members follow the leader being enabled and disabled
+    if (group_fd < 0) { attr.disabled = 1; }
+
+    // this thread, on any CPU
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+  }
+}  // namespace
+
+Host_Counters::Host_Counters()
+{
+  int first_error = 0;
+  for (std::size_t event = 0; event < event_count; ++event) {
+    m_fds[event] = open_counter(event_configs[event], leader());
+    if (m_fds[event] < 0 && first_error == 0) { first_error = errno; }
+  }
+
+  if (!available()) {
+    m_error = std::strerror(first_error);
+    if (first_error == EACCES || first_error == EPERM) { m_error += ", see /proc/sys/kernel/perf_event_paranoid"; }
+  }
+}
+
+Host_Counters::~Host_Counters()
+{
+  for (const auto fd : m_fds) {
+    if (fd >= 0) { close(fd); }
+  }
+}
+
+int Host_Counters::leader() const noexcept
+{
+  for (const auto fd : m_fds) {
+    if (fd >= 0) { return fd; }
+  }
+  return -1;
+}
+
+bool Host_Counters::available() const noexcept { return leader() >= 0; }
+
+void Host_Counters::start() noexcept
+{
+  if (const auto fd = leader(); fd >= 0) {
+    ioctl(fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+}
+
+void Host_Counters::stop() noexcept
+{
+  if (const auto fd = leader(); fd >= 0) { ioctl(fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP); }
+}
+
+Host_Counters::Reading Host_Counters::read() const noexcept
+{
+  Reading reading;
+
+  // counter count, time enabled, time running, then the values in the order they were opened
+  std::array<std::uint64_t, 3 + event_count> data{};
+  const auto fd = leader();
+  if (fd < 0 || ::read(fd, data.data(), sizeof(data)) < static_cast<ssize_t>(3 * sizeof(std::uint64_t)) || data[2] == 0) { return reading; }
+
+  std::size_t value = 3;
+  for (std::size_t event = 0; event < event_count && value < 3 + data[0]; ++event) {
+    if (m_fds[event] < 0) { continue; }
+    reading.values[event] =
+      static_cast<std::uint64_t>(static_cast<double>(data[value++]) * static_cast<double>(data[1]) / static_cast<double>(data[2]));
+  }
+  return reading;
+}
+
+#else
+
+Host_Counters::Host_Counters() : m_error{ "perf_event_open is only available on Linux" } {}
+Host_Counters::~Host_Counters() = default;
+bool Host_Counters::available() const noexcept { return false; }
+void Host_Counters::start() noexcept {}
+void Host_Counters::stop() noexcept {}
+Host_Counters::Reading Host_Counters::read() const noexcept { return {}; }
+
+#endif
+
+}  // namespace cpp_box
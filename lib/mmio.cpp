@@ -0,0 +1,36 @@
+#include "../include/cpp_box/mmio.hpp"
+
+#include <fstream>
+
+namespace cpp_box::system {
+
+bool MMIO_Log::save(const std::filesystem::path &path) const
+{
+  std::ofstream file{ path, std::ios::binary };
+  const MMIO_Log_Header header{};
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+  return file.good();
+}
+
+std::optional<MMIO_Log> MMIO_Log::load(const std::filesystem::path &path)
+{
+  std::ifstream file{ path, std::ios::binary };
+  MMIO_Log_Header header{};
+  if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.magic != MMIO_Log_Header{}.magic
+      || header.version != MMIO_Log_Header{}.version) {
+    return std::nullopt;
+  }
+
+  const auto start = file.tellg();
+  file.seekg(0, std::ios::end);
+  const auto end = file.tellg();
+  if (start < 0 || end < start || !file.seekg(start)) { return std::nullopt; }
+
+  MMIO_Log log;
+  log.data.resize(static_cast<std::size_t>(end - start));
+  if (!file.read(reinterpret_cast<char *>(log.data.data()), static_cast<std::streamsize>(log.data.size()))) { return std::nullopt; }
+  return log;
+}
+
+}  // namespace cpp_box::system
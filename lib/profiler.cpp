@@ -0,0 +1,71 @@
+#include "../include/cpp_box/profiler.hpp"
+
+#include <algorithm>
+#include <set>
+
+#include <fmt/format.h>
+
+namespace cpp_box {
+
+namespace {
+  std::string function_name(const Symbol_Table &symbols, const std::uint32_t address)
+  {
+    if (const auto *symbol = symbols.lookup(address); symbol != nullptr) { return symbol->name; }
+    return fmt::format("{:#010x}", address);
+  }
+}  // namespace
+
+std::uint64_t Sampling_Profile::sample_count() const noexcept
+{
+  std::uint64_t total = 0;
+  for (const auto &[stack, count] : m_stacks) { total += count; }
+  return total;
+}
+
+void Sampling_Profile::write_collapsed(std::ostream &os, const Symbol_Table &symbols) const
+{
+  // different addresses in the same functions collapse into the same line
+  std::map<std::string, std::uint64_t> lines;
+  for (const auto &[stack, count] : m_stacks) {
+    std::string line;
+    for (auto frame = stack.rbegin(); frame != stack.rend(); ++frame) {
+      if (!line.empty()) { line += ';'; }
+      line += function_name(symbols, *frame);
+    }
+    lines[line] += count;
+  }
+
+  for (const auto &[line, count] : lines) { os << line << ' ' << count << '\n'; }
+}
+
+std::vector<Function_Samples> Sampling_Profile::top_functions(const Symbol_Table &symbols, const std::size_t count) const
+{
+  std::map<std::string, Function_Samples> functions;
+  for (const auto &[stack, samples] : m_stacks) {
+    if (stack.empty()) { continue; }
+
+    const auto self_name = function_name(symbols, stack.front());
+    functions[self_name].self += samples;
+
+    // recursion shouldn't count a sample more than once
+    std::set<std::string> seen;
+    for (const auto frame : stack) {
+      auto name = function_name(symbols, frame);
+      if (seen.insert(name).second) { functions[name].total += samples; }
+    }
+  }
+
+  std::vector<Function_Samples> result;
+  for (auto &[name, samples] : functions) {
+    samples.name = name;
+    result.push_back(std::move(samples));
+  }
+
+  // stable, so that exact ties stay in name order
+  std::stable_sort(
+    result.begin(), result.end(), [](const auto &lhs, const auto &rhs) { return lhs.self > rhs.self || (lhs.self == rhs.self && lhs.total > rhs.total); });
+  if (result.size() > count) { result.resize(count); }
+  return result;
+}
+
+}  // namespace cpp_box
@@ -0,0 +1,69 @@
+#include "../include/cpp_box/symbols.hpp"
+#include "../include/cpp_box/elf_reader.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include <fmt/format.h>
+
+namespace cpp_box {
+
+namespace {
+
+std::vector<Symbol> function_symbols(const elf::File_Header &file_header, const std::uint32_t load_address)
+{
+  std::vector<Symbol> symbols;
+  const auto string_table = file_header.string_table();
+
+  for (const auto &header : file_header.section_headers()) {
+    for (const auto &entry : header.symbol_table_entries()) {
+      if (entry.type() != elf::Symbol_Table_Entry::Type::STT_FUNC) { continue; }
+
+      // undefined, absolute and common symbols don't live in a section we loaded
+      const auto section_index = entry.section_header_table_index();
+      if (section_index == 0 || section_index >= 0xFF00) { continue; }
+
+      const auto section = file_header.section_header(section_index);
+      symbols.push_back(Symbol{ std::string{ entry.name(string_table) },
+                                static_cast<std::uint32_t>(load_address + section.offset() + entry.value()),
+                                static_cast<std::uint32_t>(entry.size()) });
+    }
+  }
+
+  return symbols;
+}
+
+}  // namespace
+
+Symbol_Table::Symbol_Table(const elf::File_Header &file_header, const std::uint32_t load_address)
+  : Symbol_Table{ function_symbols(file_header, load_address) }
+{
+}
+
+Symbol_Table::Symbol_Table(std::vector<Symbol> symbols) : m_symbols{ std::move(symbols) }
+{
+  std::sort(m_symbols.begin(), m_symbols.end(), [](const auto &lhs, const auto &rhs) { return lhs.start < rhs.start; });
+
+  // hand written assembly often doesn't bother with sizes, assume those run up to the next function
+  for (std::size_t idx = 0; idx + 1 < m_symbols.size(); ++idx) {
+    if (m_symbols[idx].size == 0) { m_symbols[idx].size = m_symbols[idx + 1].start - m_symbols[idx].start; }
+  }
+}
+
+const Symbol *Symbol_Table::lookup(const std::uint32_t address) const noexcept
+{
+  const auto next =
+    std::upper_bound(m_symbols.begin(), m_symbols.end(), address, [](const auto value, const auto &symbol) { return value < symbol.start; });
+  if (next == m_symbols.begin()) { return nullptr; }
+
+  const auto &symbol = *std::prev(next);
+  return symbol.contains(address) ? &symbol : nullptr;
+}
+
+std::string Symbol_Table::describe(const std::uint32_t address) const
+{
+  if (const auto *symbol = lookup(address); symbol != nullptr) { return fmt::format("{}+{:#x}", symbol->name, address - symbol->start); }
+  return fmt::format("{:#010x}", address);
+}
+
+}  // namespace cpp_box
@@ -0,0 +1,114 @@
+#include "../include/cpp_box/thread_pool.hpp"
+
+#include <algorithm>
+
+namespace cpp_box::utility {
+
+Work_Stealing_Pool::Work_Stealing_Pool(const std::size_t thread_count) : m_queues(std::max<std::size_t>(thread_count, 1))
+{
+  for (std::size_t worker = 0; worker < m_queues.size(); ++worker) {
+    m_threads.emplace_back([this, worker] { worker_loop(worker); });
+  }
+}
+
+Work_Stealing_Pool::~Work_Stealing_Pool()
+{
+  {
+    std::lock_guard<std::mutex> lock{ m_mutex };
+    m_shutdown = true;
+  }
+  m_work_available.notify_all();
+
+  for (auto &thread : m_threads) { thread.join(); }
+}
+
+void Work_Stealing_Pool::submit(std::function<void()> job)
+{
+  ++m_unfinished;
+  const auto target = m_next_queue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+
+  {
+    std::lock_guard<std::mutex> lock{ m_queues[target].mutex };
+    m_queues[target].jobs.push_back(std::move(job));
+  }
+
+  // counted only once it's in a queue, so whoever claims it is sure to find it
+  ++m_queued;
+
+  if (m_sleeping != 0) {
+    // a worker holds the mutex from announcing it's going to sleep until it is asleep, so once
+    // we've had the mutex it is either waiting and gets the notification, or has seen the job
+    { std::lock_guard<std::mutex> lock{ m_mutex }; }
+    m_work_available.notify_one();
+  }
+}
+
+void Work_Stealing_Pool::wait()
+{
+  std::unique_lock<std::mutex> lock{ m_mutex };
+  m_all_done.wait(lock, [this] { return m_unfinished == 0; });
+}
+
+bool Work_Stealing_Pool::try_claim() noexcept
+{
+  auto queued = m_queued.load();
+  while (queued != 0 && !m_queued.compare_exchange_weak(queued, queued - 1)) {}
+  return queued != 0;
+}
+
+bool Work_Stealing_Pool::try_pop(const std::size_t worker, std::function<void()> &job)
+{
+  // newest job from our own queue first, it's the most likely to still be warm in cache
+  {
+    auto &own = m_queues[worker];
+    std::lock_guard<std::mutex> lock{ own.mutex };
+    if (!own.jobs.empty()) {
+      job = std::move(own.jobs.back());
+      own.jobs.pop_back();
+      return true;
+    }
+  }
+
+  // otherwise steal the oldest job from whoever has one
+  for (std::size_t offset = 1; offset < m_queues.size(); ++offset) {
+    auto &victim = m_queues[(worker + offset) % m_queues.size()];
+    std::lock_guard<std::mutex> lock{ victim.mutex };
+    if (!victim.jobs.empty()) {
+      job = std::move(victim.jobs.front());
+      victim.jobs.pop_front();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void Work_Stealing_Pool::worker_loop(const std::size_t worker)
+{
+  while (true) {
+    if (!try_claim()) {
+      std::unique_lock<std::mutex> lock{ m_mutex };
+      ++m_sleeping;
+      bool claimed = false;
+      m_work_available.wait(lock, [this, &claimed] {
+        claimed = try_claim();
+        return claimed || m_shutdown;
+      });
+      --m_sleeping;
+      if (!claimed) { return; }  // shutting down with nothing left to do
+    }
+
+    // we've claimed one job, and every claimed job is sitting in some queue
+    std::function<void()> job;
+    while (!try_pop(worker, job)) { std::this_thread::yield(); }
+
+    job();
+
+    if (--m_unfinished == 0) {
+      std::lock_guard<std::mutex> lock{ m_mutex };
+      m_all_done.notify_all();
+    }
+  }
+}
+
+}  // namespace cpp_box::utility
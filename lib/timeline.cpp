@@ -0,0 +1,94 @@
+#include "../include/cpp_box/timeline.hpp"
+
+#include <fstream>
+
+#include <fmt/format.h>
+
+namespace cpp_box {
+
+namespace {
+  [[nodiscard]] std::string escape(const std::string_view text)
+  {
+    std::string result;
+    for (const auto c : text) {
+      if (c == '"' || c == '\\') {
+        result += '\\';
+        result += c;
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+        result += fmt::format("\\u{:04x}", static_cast<int>(c));
+      } else {
+        result += c;
+      }
+    }
+    return result;
+  }
+}  // namespace
+
+Timeline::Scope::Scope(Timeline &t_timeline, const std::string_view t_name, const std::string_view t_category)
+  : timeline{ t_timeline }, name{ t_name }, category{ t_category }, start{ timeline.enabled() ? Clock::now() : Clock::time_point{} }
+{
+}
+
+Timeline::Scope::~Scope()
+{
+  if (timeline.enabled()) { timeline.complete(name, category, start, Clock::now()); }
+}
+
+std::int64_t Timeline::since_epoch(const Clock::time_point time) const noexcept
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(time - m_epoch).count();
+}
+
+std::uint32_t Timeline::thread_number()
+{
+  return m_threads.try_emplace(std::this_thread::get_id(), static_cast<std::uint32_t>(m_threads.size())).first->second;
+}
+
+void Timeline::complete(const std::string_view name, const std::string_view category, const Clock::time_point start, const Clock::time_point end)
+{
+  if (!enabled()) { return; }
+
+  // enabled part way through the scope
+  if (start < m_epoch) { return; }
+
+  const std::lock_guard<std::mutex> lock{ m_mutex };
+  m_events.push_back({ std::string{ name }, std::string{ category }, 'X', since_epoch(start), since_epoch(end) - since_epoch(start), thread_number() });
+}
+
+void Timeline::instant(const std::string_view name, const std::string_view category)
+{
+  if (!enabled()) { return; }
+
+  const auto now = Clock::now();
+  const std::lock_guard<std::mutex> lock{ m_mutex };
+  m_events.push_back({ std::string{ name }, std::string{ category }, 'i', since_epoch(now), 0, thread_number() });
+}
+
+bool Timeline::write(const std::filesystem::path &path) const
+{
+  std::ofstream ofs{ path };
+
+  const std::lock_guard<std::mutex> lock{ m_mutex };
+  ofs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  for (std::size_t idx = 0; idx < m_events.size(); ++idx) {
+    const auto &event = m_events[idx];
+    ofs << (idx == 0 ? "\n" : ",\n")
+        << fmt::format(R"({{"name":"{}","cat":"{}","ph":"{}","ts":{},"pid":1,"tid":{})", escape(event.name), escape(event.category), event.phase, event.timestamp, event.thread);
+    if (event.phase == 'X') {
+      ofs << fmt::format(R"(,"dur":{}}})", event.duration);
+    } else {
+      ofs << R"(,"s":"t"})";
+    }
+  }
+  ofs << "\n]}\n";
+
+  return ofs.good();
+}
+
+Timeline &timeline() noexcept
+{
+  static Timeline instance;
+  return instance;
+}
+
+}  // namespace cpp_box
@@ -0,0 +1,41 @@
+#include "../include/cpp_box/trace.hpp"
+
+#include <chrono>
+
+namespace cpp_box::arm {
+
+Binary_Trace_Writer::Binary_Trace_Writer(const std::filesystem::path &path) : m_file{ path, std::ios::binary }
+{
+  const Trace_Header header{};
+  m_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  m_good = m_file.good();
+
+  m_thread = std::thread{ [this] { write_loop(); } };
+}
+
+Binary_Trace_Writer::~Binary_Trace_Writer()
+{
+  m_ring.publish();
+  m_done = true;
+  m_thread.join();
+}
+
+void Binary_Trace_Writer::write_loop()
+{
+  const auto write = [this](const Trace_Record *records, const std::size_t count) {
+    m_file.write(reinterpret_cast<const char *>(records), static_cast<std::streamsize>(count * sizeof(Trace_Record)));
+  };
+
+  while (true) {
+    // checked before draining, so that whatever was published before we were told to stop is still written
+    const bool done = m_done;
+    if (m_ring.drain(write) == 0) {
+      if (done) { break; }
+      std::this_thread::sleep_for(std::chrono::microseconds{ 50 });
+    }
+  }
+
+  m_file.flush();
+}
+
+}  // namespace cpp_box::arm
@@ -0,0 +1,178 @@
+#include "../include/cpp_box/trace_analysis.hpp"
+
+namespace cpp_box::arm {
+
+namespace {
+
+struct Register_Use
+{
+  std::uint16_t reads{ 0 };
+  std::uint16_t writes{ 0 };
+};
+
+// which registers an instruction reads and writes, if it executes
+constexpr Register_Use register_use(const Instruction ins) noexcept
+{
+  const auto data = ins.data();
+  Register_Use use;
+
+  switch (System<>::decode(ins)) {
+  case Instruction_Type::Data_Processing: {
+    const Data_Processing dp{ ins };
+    const auto opcode = dp.get_opcode();
+    if (opcode != OpCode::MOV && opcode != OpCode::MVN) { use.reads |= reg_bit(dp.operand_1_register()); }
+    if (!dp.immediate_operand()) {
+      use.reads |= reg_bit(dp.operand_2_register());
+      if (!dp.operand_2_immediate_shift()) { use.reads |= reg_bit(dp.operand_2_shift_register()); }
+    }
+    if (opcode < OpCode::TST || opcode > OpCode::CMN) { use.writes |= reg_bit(dp.destination_register()); }
+    break;
+  }
+  case Instruction_Type::MRS: use.writes |= reg_bit((data >> 12) & 0b1111); break;
+  case Instruction_Type::MSR: use.reads |= reg_bit(data & 0b1111); break;
+  case Instruction_Type::MSRF:
+    if ((data & (1U << 25)) == 0) { use.reads |= reg_bit(data & 0b1111); }
+    break;
+  case Instruction_Type::Multiply:
+    use.reads |= reg_bit(data & 0b1111);
+    use.reads |= reg_bit((data >> 8) & 0b1111);
+    if ((data & (1U << 21)) != 0) { use.reads |= reg_bit((data >> 12) & 0b1111); }
+    use.writes |= reg_bit((data >> 16) & 0b1111);
+    break;
+  case Instruction_Type::Multiply_Long: {
+    const Multiply_Long mul{ ins };
+    use.reads |= reg_bit(mul.operand_1());
+    use.reads |= reg_bit(mul.operand_2());
+    use.writes |= reg_bit(mul.high_result());
+    use.writes |= reg_bit(mul.low_result());
+    if (mul.accumulate()) { use.reads |= use.writes; }
+    break;
+  }
+  case Instruction_Type::Single_Data_Swap: {
+    const Single_Data_Swap swap{ ins };
+    use.reads |= reg_bit(swap.base_register());
+    use.reads |= reg_bit(swap.source_register());
+    use.writes |= reg_bit(swap.destination_register());
+    break;
+  }
+  case Instruction_Type::Single_Data_Transfer: {
+    const Single_Data_Transfer transfer{ ins };
+    use.reads |= reg_bit(transfer.base_register());
+    if (!transfer.immediate_offset()) { use.reads |= reg_bit(transfer.offset_register()); }
+    if (transfer.load()) {
+      use.writes |= reg_bit(transfer.src_dest_register());
+    } else {
+      use.reads |= reg_bit(transfer.src_dest_register());
+    }
+    if (transfer.write_back() || !transfer.pre_indexing()) { use.writes |= reg_bit(transfer.base_register()); }
+    break;
+  }
+  case Instruction_Type::Load_And_Store_Multiple: {
+    const Load_And_Store_Multiple multiple{ ins };
+    use.reads |= reg_bit(multiple.base_register());
+    if (multiple.load()) {
+      use.writes |= multiple.register_list();
+    } else {
+      use.reads |= multiple.register_list();
+    }
+    if (multiple.write_back()) { use.writes |= reg_bit(multiple.base_register()); }
+    break;
+  }
+  case Instruction_Type::Branch:
+    if (Branch{ ins }.link()) { use.writes |= reg_bit(14); }
+    break;
+  case Instruction_Type::Undefined:
+  case Instruction_Type::Block_Data_Transfer:
+  case Instruction_Type::Coprocessor_Data_Transfer:
+  case Instruction_Type::Coprocessor_Data_Operation:
+  case Instruction_Type::Coprocessor_Register_Transfer:
+  case Instruction_Type::Software_Interrupt:
+  case Instruction_Type::Breakpoint: break;
+  }
+
+  use.reads &= general_registers;
+  use.writes &= general_registers;
+  return use;
+}
+
+}  // namespace
+
+Chunk_Stats analyze_chunk(const Trace_Record *records, const std::size_t begin, const std::size_t end, const std::size_t total)
+{
+  Chunk_Stats stats;
+
+  // forwards, for counts, memory and loops
+  for (std::size_t idx = begin; idx < end; ++idx) {
+    const auto &record = records[idx];
+    auto &pc           = stats.pcs[record.pc];
+    ++pc.count;
+
+    if (record.has_address != 0) {
+      ++pc.memory_accesses;
+      pc.lowest_address  = std::min(pc.lowest_address, record.address);
+      pc.highest_address = std::max(pc.highest_address, record.address);
+      ++stats.pages[record.address >> trace_page_bits];
+    }
+
+    // a plain B (not BL) that went backwards, peeking into the next chunk if need be
+    if ((record.instruction & 0x0F00'0000) == 0x0A00'0000 && idx + 1 < total) {
+      const auto next = records[idx + 1].pc;
+      const auto target =
+        static_cast<std::uint32_t>(static_cast<std::int64_t>(record.pc) + 8 + Branch{ Instruction{ record.instruction } }.offset());
+      if (next == target && target <= record.pc) { ++stats.back_edges[edge_key(target, record.pc)]; }
+    }
+  }
+
+  // backwards, for liveness. Conditional instructions might not execute, so their writes
+  // can't be relied on to kill anything
+  std::uint16_t live        = 0;
+  std::uint16_t transparent = general_registers;
+  for (auto idx = end; idx > begin; --idx) {
+    const auto &record = records[idx - 1];
+    const Instruction ins{ record.instruction };
+    const auto use   = register_use(ins);
+    const auto kills = ins.unconditional() ? use.writes : std::uint16_t{ 0 };
+
+    live        = static_cast<std::uint16_t>((live & ~kills) | use.reads);
+    transparent = static_cast<std::uint16_t>(transparent & ~(kills | use.reads));
+
+    auto &pc = stats.pcs[record.pc];
+    pc.live |= live;
+    pc.transparent |= transparent;
+  }
+
+  stats.live_in     = live;
+  stats.transparent = transparent;
+  return stats;
+}
+
+Trace_Stats merge_chunks(const std::vector<Chunk_Stats> &chunks)
+{
+  // liveness flows backwards, so start from the end of the trace
+  Trace_Stats stats;
+  std::uint16_t live_out = 0;
+  for (auto chunk = chunks.rbegin(); chunk != chunks.rend(); ++chunk) {
+    for (const auto &[pc, pc_stats] : chunk->pcs) { stats.pcs[pc].merge(pc_stats, live_out); }
+    for (const auto &[edge, count] : chunk->back_edges) { stats.back_edges[edge] += count; }
+    for (const auto &[page, count] : chunk->pages) { stats.pages[page] += count; }
+    live_out = static_cast<std::uint16_t>(chunk->live_in | (chunk->transparent & live_out));
+  }
+  return stats;
+}
+
+std::vector<Memory_Range> memory_ranges(const std::map<std::uint32_t, std::uint64_t> &pages)
+{
+  // 64 bit ends, the last page ends at 4GiB
+  std::vector<Memory_Range> ranges;
+  for (const auto &[page, count] : pages) {
+    if (!ranges.empty() && ranges.back().end == std::uint64_t{ page } << trace_page_bits) {
+      ranges.back().end += std::uint64_t{ 1 } << trace_page_bits;
+      ranges.back().accesses += count;
+    } else {
+      ranges.push_back(Memory_Range{ std::uint64_t{ page } << trace_page_bits, (std::uint64_t{ page } + 1) << trace_page_bits, count });
+    }
+  }
+  return ranges;
+}
+
+}  // namespace cpp_box::arm
@@ -0,0 +1,126 @@
+#include "../include/cpp_box/unwind.hpp"
+#include "../include/cpp_box/elf_reader.hpp"
+
+#include <algorithm>
+#include <map>
+#include <optional>
+
+namespace cpp_box {
+
+namespace {
+  [[nodiscard]] std::uint32_t read_word(const std::basic_string_view<std::uint8_t> data, const std::size_t offset) noexcept
+  {
+    if (offset + 4 > data.size()) { return 0; }
+    return elf::read_loc<4>(data, offset, true);
+  }
+
+  // the 31 bit, sign extended, place relative offsets .ARM.exidx is made of
+  [[nodiscard]] std::int64_t prel31(const std::uint32_t value) noexcept
+  {
+    return static_cast<std::int32_t>(value << 1) >> 1;
+  }
+}  // namespace
+
+Unwinder::Unwinder(const elf::File_Header &file_header, const std::uint32_t load_address, const std::uint32_t image_size, const Method t_method)
+  : m_method{ t_method }, m_code_start{ load_address }, m_code_end{ load_address + image_size }
+{
+  const auto sh_string_table = file_header.sh_string_table();
+
+  std::optional<elf::Section_Header> exidx;
+  std::optional<elf::Section_Header> exidx_relocations;
+  for (const auto &section : file_header.section_headers()) {
+    if (section.name(sh_string_table) == ".ARM.exidx") { exidx = section; }
+    if (section.name(sh_string_table) == ".rel.ARM.exidx") { exidx_relocations = section; }
+  }
+
+  if (!exidx) { return; }
+
+  // In an object file the place relative offsets haven't been resolved yet, they are offsets
+  // from the symbol of the matching relocation instead. Either way we want a file offset.
+  std::map<std::uint64_t, std::uint64_t> symbol_offsets;
+  if (exidx_relocations) {
+    const auto symbol_table = file_header.symbol_table();
+    for (const auto &relocation : exidx_relocations->relocation_table_entries()) {
+      // there are R_ARM_NONEs too, which only pull in the personality routines
+      constexpr auto R_ARM_PREL31 = 42;
+      if (relocation.type() != R_ARM_PREL31) { continue; }
+
+      const auto symbol = symbol_table.symbol_table_entry(relocation.symbol());
+      symbol_offsets[relocation.file_offset()] = file_header.section_header(symbol.section_header_table_index()).offset() + symbol.value();
+    }
+  }
+
+  read_table(file_header.data, exidx->offset(), exidx->size(), symbol_offsets);
+}
+
+Unwinder::Unwinder(const std::basic_string_view<std::uint8_t> image,
+                   const std::uint32_t load_address,
+                   const std::size_t exidx_offset,
+                   const std::size_t exidx_size,
+                   const Method t_method)
+  : m_method{ t_method }, m_code_start{ load_address }, m_code_end{ load_address + static_cast<std::uint32_t>(image.size()) }
+{
+  read_table(image, exidx_offset, exidx_size, {});
+}
+
+void Unwinder::read_table(const std::basic_string_view<std::uint8_t> data,
+                          const std::uint64_t exidx_offset,
+                          const std::uint64_t exidx_size,
+                          const std::map<std::uint64_t, std::uint64_t> &symbol_offsets)
+{
+  const auto resolve = [&](const std::uint64_t offset, const std::uint32_t value) -> std::size_t {
+    if (const auto symbol = symbol_offsets.find(offset); symbol != symbol_offsets.end()) {
+      return static_cast<std::size_t>(static_cast<std::int64_t>(symbol->second) + prel31(value));
+    }
+    return static_cast<std::size_t>(static_cast<std::int64_t>(exidx_offset + offset) + prel31(value));
+  };
+
+  for (std::uint64_t offset = 0; offset + 8 <= exidx_size; offset += 8) {
+    const auto function = resolve(offset, read_word(data, exidx_offset + offset));
+    const auto details  = read_word(data, exidx_offset + offset + 4);
+
+    Entry entry{ static_cast<std::uint32_t>(m_code_start + function), static_cast<std::uint32_t>(m_opcodes.size()), 0, details != 1 };
+
+    // opcodes are packed most significant byte first, `skip` leading bytes of `word` aren't opcodes
+    const auto add_opcodes = [&](const std::uint32_t word, const int skip) {
+      for (int byte = 3 - skip; byte >= 0; --byte) { m_opcodes.push_back(static_cast<std::uint8_t>(word >> (byte * 8))); }
+    };
+
+    if (details == 1) {
+      // EXIDX_CANTUNWIND
+    } else if ((details & 0x8000'0000) != 0) {
+      // the compact model 0 entry is inline
+      add_opcodes(details, 1);
+    } else {
+      const auto table_offset = resolve(offset + 4, details);
+      const auto header       = read_word(data, table_offset);
+      if ((header & 0x8000'0000) != 0 && ((header >> 24) & 0x0F) == 0) {
+        add_opcodes(header, 1);
+      } else {
+        // compact models 1 and 2, and generic personality routines, which are followed by the same format
+        const auto compact    = (header & 0x8000'0000) != 0;
+        const auto first_word = compact ? table_offset : table_offset + 4;
+        const auto word       = read_word(data, first_word);
+        const auto extra      = compact ? (word >> 16) & 0xFF : word >> 24;
+        add_opcodes(word, compact ? 2 : 1);
+        for (std::uint32_t idx = 1; idx <= extra; ++idx) { add_opcodes(read_word(data, first_word + idx * 4), 0); }
+      }
+    }
+
+    entry.opcode_count = static_cast<std::uint32_t>(m_opcodes.size() - entry.opcodes);
+    m_entries.push_back(entry);
+  }
+
+  std::sort(m_entries.begin(), m_entries.end(), [](const auto &lhs, const auto &rhs) { return lhs.function < rhs.function; });
+}
+
+const Unwinder::Entry *Unwinder::lookup(const std::uint32_t address) const noexcept
+{
+  // each entry covers everything up to the next one
+  const auto next =
+    std::upper_bound(m_entries.begin(), m_entries.end(), address, [](const auto value, const auto &entry) { return value < entry.function; });
+  if (next == m_entries.begin()) { return nullptr; }
+  return &*std::prev(next);
+}
+
+}  // namespace cpp_box
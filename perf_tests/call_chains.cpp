@@ -0,0 +1,65 @@
+// Deep chains of calls that can't be inlined, with enough live values that every call saves and
+// restores a full set of registers: the LDM / STM heavy prologues and epilogues of real code.
+//
+// max_instructions: 60000000
+// expected_r0: 0xb4919ace
+
+#include <hardware.hpp>
+#include <cstdint>
+
+namespace {
+
+constexpr int rounds = 12;
+
+// Takeuchi's function, the classic call benchmark
+[[gnu::noinline]] std::int32_t tak(const std::int32_t x, const std::int32_t y, const std::int32_t z)
+{
+  if (y >= x) { return z; }
+  return tak(tak(x - 1, y, z), tak(y - 1, z, x), tak(z - 1, x, y));
+}
+
+struct Accumulators
+{
+  std::uint32_t sum;
+  std::uint32_t product;
+  std::uint32_t mixed;
+  std::uint32_t count;
+};
+
+// passes a struct by value down the recursion and keeps several values live across each call
+[[gnu::noinline]] Accumulators walk(const Accumulators accumulators, const std::uint32_t depth, const std::uint32_t seed)
+{
+  if (depth == 0) { return Accumulators{ accumulators.sum + seed, accumulators.product * (seed | 1u), accumulators.mixed ^ seed, accumulators.count + 1 }; }
+
+  const auto left  = walk(accumulators, depth - 1, seed * 3 + 1);
+  const auto right = walk(left, depth - 1, seed ^ depth);
+  return Accumulators{ left.sum + right.sum, left.product ^ right.product, (left.mixed << 1) + right.mixed, right.count };
+}
+
+[[gnu::noinline]] std::uint32_t fibonacci(const std::uint32_t n)
+{
+  if (n < 2) { return n; }
+  return fibonacci(n - 1) + fibonacci(n - 2);
+}
+
+}  // namespace
+
+int main()
+{
+  // RAM_SIZE is always the same, but the compiler can't know that and fold the whole program away
+  const auto ram_size = cpp_box::peek<std::uint32_t>(static_cast<std::uint32_t>(cpp_box::system::Memory_Map::RAM_SIZE));
+  const auto offset   = static_cast<std::int32_t>(ram_size >> 22);  // 2
+
+  std::uint32_t checksum = 0;
+  for (int round = 0; round < rounds; ++round) {
+    checksum += static_cast<std::uint32_t>(tak(13 + offset + round % 2, 10 + offset, 4 + round % 3));
+
+    const auto accumulators = walk(Accumulators{ checksum, 1, 0, 0 }, 10, ram_size + static_cast<std::uint32_t>(round));
+    checksum ^= accumulators.sum + accumulators.product + accumulators.mixed + accumulators.count;
+
+    checksum += fibonacci(18 + static_cast<std::uint32_t>(round % 3) + static_cast<std::uint32_t>(offset));
+    checksum = (checksum << 5) | (checksum >> 27);
+  }
+
+  return static_cast<int>(checksum);
+}
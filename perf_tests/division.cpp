@@ -0,0 +1,109 @@
+// Division heavy code: Euclid's GCD, decimal formatting and modular exponentiation. ARMv4 has no
+// divide instruction and guest programs aren't linked against a runtime providing
+// __aeabi_uidiv, so division is the same shift and subtract loop that runtime would run.
+//
+// max_instructions: 80000000
+// expected_r0: 0x0039b9da
+
+#include <hardware.hpp>
+#include <array>
+#include <cstdint>
+
+namespace {
+
+constexpr int rounds = 400;
+
+struct Quotient
+{
+  std::uint32_t quotient;
+  std::uint32_t remainder;
+};
+
+Quotient divide(const std::uint32_t dividend, const std::uint32_t divisor)
+{
+  std::uint32_t quotient  = 0;
+  std::uint32_t remainder = 0;
+  for (int bit = 31; bit >= 0; --bit) {
+    remainder = (remainder << 1) | ((dividend >> bit) & 1u);
+    if (remainder >= divisor) {
+      remainder -= divisor;
+      quotient |= 1u << bit;
+    }
+  }
+  return { quotient, remainder };
+}
+
+// the remainder of a 64 bit value, for reducing products
+std::uint32_t remainder(const std::uint64_t dividend, const std::uint32_t divisor)
+{
+  std::uint64_t result = 0;
+  for (int bit = 63; bit >= 0; --bit) {
+    result = (result << 1) | ((dividend >> bit) & 1u);
+    if (result >= divisor) { result -= divisor; }
+  }
+  return static_cast<std::uint32_t>(result);
+}
+
+std::uint32_t gcd(std::uint32_t lhs, std::uint32_t rhs)
+{
+  while (rhs != 0) {
+    const auto next = divide(lhs, rhs).remainder;
+    lhs             = rhs;
+    rhs             = next;
+  }
+  return lhs;
+}
+
+// digits, least significant first, folded together
+std::uint32_t format_decimal(std::uint32_t value)
+{
+  std::array<char, 10> digits;
+  std::size_t count = 0;
+  do {
+    const auto [quotient, digit] = divide(value, 10);
+    digits[count++]              = static_cast<char>('0' + digit);
+    value                        = quotient;
+  } while (value != 0);
+
+  std::uint32_t result = 0;
+  for (std::size_t idx = 0; idx < count; ++idx) { result = result * 33 + static_cast<std::uint32_t>(digits[idx]); }
+  return result;
+}
+
+std::uint32_t power_mod(std::uint32_t base, std::uint32_t exponent, const std::uint32_t modulus)
+{
+  std::uint32_t result = 1;
+  base                 = divide(base, modulus).remainder;
+  while (exponent != 0) {
+    if ((exponent & 1u) != 0) { result = remainder(static_cast<std::uint64_t>(result) * base, modulus); }
+    base = remainder(static_cast<std::uint64_t>(base) * base, modulus);
+    exponent >>= 1;
+  }
+  return result;
+}
+
+}  // namespace
+
+int main()
+{
+  // RAM_SIZE is always the same, but the compiler can't know that and fold the whole program away
+  auto state = cpp_box::peek<std::uint32_t>(static_cast<std::uint32_t>(cpp_box::system::Memory_Map::RAM_SIZE));
+  const auto next_random = [&state] {
+    state = state * 1664525u + 1013904223u;
+    return state;
+  };
+
+  std::uint32_t checksum = 0;
+  for (int round = 0; round < rounds; ++round) {
+    const auto lhs = next_random();
+    const auto rhs = next_random() >> 8;
+    checksum += gcd(lhs, rhs | 1u);
+    checksum ^= format_decimal(lhs) + format_decimal(rhs);
+
+    // 2^31 - 1 is prime
+    checksum += power_mod(lhs, rhs & 0xFFFFu, 0x7FFFFFFFu);
+    checksum = (checksum << 3) | (checksum >> 29);
+  }
+
+  return static_cast<int>(checksum);
+}
@@ -0,0 +1,44 @@
+// Fills the framebuffer with a moving pattern a word at a time, frame after frame, reading a
+// sample of pixels back each frame. Long runs of stores into memory well above the program.
+//
+// max_instructions: 60000000
+// expected_r0: 0x2d22ffc8
+
+#include <hardware.hpp>
+#include <cstdint>
+
+namespace {
+
+constexpr std::uint16_t width  = 128;
+constexpr std::uint16_t height = 128;
+constexpr int frames           = 48;
+
+std::uint32_t rgba(const std::uint32_t r, const std::uint32_t g, const std::uint32_t b)
+{
+  return (r & 0xFFu) | ((g & 0xFFu) << 8) | ((b & 0xFFu) << 16) | 0xFF000000u;
+}
+
+}  // namespace
+
+int main()
+{
+  cpp_box::Hardware hardware;
+  hardware.poke(cpp_box::system::Memory_Map::SCREEN_WIDTH, width);
+  hardware.poke(cpp_box::system::Memory_Map::SCREEN_HEIGHT, height);
+  const auto buffer = hardware.peek<std::uint32_t>(cpp_box::system::Memory_Map::SCREEN_BUFFER);
+
+  std::uint32_t checksum = 0;
+  for (int frame = 0; frame < frames; ++frame) {
+    const auto shift = static_cast<std::uint32_t>(frame);
+    for (std::uint32_t y = 0; y < height; ++y) {
+      const auto row = buffer + y * width * 4;
+      for (std::uint32_t x = 0; x < width; ++x) { cpp_box::poke(row + x * 4, rgba(x + shift, y - shift, x ^ y)); }
+    }
+
+    for (std::uint32_t pixel = shift; pixel < width * height; pixel += 61) {
+      checksum = (checksum ^ cpp_box::peek<std::uint32_t>(buffer + pixel * 4)) * 16777619u;
+    }
+  }
+
+  return static_cast<int>(checksum);
+}
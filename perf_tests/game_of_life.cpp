@@ -0,0 +1,90 @@
+// The Game of Life step from examples/game_of_life.cpp, on a std::array<std::array<bool>> board,
+// writing each generation into the other of two boards rather than copying the whole board.
+// Unlike the example, its neighbour test only skips the cell itself (`||` where the example
+// has `&&`, which skips the cell's whole row and column and so only counts the diagonals).
+// A cell with 2 neighbours keeps its state, as it does in the example.
+//
+// max_instructions: 80000000
+// expected_r0: 0x0f7581d2
+
+#include <hardware.hpp>
+#include <array>
+#include <cstdint>
+
+namespace {
+
+constexpr std::size_t board_size = 48;
+constexpr int generations        = 64;
+
+template<std::size_t Cols, std::size_t Rows> using Board = std::array<std::array<bool, Cols>, Rows>;
+
+template<std::size_t Cols, std::size_t Rows> void next(const Board<Cols, Rows> &last, Board<Cols, Rows> &next_board)
+{
+  const auto neighbor_count = [&](const std::size_t col, const std::size_t row) {
+    const auto start_col = col == 0 ? 0 : col - 1;
+    const auto end_col   = col == Cols - 1 ? col : col + 1;
+    const auto start_row = row == 0 ? 0 : row - 1;
+    const auto end_row   = row == Rows - 1 ? row : row + 1;
+
+    auto count = 0;
+    for (auto cur_row = start_row; cur_row <= end_row; ++cur_row) {
+      for (auto cur_col = start_col; cur_col <= end_col; ++cur_col) {
+        if (cur_row != row || cur_col != col) {
+          if (last[cur_row][cur_col]) { ++count; }
+        }
+      }
+    }
+
+    return count;
+  };
+
+  for (std::size_t col = 0; col < Cols; ++col) {
+    for (std::size_t row = 0; row < Rows; ++row) {
+      const auto num_neighbors = neighbor_count(col, row);
+
+      if (num_neighbors == 3) {
+        next_board[row][col] = true;
+      } else if (num_neighbors < 2 || num_neighbors > 3) {
+        next_board[row][col] = false;
+      } else {
+        next_board[row][col] = last[row][col];
+      }
+    }
+  }
+}
+
+template<std::size_t Cols, std::size_t Rows> std::uint32_t fold(const Board<Cols, Rows> &board, std::uint32_t checksum)
+{
+  for (std::size_t row = 0; row < Rows; ++row) {
+    for (std::size_t col = 0; col < Cols; ++col) {
+      if (board[row][col]) { checksum = (checksum ^ static_cast<std::uint32_t>(row * Cols + col)) * 16777619u; }
+    }
+  }
+  return checksum;
+}
+
+}  // namespace
+
+int main()
+{
+  // RAM_SIZE is always the same, but the compiler can't know that and fold the whole program away
+  auto state = cpp_box::peek<std::uint32_t>(static_cast<std::uint32_t>(cpp_box::system::Memory_Map::RAM_SIZE));
+
+  std::array<Board<board_size, board_size>, 2> boards;
+  for (auto &row : boards[0]) {
+    for (auto &cell : row) {
+      state = state * 1664525u + 1013904223u;
+      cell  = (state >> 29) < 3;
+    }
+  }
+
+  std::uint32_t checksum = 2166136261u;
+  for (int generation = 0; generation < generations; ++generation) {
+    const auto &last = boards[static_cast<std::size_t>(generation) % 2];
+    auto &current    = boards[static_cast<std::size_t>(generation + 1) % 2];
+    next(last, current);
+    checksum = fold(current, checksum);
+  }
+
+  return static_cast<int>(checksum);
+}
@@ -0,0 +1,92 @@
+// FNV-1a, a MurmurHash3 style block mix and a bitwise CRC-32 over a 16KB buffer that is
+// perturbed between rounds. Byte loads, multiplies and tight shift / xor loops.
+//
+// max_instructions: 50000000
+// expected_r0: 0x8c6f4e5a
+
+#include <hardware.hpp>
+#include <array>
+#include <cstdint>
+
+namespace {
+
+constexpr std::size_t buffer_size = 16 * 1024;
+constexpr int rounds              = 16;
+
+using Buffer = std::array<std::uint8_t, buffer_size>;
+
+std::uint32_t next_random(std::uint32_t &state)
+{
+  state = state * 1664525u + 1013904223u;
+  return state;
+}
+
+std::uint32_t fnv1a(const Buffer &buffer)
+{
+  std::uint32_t hash = 2166136261u;
+  for (const auto byte : buffer) {
+    hash ^= byte;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+std::uint32_t rotate_left(const std::uint32_t value, const int bits) { return (value << bits) | (value >> (32 - bits)); }
+
+std::uint32_t murmur(const Buffer &buffer, const std::uint32_t seed)
+{
+  std::uint32_t hash = seed;
+  for (std::size_t idx = 0; idx < buffer.size(); idx += 4) {
+    auto block = static_cast<std::uint32_t>(buffer[idx]) | (static_cast<std::uint32_t>(buffer[idx + 1]) << 8)
+                 | (static_cast<std::uint32_t>(buffer[idx + 2]) << 16) | (static_cast<std::uint32_t>(buffer[idx + 3]) << 24);
+    block *= 0xcc9e2d51u;
+    block = rotate_left(block, 15);
+    block *= 0x1b873593u;
+
+    hash ^= block;
+    hash = rotate_left(hash, 13);
+    hash = hash * 5 + 0xe6546b64u;
+  }
+
+  hash ^= static_cast<std::uint32_t>(buffer.size());
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6bu;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35u;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+std::uint32_t crc32(const Buffer &buffer)
+{
+  std::uint32_t crc = 0xFFFFFFFFu;
+  for (const auto byte : buffer) {
+    crc ^= byte;
+    for (int bit = 0; bit < 8; ++bit) { crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u))); }
+  }
+  return ~crc;
+}
+
+}  // namespace
+
+int main()
+{
+  // RAM_SIZE is always the same, but the compiler can't know that and fold the whole program away
+  auto state = cpp_box::peek<std::uint32_t>(static_cast<std::uint32_t>(cpp_box::system::Memory_Map::RAM_SIZE));
+
+  Buffer buffer;
+  for (auto &byte : buffer) { byte = static_cast<std::uint8_t>(next_random(state) >> 24); }
+
+  std::uint32_t checksum = 0;
+  for (int round = 0; round < rounds; ++round) {
+    checksum = rotate_left(checksum, 7) ^ fnv1a(buffer);
+    checksum = rotate_left(checksum, 7) ^ murmur(buffer, checksum);
+    checksum = rotate_left(checksum, 7) ^ crc32(buffer);
+
+    for (int change = 0; change < 64; ++change) {
+      buffer[next_random(state) % buffer_size] ^= static_cast<std::uint8_t>(checksum >> (change % 4 * 8));
+    }
+  }
+
+  return static_cast<int>(checksum);
+}
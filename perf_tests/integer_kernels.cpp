@@ -0,0 +1,206 @@
+// CoreMark style integer kernels: linked list search and reversal, a small matrix multiply,
+// a number parsing state machine and a CRC-16 over all of their results.
+//
+// max_instructions: 60000000
+// expected_r0: 0x000014fe
+
+#include <hardware.hpp>
+#include <array>
+#include <cstdint>
+
+namespace {
+
+constexpr int iterations = 160;
+
+std::uint32_t next_random(std::uint32_t &state)
+{
+  state = state * 1664525u + 1013904223u;
+  return state;
+}
+
+std::uint16_t crc16(const std::uint32_t value, std::uint16_t crc)
+{
+  for (int bit = 0; bit < 32; ++bit) {
+    const auto carry = ((value >> bit) ^ crc) & 1u;
+    crc              = static_cast<std::uint16_t>(crc >> 1);
+    if (carry != 0) { crc ^= 0xA001u; }
+  }
+  return crc;
+}
+
+// linked list, with indices standing in for pointers
+constexpr std::size_t node_count = 256;
+constexpr std::uint16_t no_node  = 0xFFFF;
+
+struct Node
+{
+  std::uint16_t next;
+  std::int16_t value;
+};
+
+using List = std::array<Node, node_count>;
+
+std::uint16_t reverse(List &list, std::uint16_t head)
+{
+  std::uint16_t reversed = no_node;
+  while (head != no_node) {
+    const auto next = list[head].next;
+    list[head].next = reversed;
+    reversed        = head;
+    head            = next;
+  }
+  return reversed;
+}
+
+std::uint32_t list_kernel(List &list, std::uint16_t &head, std::uint32_t &state)
+{
+  std::uint32_t found = 0;
+  for (int search = 0; search < 8; ++search) {
+    const auto wanted = static_cast<std::int16_t>(next_random(state) >> 24);
+    std::uint32_t position = 0;
+    for (auto node = head; node != no_node; node = list[node].next, ++position) {
+      if (list[node].value == wanted) {
+        found += position;
+        break;
+      }
+    }
+    head = reverse(list, head);
+  }
+
+  for (auto node = head; node != no_node; node = list[node].next) {
+    list[node].value = static_cast<std::int16_t>(list[node].value + 1);
+  }
+  return found;
+}
+
+// matrices
+constexpr std::size_t matrix_size = 16;
+
+using Matrix_16 = std::array<std::array<std::int16_t, matrix_size>, matrix_size>;
+using Matrix_32 = std::array<std::array<std::int32_t, matrix_size>, matrix_size>;
+
+std::uint32_t matrix_kernel(const Matrix_16 &lhs, const Matrix_16 &rhs, Matrix_32 &product, const std::int32_t offset)
+{
+  for (std::size_t row = 0; row < matrix_size; ++row) {
+    for (std::size_t col = 0; col < matrix_size; ++col) {
+      std::int32_t sum = offset;
+      for (std::size_t idx = 0; idx < matrix_size; ++idx) { sum += lhs[row][idx] * rhs[idx][col]; }
+      product[row][col] = sum;
+    }
+  }
+
+  std::uint32_t result = 0;
+  for (const auto &row : product) {
+    for (const auto value : row) { result += (static_cast<std::uint32_t>(value) >> 2) & 0xFFu; }
+  }
+  return result;
+}
+
+// a scanner for things that look like "-12.5e3", counting what each token turned out to be
+constexpr std::size_t text_size = 512;
+
+using Text = std::array<char, text_size>;
+
+enum class Scan_State { Start, Sign, Integer, Fraction, Exponent_Sign, Exponent, Invalid };
+
+bool is_digit(const char c) { return c >= '0' && c <= '9'; }
+
+Scan_State advance(const Scan_State state, const char c)
+{
+  if (state == Scan_State::Start) {
+    if (is_digit(c)) { return Scan_State::Integer; }
+    if (c == '+' || c == '-') { return Scan_State::Sign; }
+    if (c == '.') { return Scan_State::Fraction; }
+    return Scan_State::Invalid;
+  } else if (state == Scan_State::Sign) {
+    if (is_digit(c)) { return Scan_State::Integer; }
+    if (c == '.') { return Scan_State::Fraction; }
+    return Scan_State::Invalid;
+  } else if (state == Scan_State::Integer) {
+    if (is_digit(c)) { return Scan_State::Integer; }
+    if (c == '.') { return Scan_State::Fraction; }
+    if (c == 'e' || c == 'E') { return Scan_State::Exponent_Sign; }
+    return Scan_State::Invalid;
+  } else if (state == Scan_State::Fraction) {
+    if (is_digit(c)) { return Scan_State::Fraction; }
+    if (c == 'e' || c == 'E') { return Scan_State::Exponent_Sign; }
+    return Scan_State::Invalid;
+  } else if (state == Scan_State::Exponent_Sign) {
+    if (is_digit(c) || c == '+' || c == '-') { return Scan_State::Exponent; }
+    return Scan_State::Invalid;
+  } else if (state == Scan_State::Exponent) {
+    if (is_digit(c)) { return Scan_State::Exponent; }
+    return Scan_State::Invalid;
+  }
+  return Scan_State::Invalid;
+}
+
+std::uint32_t state_kernel(const Text &text)
+{
+  std::array<std::uint32_t, 7> finals{};
+  auto state = Scan_State::Start;
+  for (const auto c : text) {
+    if (c == ',') {
+      ++finals[static_cast<std::size_t>(state)];
+      state = Scan_State::Start;
+    } else {
+      state = advance(state, c);
+    }
+  }
+
+  std::uint32_t result = 0;
+  for (const auto count : finals) { result = result * 7 + count; }
+  return result;
+}
+
+char random_character(std::uint32_t &state)
+{
+  const auto choice = next_random(state) >> 28;
+  if (choice < 8) { return static_cast<char>('0' + choice); }
+  if (choice < 10) { return ','; }
+  if (choice == 10) { return '.'; }
+  if (choice == 11) { return 'e'; }
+  if (choice == 12) { return '-'; }
+  if (choice == 13) { return '+'; }
+  return static_cast<char>('0' + (choice - 6));
+}
+
+}  // namespace
+
+int main()
+{
+  // RAM_SIZE is always the same, but the compiler can't know that and fold the whole program away
+  auto state = cpp_box::peek<std::uint32_t>(static_cast<std::uint32_t>(cpp_box::system::Memory_Map::RAM_SIZE));
+
+  List list;
+  for (std::size_t node = 0; node < node_count; ++node) {
+    list[node] = Node{ static_cast<std::uint16_t>(node + 1 == node_count ? no_node : node + 1), static_cast<std::int16_t>(next_random(state) >> 24) };
+  }
+  std::uint16_t head = 0;
+
+  Matrix_16 lhs;
+  Matrix_16 rhs;
+  Matrix_32 product;
+  for (std::size_t row = 0; row < matrix_size; ++row) {
+    for (std::size_t col = 0; col < matrix_size; ++col) {
+      lhs[row][col] = static_cast<std::int16_t>(next_random(state) >> 20);
+      rhs[row][col] = static_cast<std::int16_t>(next_random(state) >> 20);
+    }
+  }
+
+  Text text;
+  for (auto &c : text) { c = random_character(state); }
+
+  std::uint16_t crc = 0;
+  for (int iteration = 0; iteration < iterations; ++iteration) {
+    crc = crc16(list_kernel(list, head, state), crc);
+    crc = crc16(matrix_kernel(lhs, rhs, product, iteration), crc);
+    crc = crc16(state_kernel(text), crc);
+
+    // feed the results back in so no iteration repeats the last one
+    lhs[static_cast<std::size_t>(iteration) % matrix_size][crc % matrix_size] = static_cast<std::int16_t>(crc);
+    text[crc % text_size]                                                      = random_character(state);
+  }
+
+  return static_cast<int>(crc);
+}
@@ -0,0 +1,130 @@
+// Insertion sorted runs merged bottom up between two buffers, and a heap sort, over freshly
+// shuffled data every round. Data dependent branches and indexed loads and stores.
+//
+// max_instructions: 60000000
+// expected_r0: 0xd8bdde30
+
+#include <hardware.hpp>
+#include <array>
+#include <cstdint>
+
+namespace {
+
+constexpr std::size_t element_count = 1024;
+constexpr std::size_t run_length    = 32;
+constexpr int rounds                = 24;
+
+using Elements = std::array<std::uint32_t, element_count>;
+
+std::uint32_t next_random(std::uint32_t &state)
+{
+  state = state * 1664525u + 1013904223u;
+  return state;
+}
+
+void fill(Elements &elements, std::uint32_t &state)
+{
+  for (auto &element : elements) { element = next_random(state) >> 8; }
+}
+
+void insertion_sort(std::uint32_t *begin, std::uint32_t *end)
+{
+  for (auto *current = begin + 1; current < end; ++current) {
+    const auto value = *current;
+    auto *hole       = current;
+    while (hole != begin && *(hole - 1) > value) {
+      *hole = *(hole - 1);
+      --hole;
+    }
+    *hole = value;
+  }
+}
+
+void merge(const std::uint32_t *left, const std::uint32_t *middle, const std::uint32_t *right, std::uint32_t *out)
+{
+  const auto *lhs = left;
+  const auto *rhs = middle;
+  while (lhs != middle && rhs != right) { *out++ = *rhs < *lhs ? *rhs++ : *lhs++; }
+  while (lhs != middle) { *out++ = *lhs++; }
+  while (rhs != right) { *out++ = *rhs++; }
+}
+
+// returns whichever buffer ends up holding the sorted data
+std::uint32_t *merge_sort(Elements &elements, Elements &scratch)
+{
+  for (std::size_t start = 0; start < element_count; start += run_length) {
+    insertion_sort(elements.data() + start, elements.data() + start + run_length);
+  }
+
+  auto *from = elements.data();
+  auto *to   = scratch.data();
+  for (std::size_t width = run_length; width < element_count; width *= 2) {
+    for (std::size_t start = 0; start < element_count; start += width * 2) {
+      merge(from + start, from + start + width, from + start + width * 2, to + start);
+    }
+    auto *const sorted = to;
+    to                 = from;
+    from               = sorted;
+  }
+  return from;
+}
+
+void sift_down(Elements &elements, std::size_t root, const std::size_t count)
+{
+  while (root * 2 + 1 < count) {
+    auto child = root * 2 + 1;
+    if (child + 1 < count && elements[child] < elements[child + 1]) { ++child; }
+    if (elements[root] >= elements[child]) { return; }
+
+    const auto value = elements[root];
+    elements[root]   = elements[child];
+    elements[child]  = value;
+    root             = child;
+  }
+}
+
+void heap_sort(Elements &elements)
+{
+  for (auto root = element_count / 2; root > 0; --root) { sift_down(elements, root - 1, element_count); }
+
+  for (auto count = element_count - 1; count > 0; --count) {
+    const auto largest = elements[0];
+    elements[0]        = elements[count];
+    elements[count]    = largest;
+    sift_down(elements, 0, count);
+  }
+}
+
+// order sensitive, and wrong if the data isn't sorted
+std::uint32_t fold(const std::uint32_t *sorted, const std::uint32_t checksum)
+{
+  std::uint32_t result = checksum;
+  for (std::size_t idx = 0; idx < element_count; ++idx) {
+    if (idx != 0 && sorted[idx - 1] > sorted[idx]) { return 0xBAD5047u; }
+    result = (result ^ sorted[idx]) * 31u + static_cast<std::uint32_t>(idx);
+  }
+  return result;
+}
+
+}  // namespace
+
+int main()
+{
+  // RAM_SIZE is always the same, but the compiler can't know that and fold the whole program away
+  auto state = cpp_box::peek<std::uint32_t>(static_cast<std::uint32_t>(cpp_box::system::Memory_Map::RAM_SIZE));
+
+  Elements elements;
+  Elements scratch;
+
+  std::uint32_t checksum = 0;
+  for (int round = 0; round < rounds; ++round) {
+    fill(elements, state);
+    checksum = fold(merge_sort(elements, scratch), checksum);
+
+    fill(elements, state);
+    heap_sort(elements);
+    checksum = fold(elements.data(), checksum);
+  }
+
+  return static_cast<int>(checksum);
+}
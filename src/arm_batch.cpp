@@ -0,0 +1,299 @@
+#include "../include/cpp_box/arm.hpp"
+#include "../include/cpp_box/compiler.hpp"
+#include "../include/cpp_box/memory_map.hpp"
+#include "../include/cpp_box/paged_ram.hpp"
+#include "../include/cpp_box/thread_pool.hpp"
+#include "../include/cpp_box/utility.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <clara.hpp>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+namespace {
+
+// every job running the same program shares its pages until it writes to them
+using System = cpp_box::arm::System<cpp_box::system::TOTAL_RAM, cpp_box::arm::Paged_RAM<cpp_box::system::TOTAL_RAM>>;
+
+// how often the wall clock is checked
+constexpr std::uint64_t instructions_per_slice = 1'000'000;
+
+struct Job
+{
+  std::filesystem::path path;
+  std::uint64_t max_instructions;
+  double time_limit;
+};
+
+struct Job_Result
+{
+  std::string name;
+  std::string stop_reason{ "not_run" };
+  std::uint32_t r0{ 0 };
+  std::uint64_t instructions{ 0 };
+  double seconds{ 0 };
+
+  [[nodiscard]] double mips() const noexcept { return seconds > 0 ? static_cast<double>(instructions) / seconds / 1'000'000 : 0; }
+};
+
+struct Program
+{
+  std::shared_ptr<const cpp_box::arm::Shared_Image> image;
+  std::uint32_t entry_point{ 0 };
+};
+
+struct Compiler_Settings
+{
+  std::filesystem::path clang_compiler;
+  std::filesystem::path freestanding_stdlib;
+  std::filesystem::path hardware_lib;
+};
+
+// one job per line: `<path> [max_instructions] [time_limit_seconds]`, blank lines and '#' comments are ignored
+std::vector<Job> read_manifest(const std::filesystem::path &manifest, const std::uint64_t default_max_instructions, const double default_time_limit)
+{
+  std::vector<Job> jobs;
+  std::ifstream ifs{ manifest };
+
+  for (std::string line; std::getline(ifs, line);) {
+    if (const auto comment = line.find('#'); comment != std::string::npos) { line.erase(comment); }
+
+    std::stringstream ss{ line };
+    std::string path;
+    if (!(ss >> path)) { continue; }
+
+    Job job{ std::filesystem::path{ path }, default_max_instructions, default_time_limit };
+    if (!(ss >> job.max_instructions)) { job.max_instructions = default_max_instructions; }
+    if (!(ss >> job.time_limit)) { job.time_limit = default_time_limit; }
+
+    // relative entries are relative to the manifest, not to wherever we happen to be run from
+    if (job.path.is_relative()) { job.path = manifest.parent_path() / job.path; }
+    jobs.push_back(std::move(job));
+  }
+
+  return jobs;
+}
+
+// loads (or compiles) a program once for every job that refers to it
+Program load_program(const std::filesystem::path &path, const Compiler_Settings &compiler, spdlog::logger &logger)
+{
+  auto loaded_files = cpp_box::load_unknown(path, logger);
+  if (!loaded_files.good_binary && !compiler.clang_compiler.empty()) {
+    loaded_files = cpp_box::compile(
+      loaded_files.src, compiler.clang_compiler, compiler.freestanding_stdlib, compiler.hardware_lib, "3", "c++2a", logger);
+  }
+
+  if (!loaded_files.good_binary) { return {}; }
+
+  return { std::make_shared<const cpp_box::arm::Shared_Image>(loaded_files.image), static_cast<std::uint32_t>(loaded_files.entry_point) };
+}
+
+Job_Result run_job(const Job &job, const Program &program)
+{
+  Job_Result result{ job.path.string() };
+
+  if (!program.image) {
+    result.stop_reason = "load_failed";
+    return result;
+  }
+
+  auto sys = std::make_unique<System>(program.image, static_cast<std::uint32_t>(cpp_box::system::Memory_Map::USER_RAM_START));
+  cpp_box::system::setup_hardware_registers(*sys);
+  sys->setup_run(program.entry_point + static_cast<std::uint32_t>(cpp_box::system::Memory_Map::USER_RAM_START));
+
+  const auto start = std::chrono::steady_clock::now();
+  const auto elapsed = [start] { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); };
+
+  while (true) {
+    if (result.instructions >= job.max_instructions) {
+      result.stop_reason = "instruction_budget";
+      break;
+    }
+
+    const auto slice      = std::min(instructions_per_slice, job.max_instructions - result.instructions);
+    const auto run_result = sys->run_for(slice);
+    result.instructions += run_result.instructions;
+
+    if (run_result.reason != cpp_box::arm::Stop_Reason::Budget_Exhausted) {
+      result.stop_reason = std::string{ cpp_box::arm::to_string(run_result.reason) };
+      break;
+    }
+
+    if (elapsed() >= job.time_limit) {
+      result.stop_reason = "time_limit";
+      break;
+    }
+  }
+
+  result.seconds = elapsed();
+  result.r0      = sys->registers[0];
+  return result;
+}
+
+std::string json_escape(const std::string_view str)
+{
+  std::string escaped;
+  for (const auto c : str) {
+    switch (c) {
+    case '"': escaped += R"(\")"; break;
+    case '\\': escaped += R"(\\)"; break;
+    case '\n': escaped += R"(\n)"; break;
+    case '\r': escaped += R"(\r)"; break;
+    case '\t': escaped += R"(\t)"; break;
+    default:
+      // any other control character has to be written as a code point
+      if (static_cast<unsigned char>(c) < 0x20) {
+        escaped += fmt::format(R"(\u{:04x})", static_cast<unsigned int>(c));
+      } else {
+        escaped += c;
+      }
+    }
+  }
+  return escaped;
+}
+
+// the contents of a quoted CSV field, with embedded quotes doubled
+std::string csv_escape(const std::string_view str)
+{
+  std::string escaped;
+  for (const auto c : str) {
+    if (c == '"') { escaped += '"'; }
+    escaped += c;
+  }
+  return escaped;
+}
+
+void write_json(std::ostream &os, const std::vector<Job_Result> &results)
+{
+  os << "[\n";
+  for (std::size_t idx = 0; idx < results.size(); ++idx) {
+    const auto &result = results[idx];
+    os << fmt::format(R"(  {{ "name": "{}", "stop_reason": "{}", "r0": {}, "instructions": {}, "seconds": {:.6f}, "mips": {:.3f} }})",
+                      json_escape(result.name),
+                      result.stop_reason,
+                      result.r0,
+                      result.instructions,
+                      result.seconds,
+                      result.mips())
+       << (idx + 1 == results.size() ? "\n" : ",\n");
+  }
+  os << "]\n";
+}
+
+void write_csv(std::ostream &os, const std::vector<Job_Result> &results)
+{
+  os << "name,stop_reason,r0,instructions,seconds,mips\n";
+  for (const auto &result : results) {
+    os << fmt::format(R"("{}",{},{},{},{:.6f},{:.3f})",
+                      csv_escape(result.name),
+                      result.stop_reason,
+                      result.r0,
+                      result.instructions,
+                      result.seconds,
+                      result.mips())
+       << '\n';
+  }
+}
+
+}  // namespace
+
+int main(const int argc, const char *argv[])
+{
+  using clara::Opt;
+  using clara::Arg;
+  using clara::Args;
+  using clara::Help;
+  bool showHelp{ false };
+  std::filesystem::path manifest;
+  std::filesystem::path output;
+  std::string format{ "json" };
+  std::size_t threads{ std::thread::hardware_concurrency() };
+  std::uint64_t max_instructions{ 1'000'000'000 };
+  double time_limit{ 60 };
+
+  Compiler_Settings compiler;
+
+  auto cli = Help(showHelp) | Opt(compiler.clang_compiler, "path")["--clang_compiler"]("compile C++ sources with <clang_compiler>")
+             | Opt(compiler.freestanding_stdlib, "path")["--freestanding_stdlib"]("freestanding stdlib implementation to use")
+             | Opt(compiler.hardware_lib, "path")["--hardware_lib"]("hardware lib implementation to use")
+             | Opt(threads, "count")["--threads"]("number of worker threads, defaults to the number of cores")
+             | Opt(max_instructions, "count")["--max_instructions"]("default per job instruction budget")
+             | Opt(time_limit, "seconds")["--time_limit"]("default per job wall clock limit")
+             | Opt(format, "json|csv")["--format"]("summary format") | Opt(output, "file")["--output"]("write the summary to <file>")
+             | Arg(manifest, "manifest")("file listing one ELF file or C++ source per line");
+
+  const auto result = cli.parse(Args(argc, argv));
+  if (!result) {
+    std::cerr << "Error in command line: " << result.errorMessage() << '\n';
+    return EXIT_FAILURE;
+  }
+
+  if (showHelp || manifest.empty()) {
+    std::cout << cli << '\n';
+    return showHelp ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  if (format != "json" && format != "csv") {
+    std::cerr << "Unknown summary format: '" << format << "'\n";
+    return EXIT_FAILURE;
+  }
+
+  if (!compiler.clang_compiler.empty()) {
+    compiler.clang_compiler = cpp_box::find_clang(compiler.clang_compiler);
+    if (compiler.clang_compiler.empty()) { std::cerr << "Unable to use provided clang compiler, C++ sources will fail to load\n"; }
+  }
+
+  auto logger = spdlog::stderr_color_mt("console");
+  logger->set_level(spdlog::level::warn);
+
+  const auto jobs = read_manifest(manifest, max_instructions, time_limit);
+  std::vector<Job_Result> results(jobs.size());
+
+  std::map<std::filesystem::path, Program> programs;
+  for (const auto &job : jobs) { programs[job.path]; }
+
+  const auto start = std::chrono::steady_clock::now();
+  {
+    cpp_box::utility::Work_Stealing_Pool pool{ threads };
+
+    // every task writes only to its own slot, so no locking is needed for programs or results
+    for (auto &[path, program] : programs) {
+      pool.submit([&, &path = path, &program = program] { program = load_program(path, compiler, *logger); });
+    }
+    pool.wait();
+
+    for (std::size_t idx = 0; idx < jobs.size(); ++idx) {
+      pool.submit([&, idx] { results[idx] = run_job(jobs[idx], programs.at(jobs[idx].path)); });
+    }
+    pool.wait();
+  }
+  const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::uint64_t total_instructions = 0;
+  for (const auto &job_result : results) { total_instructions += job_result.instructions; }
+
+  std::cerr << fmt::format("{} jobs, {} instructions in {:.3f}s ({:.3f} aggregate MIPS)\n",
+                           results.size(),
+                           total_instructions,
+                           seconds,
+                           seconds > 0 ? static_cast<double>(total_instructions) / seconds / 1'000'000 : 0.0);
+
+  std::ofstream ofs;
+  if (!output.empty()) { ofs.open(output); }
+  auto &os = output.empty() ? std::cout : ofs;
+
+  if (format == "csv") {
+    write_csv(os, results);
+  } else {
+    write_json(os, results);
+  }
+}
@@ -0,0 +1,394 @@
+#include "../include/cpp_box/arm.hpp"
+#include "../include/cpp_box/compiler.hpp"
+#include "../include/cpp_box/lockstep.hpp"
+#include "../include/cpp_box/memory_map.hpp"
+#include "../include/cpp_box/paged_ram.hpp"
+#include "../include/cpp_box/smp.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include <clara.hpp>
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+namespace {
+
+constexpr auto load_address = static_cast<std::uint32_t>(cpp_box::system::Memory_Map::USER_RAM_START);
+
+using Vector_System = cpp_box::arm::System<cpp_box::system::TOTAL_RAM, std::vector<std::uint8_t>>;
+using Paged_System  = cpp_box::arm::System<cpp_box::system::TOTAL_RAM, cpp_box::arm::Paged_RAM<cpp_box::system::TOTAL_RAM>>;
+
+// runs with every lane on the same input, so they never leave lockstep
+constexpr std::size_t lockstep_lanes = 4;
+
+struct Program
+{
+  std::string name;
+  cpp_box::Loaded_Files files;
+  std::shared_ptr<const cpp_box::arm::Shared_Image> shared_image;
+  std::uint64_t max_instructions;
+  std::optional<std::uint32_t> expected_r0;
+
+  [[nodiscard]] std::uint32_t entry_point() const noexcept { return static_cast<std::uint32_t>(files.entry_point) + load_address; }
+};
+
+// one timed run, only the emulation itself is timed and not creating the system
+struct Run
+{
+  cpp_box::arm::Stop_Reason reason{ cpp_box::arm::Stop_Reason::Budget_Exhausted };
+  std::uint32_t r0{ 0 };
+  std::uint64_t instructions{ 0 };
+  double seconds{ 0 };
+};
+
+template<typename Callable> auto timed(Callable &&callable)
+{
+  const auto start  = std::chrono::steady_clock::now();
+  auto result       = callable();
+  const auto finish = std::chrono::steady_clock::now();
+  return std::pair{ std::move(result), std::chrono::duration<double>(finish - start).count() };
+}
+
+template<typename System> Run run_system(System &sys, const Program &program, const std::uint64_t max_instructions)
+{
+  cpp_box::system::setup_hardware_registers(sys);
+  sys.setup_run(program.entry_point());
+
+  const auto [result, seconds] = timed([&] { return sys.run_for(max_instructions); });
+  return { result.reason, sys.registers[0], result.instructions, seconds };
+}
+
+Run run_vector(const Program &program, const std::uint64_t max_instructions)
+{
+  auto sys = std::make_unique<Vector_System>(program.files.image, load_address);
+  return run_system(*sys, program, max_instructions);
+}
+
+Run run_paged(const Program &program, const std::uint64_t max_instructions)
+{
+  auto sys = std::make_unique<Paged_System>(program.shared_image, load_address);
+  return run_system(*sys, program, max_instructions);
+}
+
+// A single core, so no secondary threads are started and only the boot core's run is timed.
+// What it measures against "vector" is the cost of Shared_RAM's atomic accesses.
+Run run_smp(const Program &program, const std::uint64_t max_instructions)
+{
+  auto machine = std::make_unique<cpp_box::arm::SMP_System<cpp_box::system::TOTAL_RAM>>(program.files.image, load_address, 1);
+  cpp_box::system::setup_hardware_registers(machine->core(0));
+
+  const auto [results, seconds] = timed([&] { return machine->run(program.entry_point(), max_instructions); });
+  return { results.front().reason, machine->core(0).registers[0], results.front().instructions, seconds };
+}
+
+// MIPS here are summed over the lanes
+Run run_lockstep(const Program &program, const std::uint64_t max_instructions)
+{
+  auto prototype = std::make_unique<Paged_System>(program.shared_image, load_address);
+  cpp_box::system::setup_hardware_registers(*prototype);
+  prototype->setup_run(program.entry_point());
+
+  auto lanes = std::make_unique<cpp_box::arm::Lockstep_System<Paged_System, lockstep_lanes>>(*prototype);
+
+  const auto [results, seconds] = timed([&] { return lanes->run_for(max_instructions); });
+
+  std::uint64_t instructions = 0;
+  for (const auto &result : results) { instructions += result.instructions; }
+  return { results.front().reason, lanes->lane(0).registers[0], instructions, seconds };
+}
+
+struct Engine
+{
+  std::string_view name;
+  Run (*run)(const Program &, std::uint64_t);
+};
+
+constexpr std::array<Engine, 4> engines{
+  { { "vector", run_vector }, { "paged", run_paged }, { "smp", run_smp }, { "lockstep", run_lockstep } }
+};
+
+struct Benchmark_Result
+{
+  std::string name;
+  std::string engine;
+  std::string stop_reason{ "load_failed" };
+  std::string result{ "unchecked" };
+  std::uint32_t r0{ 0 };
+  std::uint64_t instructions{ 0 };
+  std::vector<double> seconds{};
+
+  [[nodiscard]] double median_seconds() const
+  {
+    if (seconds.empty()) { return 0; }
+    auto sorted = seconds;
+    std::sort(sorted.begin(), sorted.end());
+    const auto middle = sorted.size() / 2;
+    return sorted.size() % 2 == 1 ? sorted[middle] : (sorted[middle - 1] + sorted[middle]) / 2;
+  }
+
+  [[nodiscard]] double min_seconds() const { return seconds.empty() ? 0 : *std::min_element(seconds.begin(), seconds.end()); }
+
+  // from the median, which one slow repetition doesn't move
+  [[nodiscard]] double mips() const
+  {
+    const auto median = median_seconds();
+    return median > 0 ? static_cast<double>(instructions) / median / 1'000'000 : 0;
+  }
+};
+
+Benchmark_Result benchmark(const Program &program, const Engine &engine, const std::size_t warmups, const std::size_t repetitions)
+{
+  const auto max_instructions = program.max_instructions;
+
+  Benchmark_Result result{ program.name, std::string{ engine.name } };
+  if (!program.files.good_binary) { return result; }
+
+  for (std::size_t warmup = 0; warmup < warmups; ++warmup) { engine.run(program, max_instructions); }
+
+  for (std::size_t repetition = 0; repetition < repetitions; ++repetition) {
+    const auto run = engine.run(program, max_instructions);
+    if (repetition == 0) {
+      result.stop_reason  = std::string{ cpp_box::arm::to_string(run.reason) };
+      result.r0           = run.r0;
+      result.instructions = run.instructions;
+    } else if (run.instructions != result.instructions || run.r0 != result.r0) {
+      // the guests are expected to be deterministic, timings of different work can't be compared
+      result.stop_reason = "nondeterministic";
+    }
+    result.seconds.push_back(run.seconds);
+  }
+
+  // a program with a known result has to get all the way to it for its timing to mean anything
+  if (program.expected_r0) {
+    result.result = result.stop_reason == "exited" && result.r0 == *program.expected_r0 ? "ok" : "wrong";
+  }
+
+  return result;
+}
+
+// every .cpp in a directory, in a stable order, or the file itself
+std::vector<std::filesystem::path> find_sources(const std::vector<std::string> &inputs)
+{
+  std::vector<std::filesystem::path> sources;
+  for (const auto &input : inputs) {
+    if (std::filesystem::is_directory(input)) {
+      std::vector<std::filesystem::path> found;
+      for (const auto &entry : std::filesystem::directory_iterator{ input }) {
+        if (entry.is_regular_file() && entry.path().extension() == ".cpp") { found.push_back(entry.path()); }
+      }
+      std::sort(found.begin(), found.end());
+      sources.insert(sources.end(), found.begin(), found.end());
+    } else {
+      sources.emplace_back(input);
+    }
+  }
+  return sources;
+}
+
+// C++ sources can carry `// max_instructions: <count>` and `// expected_r0: <value>` comments,
+// giving the program's own budget and the result it has to finish with
+Program load_program(const std::filesystem::path &path,
+                     const std::filesystem::path &clang_compiler,
+                     const std::filesystem::path &freestanding_stdlib,
+                     const std::filesystem::path &hardware_lib,
+                     const std::uint64_t default_max_instructions,
+                     spdlog::logger &logger)
+{
+  auto files = cpp_box::load_unknown(path, logger);
+
+  auto max_instructions = default_max_instructions;
+  std::optional<std::uint32_t> expected_r0;
+  if (!files.good_binary) {
+    const std::regex read_max_instructions{ R"(// max_instructions: ([0-9]+))" };
+    const std::regex read_expected_r0{ R"(// expected_r0: (0x[0-9a-fA-F]+|[0-9]+))" };
+
+    std::smatch results;
+    if (std::regex_search(files.src, results, read_max_instructions)) { max_instructions = std::stoull(results.str(1)); }
+    if (std::regex_search(files.src, results, read_expected_r0)) {
+      expected_r0 = static_cast<std::uint32_t>(std::stoul(results.str(1), nullptr, 0));
+    }
+  }
+
+  if (!files.good_binary && !clang_compiler.empty()) {
+    files = cpp_box::compile(files.src, clang_compiler, freestanding_stdlib, hardware_lib, "3", "c++2a", logger);
+  }
+
+  auto shared_image = files.good_binary ? std::make_shared<const cpp_box::arm::Shared_Image>(files.image) : nullptr;
+  return { path.stem().string(), std::move(files), std::move(shared_image), max_instructions, expected_r0 };
+}
+
+void write_json(std::ostream &os, const std::vector<Benchmark_Result> &results)
+{
+  os << "[\n";
+  for (std::size_t idx = 0; idx < results.size(); ++idx) {
+    const auto &result = results[idx];
+    os << fmt::format(
+      R"(  {{ "name": "{}", "engine": "{}", "stop_reason": "{}", "result": "{}", "r0": {}, "instructions": {}, "repetitions": {}, "median_seconds": {:.6f}, "min_seconds": {:.6f}, "mips": {:.3f} }})",
+      result.name,
+      result.engine,
+      result.stop_reason,
+      result.result,
+      result.r0,
+      result.instructions,
+      result.seconds.size(),
+      result.median_seconds(),
+      result.min_seconds(),
+      result.mips())
+       << (idx + 1 == results.size() ? "\n" : ",\n");
+  }
+  os << "]\n";
+}
+
+// reads back the MIPS from a file written by `write_json`, keyed by (name, engine)
+std::map<std::pair<std::string, std::string>, double> read_baseline(const std::filesystem::path &path)
+{
+  const std::regex read_name{ R"re("name": "([^"]*)")re" };
+  const std::regex read_engine{ R"re("engine": "([^"]*)")re" };
+  const std::regex read_mips{ R"re("mips": ([0-9.]+))re" };
+
+  std::map<std::pair<std::string, std::string>, double> baseline;
+  std::ifstream ifs{ path };
+  for (std::string line; std::getline(ifs, line);) {
+    std::smatch name;
+    std::smatch engine;
+    std::smatch mips;
+    if (std::regex_search(line, name, read_name) && std::regex_search(line, engine, read_engine) && std::regex_search(line, mips, read_mips)) {
+      baseline[{ name.str(1), engine.str(1) }] = std::stod(mips.str(1));
+    }
+  }
+  return baseline;
+}
+
+// returns how many benchmarks got slower by more than `threshold` percent
+std::size_t compare(const std::vector<Benchmark_Result> &results, const std::map<std::pair<std::string, std::string>, double> &baseline, const double threshold)
+{
+  std::size_t regressions = 0;
+  std::cerr << fmt::format("{:<24} {:<10} {:>12} {:>12} {:>9}\n", "benchmark", "engine", "baseline", "MIPS", "change");
+  for (const auto &result : results) {
+    const auto previous = baseline.find({ result.name, result.engine });
+    if (previous == baseline.end() || previous->second <= 0) {
+      std::cerr << fmt::format("{:<24} {:<10} {:>12} {:>12.3f}\n", result.name, result.engine, "-", result.mips());
+      continue;
+    }
+
+    const auto change     = (result.mips() - previous->second) / previous->second * 100;
+    const auto regression = change < -threshold;
+    if (regression) { ++regressions; }
+    std::cerr << fmt::format("{:<24} {:<10} {:>12.3f} {:>12.3f} {:>+8.1f}%{}\n",
+                             result.name,
+                             result.engine,
+                             previous->second,
+                             result.mips(),
+                             change,
+                             regression ? " REGRESSION" : "");
+  }
+  return regressions;
+}
+
+}  // namespace
+
+int main(const int argc, const char *argv[])
+{
+  using clara::Opt;
+  using clara::Arg;
+  using clara::Args;
+  using clara::Help;
+  bool showHelp{ false };
+  std::vector<std::string> inputs;
+  std::filesystem::path user_provided_clang;
+  std::filesystem::path freestanding_stdlib;
+  std::filesystem::path hardware_lib;
+  std::vector<std::string> selected_engines;
+  std::size_t warmups{ 1 };
+  std::size_t repetitions{ 5 };
+  std::uint64_t max_instructions{ 100'000'000 };
+  std::filesystem::path baseline;
+  double threshold{ 5 };
+  std::filesystem::path output;
+
+  auto cli = Help(showHelp) | Opt(user_provided_clang, "path")["--clang_compiler"]("compile C++ sources with <clang_compiler>")
+             | Opt(freestanding_stdlib, "path")["--freestanding_stdlib"]("freestanding stdlib implementation to use")
+             | Opt(hardware_lib, "path")["--hardware_lib"]("hardware lib implementation to use")
+             | Opt(selected_engines, "vector|paged|smp|lockstep")["--engine"]("only run with <engine>, can be given more than once, defaults to all")
+             | Opt(warmups, "count")["--warmups"]("untimed runs before the timed ones, defaults to 1")
+             | Opt(repetitions, "count")["--repetitions"]("timed runs, the median is reported, defaults to 5")
+             | Opt(max_instructions, "count")["--max_instructions"]("per run instruction budget, for sources that don't give their own")
+             | Opt(baseline, "file")["--baseline"]("compare MIPS against the results in <file>, written by an earlier --output")
+             | Opt(threshold, "percent")["--threshold"]("how much slower than the baseline counts as a regression, defaults to 5")
+             | Opt(output, "file")["--output"]("write the results to <file> as JSON")
+             | Arg(inputs, "file|directory")("C++ sources or ELF files, or directories of C++ sources");
+
+  const auto result = cli.parse(Args(argc, argv));
+  if (!result) {
+    std::cerr << "Error in command line: " << result.errorMessage() << '\n';
+    return EXIT_FAILURE;
+  }
+
+  if (showHelp || inputs.empty()) {
+    std::cout << cli << '\n';
+    return showHelp ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  std::vector<Engine> to_run;
+  for (const auto &engine : engines) {
+    if (selected_engines.empty() || std::find(selected_engines.begin(), selected_engines.end(), engine.name) != selected_engines.end()) {
+      to_run.push_back(engine);
+    }
+  }
+  if (to_run.empty() || repetitions == 0) {
+    std::cerr << "Nothing to run, check --engine and --repetitions\n";
+    return EXIT_FAILURE;
+  }
+
+  const auto clang_compiler = cpp_box::find_clang(user_provided_clang, "/usr/local/bin/clang++", "/usr/bin/clang++");
+  if (clang_compiler.empty()) { std::cerr << "Unable to locate a viable clang compiler, C++ sources will fail to load\n"; }
+
+  auto logger = spdlog::stderr_color_mt("console");
+  logger->set_level(spdlog::level::warn);
+
+  std::vector<Benchmark_Result> results;
+  for (const auto &source : find_sources(inputs)) {
+    const auto program = load_program(source, clang_compiler, freestanding_stdlib, hardware_lib, max_instructions, *logger);
+    if (!program.files.good_binary) { std::cerr << "Unable to load: " << source << '\n'; }
+
+    for (const auto &engine : to_run) {
+      results.push_back(benchmark(program, engine, warmups, repetitions));
+      const auto &latest = results.back();
+      std::cerr << fmt::format(
+        "{} ({}): {} instructions, {:.3f} MIPS, result {}\n", latest.name, latest.engine, latest.instructions, latest.mips(), latest.result);
+    }
+  }
+
+  if (!output.empty()) {
+    std::ofstream ofs{ output };
+    write_json(ofs, results);
+  } else {
+    write_json(std::cout, results);
+  }
+
+  if (!baseline.empty()) {
+    if (!std::filesystem::exists(baseline)) {
+      // nothing to compare against isn't a pass, or a regression would go unnoticed
+      std::cerr << "No baseline at " << baseline << ", write one from a known good build with --output " << baseline << '\n';
+      return EXIT_FAILURE;
+    } else if (const auto regressions = compare(results, read_baseline(baseline), threshold); regressions != 0) {
+      std::cerr << regressions << " benchmark(s) regressed by more than " << threshold << "%\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  const auto failed = std::count_if(results.begin(), results.end(), [](const auto &bench) {
+    return bench.stop_reason == "load_failed" || bench.stop_reason == "nondeterministic" || bench.result == "wrong";
+  });
+  return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,9 +1,17 @@
+#include <algorithm>
+#include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 
+#include <clara.hpp>
+
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
 
@@ -11,7 +19,23 @@
 
 #include "../include/cpp_box/arm.hpp"
 #include "../include/cpp_box/compiler.hpp"
+#include "../include/cpp_box/coverage.hpp"
+#include "../include/cpp_box/differential.hpp"
+#include "../include/cpp_box/disassembler.hpp"
+#include "../include/cpp_box/elf_reader.hpp"
+#include "../include/cpp_box/host_counters.hpp"
+#include "../include/cpp_box/memory_heatmap.hpp"
 #include "../include/cpp_box/memory_map.hpp"
+#include "../include/cpp_box/mmio.hpp"
+#include "../include/cpp_box/paged_ram.hpp"
+#include "../include/cpp_box/profiler.hpp"
+#include "../include/cpp_box/smp.hpp"
+#include "../include/cpp_box/stats.hpp"
+#include "../include/cpp_box/symbols.hpp"
+#include "../include/cpp_box/timing.hpp"
+#include "../include/cpp_box/trace.hpp"
+#include "../include/cpp_box/unwind.hpp"
+#include "../include/cpp_box/watchpoints.hpp"
 
 template<typename Cont> void dump_rom(const Cont &c)
 {
@@ -52,40 +76,637 @@ template<typename System, typename Registers> void dump_state(const System &sys,
   std::cout << '\n';
 }
 
-int main(const int argc, const char *argv[]) // NOLINT
+// `<address>[+<length>][:r|:w|:rw]`, by default watching 4 bytes for writes
+std::optional<cpp_box::arm::Watchpoint> parse_watchpoint(const std::string &spec)
+{
+  try {
+    std::size_t used     = 0;
+    const auto start     = static_cast<std::uint32_t>(std::stoul(spec, &used, 0));
+    auto rest            = spec.substr(used);
+    std::uint32_t length = 4;
+
+    if (!rest.empty() && rest.front() == '+') {
+      length = static_cast<std::uint32_t>(std::stoul(rest.substr(1), &used, 0));
+      rest   = rest.substr(used + 1);
+    }
+
+    if (rest.empty() || rest == ":w") { return cpp_box::arm::Watchpoint{ start, start + length, cpp_box::arm::Watch::Write }; }
+    if (rest == ":r") { return cpp_box::arm::Watchpoint{ start, start + length, cpp_box::arm::Watch::Read }; }
+    if (rest == ":rw") { return cpp_box::arm::Watchpoint{ start, start + length, cpp_box::arm::Watch::Access }; }
+  } catch (const std::exception &) {
+    // fall through to rejecting it
+  }
+
+  return std::nullopt;
+}
+
+using MMIO = cpp_box::system::Recorded_MMIO<cpp_box::system::Random_Device>;
+
+struct Run_Options
+{
+  std::filesystem::path trace;
+  std::vector<cpp_box::arm::Watchpoint> watchpoints;
+  MMIO mmio;
+  std::filesystem::path profile;
+  std::uint64_t sample_interval;
+  std::size_t top;
+  cpp_box::Unwinder::Method unwind;
+  std::filesystem::path coverage;
+  bool stats;
+};
+
+using Watchpoints  = cpp_box::arm::Watchpoints<cpp_box::system::TOTAL_RAM>;
+using Page_Heatmap = cpp_box::arm::Page_Heatmap<cpp_box::system::TOTAL_RAM>;
+
+// which pages the guest touched, and how often, with a guess at what they are from the memory map
+template<typename System> void print_heatmap(const System &sys, const std::uint32_t image_start, const std::uint32_t image_end)
+{
+  const auto &heatmap    = static_cast<const Page_Heatmap &>(sys.memory_hooks);
+  const auto screen      = sys.read_word(static_cast<std::uint32_t>(cpp_box::system::Memory_Map::SCREEN_BUFFER));
+  const auto screen_size = std::uint32_t{ sys.read_half_word(static_cast<std::uint32_t>(cpp_box::system::Memory_Map::SCREEN_WIDTH)) }
+                           * sys.read_half_word(static_cast<std::uint32_t>(cpp_box::system::Memory_Map::SCREEN_HEIGHT)) * 4;
+
+  const auto overlaps = [](const std::uint32_t page_start, const std::uint32_t start, const std::uint32_t end) {
+    return page_start < end && page_start + Page_Heatmap::page_size > start;
+  };
+  const auto region = [&](const std::uint32_t page_start) -> std::string_view {
+    if (page_start == 0) { return "registers"; }
+    if (overlaps(page_start, image_start, image_end)) { return "image"; }
+    if (overlaps(page_start, screen, screen + screen_size)) { return "screen"; }
+    if (page_start >= screen + screen_size && screen_size != 0) { return "stack"; }
+    return "";
+  };
+
+  std::cout << fmt::format("\nMemory heatmap: {} pages touched ({} KB)\n", heatmap.pages_touched(), heatmap.pages_touched() * Page_Heatmap::page_size / 1024);
+  std::cout << fmt::format("{:>10} {:>12} {:>12}  {}\n", "page", "reads", "writes", "region");
+
+  std::uint32_t deepest_stack = cpp_box::system::TOTAL_RAM;
+  for (std::size_t page = 0; page < Page_Heatmap::page_count; ++page) {
+    if (heatmap.reads(page) == 0 && heatmap.writes(page) == 0) { continue; }
+
+    const auto page_start = static_cast<std::uint32_t>(page * Page_Heatmap::page_size);
+    const auto name       = region(page_start);
+    if (name == "stack") { deepest_stack = std::min(deepest_stack, page_start); }
+    std::cout << fmt::format("{:#010x} {:>12} {:>12}  {}\n", page_start, heatmap.reads(page), heatmap.writes(page), name);
+  }
+
+  std::cout << fmt::format("Stack depth: up to {} KB\n", (cpp_box::system::TOTAL_RAM - deepest_stack) / 1024);
+}
+
+// the emulator's own efficiency, in terms of the guest's work
+void print_host_counters(const cpp_box::Host_Counters &counters,
+                         const std::uint64_t guest_instructions,
+                         const std::optional<std::uint64_t> guest_branches)
+{
+  if (!counters.available()) {
+    std::cerr << "Host counters unavailable: " << counters.error() << '\n';
+    return;
+  }
+
+  using Event        = cpp_box::Host_Counters::Event;
+  const auto reading = counters.read();
+  const auto per     = [](const std::uint64_t count, const std::uint64_t whole) {
+    return whole == 0 ? 0.0 : static_cast<double>(count) / static_cast<double>(whole);
+  };
+
+  std::cout << "\nHost counters, emulating thread only:\n";
+  if (const auto cycles = reading[Event::Cycles]; cycles) {
+    std::cout << fmt::format("  cycles: {} ({:.2f} per guest instruction)\n", *cycles, per(*cycles, guest_instructions));
+  }
+  if (const auto instructions = reading[Event::Instructions]; instructions) {
+    std::cout << fmt::format("  instructions: {} ({:.2f} per guest instruction", *instructions, per(*instructions, guest_instructions));
+    if (const auto cycles = reading[Event::Cycles]; cycles) { std::cout << fmt::format(", IPC {:.2f}", per(*instructions, *cycles)); }
+    std::cout << ")\n";
+  }
+  if (const auto misses = reading[Event::Branch_Misses]; misses) {
+    std::cout << fmt::format("  branch misses: {} (", *misses);
+    if (guest_branches) { std::cout << fmt::format("{:.4f} per guest branch, ", per(*misses, *guest_branches)); }
+    std::cout << fmt::format("{:.4f} per guest instruction)\n", per(*misses, guest_instructions));
+  }
+  if (const auto misses = reading[Event::Cache_Misses]; misses) {
+    std::cout << fmt::format("  cache misses: {} ({:.4f} per guest instruction)\n", *misses, per(*misses, guest_instructions));
+  }
+}
+
+void print_stats(const cpp_box::arm::Emulator_Stats &stats)
+{
+  const auto percent = [](const std::uint64_t part, const std::uint64_t whole) {
+    return whole == 0 ? 0.0 : 100.0 * static_cast<double>(part) / static_cast<double>(whole);
+  };
+
+  std::cout << "\nEmulator stats:\n";
+  std::cout << fmt::format("  I-cache: {} hits, {} misses ({:.4f}%), {} refills\n",
+                           stats.cache_hits(),
+                           stats.cache_misses,
+                           percent(stats.cache_misses, stats.fetches),
+                           stats.cache_refills);
+  std::cout << fmt::format("  Invalid memory writes: {}\n", stats.invalid_writes);
+  stats.for_each_mmio_register([](const std::uint32_t loc, const std::uint64_t reads) {
+    std::cout << fmt::format("  MMIO reads from {:#010x}: {}\n", loc, reads);
+  });
+  if (stats.other_mmio_reads != 0) { std::cout << fmt::format("  MMIO reads from other registers: {}\n", stats.other_mmio_reads); }
+
+  std::uint64_t total = 0;
+  for (const auto count : stats.instructions) { total += count; }
+  std::cout << "  Instructions by type:\n";
+  for (std::size_t type = 0; type < stats.instructions.size(); ++type) {
+    if (stats.instructions[type] == 0) { continue; }
+    std::cout << fmt::format("    {:<30} {:>14} {:>7.2f}%\n",
+                             cpp_box::arm::to_string(static_cast<cpp_box::arm::Instruction_Type>(type)),
+                             stats.instructions[type],
+                             percent(stats.instructions[type], total));
+  }
+}
+
+template<typename Memory_Hooks, typename Stats> void run_system(const cpp_box::Loaded_Files &loaded_files, const Run_Options &options, spdlog::logger &logger)
+{
+  constexpr bool watching    = std::is_base_of_v<Watchpoints, Memory_Hooks>;
+  constexpr bool heatmapping = std::is_base_of_v<Page_Heatmap, Memory_Hooks>;
+
+  const auto load_address = static_cast<std::uint32_t>(cpp_box::system::Memory_Map::USER_RAM_START);
+  const auto entry_point  = static_cast<std::uint32_t>(loaded_files.entry_point) + load_address;
+
+  auto sys = std::make_unique<cpp_box::arm::System<cpp_box::system::TOTAL_RAM,
+                                                   std::vector<std::uint8_t>,
+                                                   MMIO,
+                                                   cpp_box::arm::ARM7TDMI_Timing,
+                                                   Memory_Hooks,
+                                                   Stats>>(loaded_files.image, load_address, MMIO{ options.mmio });
+
+  logger.trace("setting up registers");
+  cpp_box::system::setup_hardware_registers(*sys);
+  //dump_rom(RAM);
+
+  if constexpr (watching) {
+    for (const auto &watchpoint : options.watchpoints) { sys->memory_hooks.add(watchpoint); }
+  }
+
+  const auto symbols = loaded_files.good_binary ? cpp_box::Symbol_Table{ cpp_box::elf::File_Header{ loaded_files.image }, load_address }
+                                                : cpp_box::Symbol_Table{};
+
+  const auto report_watchpoints = [&] {
+    if constexpr (watching) {
+      for (const auto &hit : sys->memory_hooks.hits) {
+        std::cout << fmt::format("Watchpoint: {} of {} bytes at {:#010x}, {:#x} -> {:#x}, by {}",
+                                 hit.write ? "write" : "read",
+                                 hit.size,
+                                 hit.address,
+                                 hit.old_value,
+                                 hit.new_value,
+                                 symbols.describe(hit.pc));
+        if (const auto location = loaded_files.location_data.find(hit.pc - load_address); location != loaded_files.location_data.end()) {
+          std::cout << fmt::format(" (line {})", location->second.line_number);
+        }
+        std::cout << '\n';
+      }
+      sys->memory_hooks.hits.clear();
+    }
+  };
+
+  //    auto last_registers = sys->registers;
+
+  cpp_box::Sampling_Profile profile;
+  const auto profiling = !options.profile.empty() && options.sample_interval != 0;
+
+  const auto unwinder = loaded_files.good_binary ? cpp_box::Unwinder{ cpp_box::elf::File_Header{ loaded_files.image },
+                                                                      load_address,
+                                                                      static_cast<std::uint32_t>(loaded_files.image.size()),
+                                                                      options.unwind }
+                                                 : cpp_box::Unwinder{};
+  if (profiling && unwinder.method() == cpp_box::Unwinder::Method::Tables && !unwinder.has_tables()) {
+    std::cerr << "No .ARM.exidx unwind tables found, only the sampled PC will be profiled\n";
+  }
+  std::vector<std::uint32_t> stack;
+
+  // Watchpoints stop the run so that they're reported as they happen. When profiling, the run
+  // is split into slices of `sample_interval` instructions and the PC is sampled in between,
+  // which costs nothing per instruction.
+  const auto run_to_end = [&](auto &&tracer) {
+    sys->setup_run(entry_point);
+
+    constexpr auto max_instructions = std::numeric_limits<std::uint64_t>::max();
+    auto until_sample               = profiling ? options.sample_interval : max_instructions;
+
+    cpp_box::arm::Run_Result total{ cpp_box::arm::Stop_Reason::Exited, 0 };
+    do {
+      const auto slice = sys->run_for(std::min(until_sample, max_instructions - total.instructions), tracer);
+      total            = { slice.reason, total.instructions + slice.instructions };
+      report_watchpoints();
+
+      if (profiling && (until_sample -= slice.instructions) == 0) {
+        unwinder.unwind(*sys, stack);
+        profile.add_sample(stack);
+        until_sample = options.sample_interval;
+      }
+    } while (total.reason == cpp_box::arm::Stop_Reason::Watchpoint
+             || (profiling && total.reason == cpp_box::arm::Stop_Reason::Budget_Exhausted && total.instructions != max_instructions));
+
+    return total;
+  };
+
+  cpp_box::arm::Coverage coverage{ load_address, static_cast<std::uint32_t>(loaded_files.image.size()) };
+  const auto run_covered = [&](auto &&tracer) {
+    if (options.coverage.empty()) { return run_to_end(tracer); }
+    return run_to_end([&](const auto &system, const std::uint32_t pc, const cpp_box::arm::Instruction ins) {
+      tracer(system, pc, ins);
+      coverage(system, pc, ins);
+    });
+  };
+
+  //    cpp_box::utility::runtime_assert(sys->SP() == cpp_box::system::STACK_START);
+  const auto run_result = [&] {
+    if (options.trace.empty()) { return run_covered(cpp_box::arm::NO_TRACER{}); }
+
+    cpp_box::arm::Binary_Trace_Writer writer{ options.trace };
+    if (!writer.good()) { std::cerr << "Unable to write trace file: " << options.trace << '\n'; }
+
+    cpp_box::arm::Binary_Tracer tracer{ writer };
+    const auto traced_result = run_covered(tracer);
+    tracer.finish(*sys);
+    return traced_result;
+  }();
+
+  std::cout << "Total instructions executed: " << run_result.instructions << '\n';
+  std::cout << "Modeled ARM7TDMI cycles: " << sys->timing.cycles() << " (" << sys->timing.s_cycles << "S " << sys->timing.n_cycles << "N "
+            << sys->timing.i_cycles << "I)\n";
+  if (run_result.reason != cpp_box::arm::Stop_Reason::Exited) { std::cout << "Stopped: " << cpp_box::arm::to_string(run_result.reason) << '\n'; }
+
+  if (profiling) {
+    std::ofstream collapsed{ options.profile };
+    profile.write_collapsed(collapsed, symbols);
+    if (!collapsed) { std::cerr << "Unable to write profile: " << options.profile << '\n'; }
+
+    const auto samples = profile.sample_count();
+    std::cout << fmt::format("\nProfile: {} samples, one every {} instructions\n", samples, options.sample_interval);
+    std::cout << fmt::format("{:>8} {:>8}  {}\n", "self %", "total %", "function");
+    for (const auto &function : profile.top_functions(symbols, options.top)) {
+      std::cout << fmt::format("{:>8.2f} {:>8.2f}  {}\n",
+                               100.0 * static_cast<double>(function.self) / static_cast<double>(samples),
+                               100.0 * static_cast<double>(function.total) / static_cast<double>(samples),
+                               function.name);
+    }
+  }
+
+  if (!options.coverage.empty()) {
+    if (loaded_files.location_data.empty()) { std::cerr << "No DWARF line information found, build the guest with -g for coverage\n"; }
+
+    std::ofstream info{ options.coverage };
+    const auto summary = cpp_box::write_lcov(info, coverage, loaded_files);
+    if (!info) { std::cerr << "Unable to write coverage: " << options.coverage << '\n'; }
+
+    std::cout << fmt::format("Line coverage: {} of {} lines\n", summary.lines_hit, summary.lines);
+  }
+
+  if constexpr (std::is_same_v<Stats, cpp_box::arm::Emulator_Stats>) {
+    if (options.stats) { print_stats(sys->stats); }
+  }
+
+  if constexpr (heatmapping) { print_heatmap(*sys, load_address, load_address + static_cast<std::uint32_t>(loaded_files.image.size())); }
+
+  if (sys->mmio_callback.exhausted()) { std::cerr << "Warning: the guest read more MMIO values than were recorded, the replay diverged\n"; }
+}
+
+// the counting costs a little on every instruction, so it's only compiled in when asked for
+template<typename Memory_Hooks> void run_single_core(const cpp_box::Loaded_Files &loaded_files, const Run_Options &options, spdlog::logger &logger)
+{
+  if (options.stats) {
+    run_system<Memory_Hooks, cpp_box::arm::Emulator_Stats>(loaded_files, options, logger);
+  } else {
+    run_system<Memory_Hooks, cpp_box::arm::NO_STATS>(loaded_files, options, logger);
+  }
+}
+
+// The guest branches a second, uncounted, run of the program executes. The branch count needs
+// Emulator_Stats, which the counted run can't have. The runs read the same MMIO values: the
+// random device is copied in the state the counted run started from, and a replay reads the
+// same log. nullopt if the runs execute different numbers of instructions after all.
+std::optional<std::uint64_t>
+  count_guest_branches(const cpp_box::Loaded_Files &loaded_files, const Run_Options &options, const std::uint64_t guest_instructions)
+{
+  const auto load_address = static_cast<std::uint32_t>(cpp_box::system::Memory_Map::USER_RAM_START);
+  const auto entry_point  = static_cast<std::uint32_t>(loaded_files.entry_point) + load_address;
+
+  // recording again would overwrite the log with the same values, so read the devices directly
+  auto mmio = options.mmio.mode == cpp_box::system::MMIO_Mode::Record ? MMIO{ options.mmio.devices } : options.mmio;
+
+  using Counting_System = cpp_box::arm::System<cpp_box::system::TOTAL_RAM,
+                                               std::vector<std::uint8_t>,
+                                               MMIO,
+                                               cpp_box::arm::NO_TIMING,
+                                               cpp_box::arm::NO_MEMORY_HOOKS,
+                                               cpp_box::arm::Emulator_Stats>;
+  auto sys = std::make_unique<Counting_System>(loaded_files.image, load_address, std::move(mmio));
+  cpp_box::system::setup_hardware_registers(*sys);
+  sys->setup_run(entry_point);
+
+  if (sys->run_for(std::numeric_limits<std::uint64_t>::max()).instructions != guest_instructions) {
+    std::cerr << "Warning: the run counting guest branches diverged from the measured one\n";
+    return std::nullopt;
+  }
+  return sys->stats.instruction_count(cpp_box::arm::Instruction_Type::Branch);
+}
+
+// The host counters measure the engine the way arm_bench runs it, with no timing model, memory
+// hooks, stats or tracer, and only around run_for itself.
+void run_host_counted(const cpp_box::Loaded_Files &loaded_files, const Run_Options &options)
+{
+  const auto load_address = static_cast<std::uint32_t>(cpp_box::system::Memory_Map::USER_RAM_START);
+  const auto entry_point  = static_cast<std::uint32_t>(loaded_files.entry_point) + load_address;
+
+  auto sys = std::make_unique<cpp_box::arm::System<cpp_box::system::TOTAL_RAM, std::vector<std::uint8_t>, MMIO>>(
+    loaded_files.image, load_address, MMIO{ options.mmio });
+  cpp_box::system::setup_hardware_registers(*sys);
+  sys->setup_run(entry_point);
+
+  cpp_box::Host_Counters counters;
+  counters.start();
+  const auto run_result = sys->run_for(std::numeric_limits<std::uint64_t>::max());
+  counters.stop();
+
+  std::cout << "Total instructions executed: " << run_result.instructions << '\n';
+  if (run_result.reason != cpp_box::arm::Stop_Reason::Exited) { std::cout << "Stopped: " << cpp_box::arm::to_string(run_result.reason) << '\n'; }
+  const auto guest_branches = counters.available() ? count_guest_branches(loaded_files, options, run_result.instructions) : std::nullopt;
+  print_host_counters(counters, run_result.instructions, guest_branches);
+
+  if (sys->mmio_callback.exhausted()) { std::cerr << "Warning: the guest read more MMIO values than were recorded, the replay diverged\n"; }
+}
+
+// the engines --verify_engine compares, all with the same seeded random device so that they read the same numbers
+using Verified_RAM_Hooks = cpp_box::arm::Dirty_Pages<cpp_box::system::TOTAL_RAM>;
+using Reference_System   = cpp_box::arm::System<cpp_box::system::TOTAL_RAM,
+                                              std::vector<std::uint8_t>,
+                                              cpp_box::system::Random_Device,
+                                              cpp_box::arm::NO_TIMING,
+                                              Verified_RAM_Hooks>;
+using Paged_System       = cpp_box::arm::System<cpp_box::system::TOTAL_RAM,
+                                          cpp_box::arm::Paged_RAM<cpp_box::system::TOTAL_RAM>,
+                                          cpp_box::system::Random_Device,
+                                          cpp_box::arm::NO_TIMING,
+                                          Verified_RAM_Hooks>;
+
+void print_divergence(const cpp_box::arm::Divergence &divergence, const cpp_box::Symbol_Table &symbols)
+{
+  using Kind = cpp_box::arm::Divergence::Kind;
+
+  std::cout << fmt::format("Engines diverged after {} instructions, they last agreed after {}\n", divergence.instructions, divergence.last_match);
+  std::cout << fmt::format("  last instruction: {:#010x} {}: {}\n",
+                           divergence.pc,
+                           symbols.describe(divergence.pc),
+                           cpp_box::arm::disassemble(divergence.instruction, divergence.pc));
+
+  for (const auto &difference : divergence.differences) {
+    switch (difference.kind) {
+    case Kind::Stop_Reason:
+      std::cout << fmt::format("  stop reason: expected {}, got {}\n",
+                               cpp_box::arm::to_string(static_cast<cpp_box::arm::Stop_Reason>(difference.expected)),
+                               cpp_box::arm::to_string(static_cast<cpp_box::arm::Stop_Reason>(difference.actual)));
+      break;
+    case Kind::Instructions: std::cout << fmt::format("  instructions: expected {}, got {}\n", difference.expected, difference.actual); break;
+    case Kind::Register:
+      std::cout << fmt::format("  r{}: expected {:#010x}, got {:#010x}\n", difference.where, difference.expected, difference.actual);
+      break;
+    case Kind::CSPR: std::cout << fmt::format("  CSPR: expected {:#010x}, got {:#010x}\n", difference.expected, difference.actual); break;
+    case Kind::Memory:
+      std::cout << fmt::format("  memory at {:#010x}: expected {:#04x}, got {:#04x}\n", difference.where, difference.expected, difference.actual);
+      break;
+    case Kind::Invalid_Write:
+      std::cout << fmt::format("  wrote outside of RAM: expected {}, got {}\n", difference.expected != 0, difference.actual != 0);
+      break;
+    }
+  }
+}
+
+// Runs the program on the reference System and `engine` side by side, returning whether they
+// agreed all the way. A divergence found with a coarse interval is looked at again, from the
+// last point the engines agreed, one instruction at a time.
+int verify_engine(const cpp_box::Loaded_Files &loaded_files, const std::string &engine, const std::uint32_t seed, const std::uint64_t interval)
 {
-  std::vector<std::string> args{ argv, argv + argc };
+  const auto load_address = static_cast<std::uint32_t>(cpp_box::system::Memory_Map::USER_RAM_START);
+  const auto entry_point  = static_cast<std::uint32_t>(loaded_files.entry_point) + load_address;
+  const auto image        = std::make_shared<const cpp_box::arm::Shared_Image>(loaded_files.image);
+
+  const auto symbols = loaded_files.good_binary ? cpp_box::Symbol_Table{ cpp_box::elf::File_Header{ loaded_files.image }, load_address }
+                                                : cpp_box::Symbol_Table{};
+
+  const auto set_up = [&](auto &sys) {
+    cpp_box::system::setup_hardware_registers(sys);
+    sys.setup_run(entry_point);
+  };
+  const auto make_reference = [&] {
+    auto sys = std::make_unique<Reference_System>(loaded_files.image, load_address, cpp_box::system::Random_Device{ seed });
+    set_up(*sys);
+    return sys;
+  };
+  const auto make_paged = [&] {
+    auto sys = std::make_unique<Paged_System>(image, load_address, cpp_box::system::Random_Device{ seed });
+    set_up(*sys);
+    return sys;
+  };
+
+  const auto verify = [&](auto make_candidate) {
+    constexpr auto max_instructions = std::numeric_limits<std::uint64_t>::max();
+
+    auto reference = make_reference();
+    auto candidate = make_candidate();
+    cpp_box::arm::Differential differential{ *reference, *candidate, interval };
+    const auto divergence = differential.run_for(max_instructions);
+    if (!divergence) {
+      std::cout << fmt::format("Engine '{}' matched the reference for all {} instructions\n", engine, differential.instructions());
+      return EXIT_SUCCESS;
+    }
+
+    print_divergence(*divergence, symbols);
+
+    if (divergence->instructions - divergence->last_match > 1) {
+      reference = make_reference();
+      candidate = make_candidate();
+      cpp_box::arm::Differential narrowed{ *reference, *candidate, 1 };
+      narrowed.skip(divergence->last_match);
+      if (const auto first = narrowed.run_for(divergence->instructions - divergence->last_match); first) {
+        std::cout << "\nNarrowed down to the first instruction that differs:\n";
+        print_divergence(*first, symbols);
+      }
+    }
+    return EXIT_FAILURE;
+  };
+
+  if (engine == "paged") { return verify(make_paged); }
+  if (engine == "lockstep") {
+    return verify([&] { return std::make_unique<cpp_box::arm::Lockstep_Engine<Paged_System, 4>>(*make_paged()); });
+  }
+
+  std::cerr << "Unknown engine: '" << engine << "', expected paged or lockstep\n";
+  return EXIT_FAILURE;
+}
+
+int main(const int argc, const char *argv[])
+{
+  using clara::Opt;
+  using clara::Arg;
+  using clara::Args;
+  using clara::Help;
+  bool showHelp{ false };
+  std::filesystem::path file;
+  std::filesystem::path trace;
+  std::vector<std::string> watch;
+  std::size_t cores{ 1 };
+  std::optional<std::uint32_t> seed;
+  std::filesystem::path record_mmio;
+  std::filesystem::path replay_mmio;
+  std::filesystem::path profile;
+  std::uint64_t sample_interval{ 1000 };
+  std::size_t top{ 10 };
+  std::string unwind{ "none" };
+  std::filesystem::path coverage;
+  bool heatmap{ false };
+  bool stats{ false };
+  bool host_counters{ false };
+  std::string verify;
+  std::uint64_t verify_interval{ 0 };
+
+  auto cli = Help(showHelp) | Opt(cores, "count")["--cores"]("number of cores to emulate, core 0 runs the entry point")
+             | Opt(trace, "file")["--trace"]("write a binary trace of every executed instruction to <file>")
+             | Opt(watch, "address[+length][:r|:w|:rw]")["--watch"]("report guest accesses to a memory range, writes to 4 bytes by default")
+             | Opt([&](const std::uint32_t value) { seed = value; }, "seed")["--seed"]("seed the random device, instead of seeding it randomly")
+             | Opt(record_mmio, "file")["--record_mmio"]("record every value the guest reads from MMIO to <file>")
+             | Opt(replay_mmio, "file")["--replay_mmio"]("replay the MMIO values recorded in <file>, for a bit identical rerun")
+             | Opt(profile, "file")["--profile"]("sample the guest PC and write the stacks to <file> in collapsed flamegraph format")
+             | Opt(sample_interval, "count")["--sample_interval"]("instructions between profile samples, defaults to 1000")
+             | Opt(top, "count")["--top"]("how many functions to list in the profile summary")
+             | Opt(unwind, "none|fp|exidx")["--unwind"]("profile whole call stacks, from frame pointers or from .ARM.exidx tables")
+             | Opt(coverage, "file")["--coverage"]("record which instructions ran and write the line coverage to <file> in lcov format")
+             | Opt(heatmap)["--heatmap"]("count the guest's reads and writes to each 4KB page of memory and list them")
+             | Opt(stats)["--stats"]("count I-cache hits and misses, MMIO reads, invalid writes and instructions by type")
+             | Opt(host_counters)["--host_counters"]("measure the emulator with the host CPU's performance counters, relative to the guest's work")
+             | Opt(verify, "paged|lockstep")["--verify_engine"]("run <engine> and the reference interpreter side by side, reporting where they differ")
+             | Opt(verify_interval, "count")["--verify_interval"]("instructions between engine comparisons, 0 (the default) compares after every basic block")
+             | Arg(file, "file")("ELF file to run");
+
+  const auto result = cli.parse(Args(argc, argv));
+  if (!result) {
+    std::cerr << "Error in command line: " << result.errorMessage() << '\n';
+    return EXIT_FAILURE;
+  }
+
+  if (showHelp || file.empty()) {
+    std::cout << cli << '\n';
+    return showHelp ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  // anything else done during the run would be counted as the emulator's own work
+  if (host_counters
+      && (!watch.empty() || !profile.empty() || !trace.empty() || !coverage.empty() || heatmap || stats || cores > 1 || !verify.empty())) {
+    std::cerr << "--host_counters measures the bare emulator, it can't be combined with "
+                 "--watch, --profile, --trace, --coverage, --heatmap, --stats, --cores or --verify_engine\n";
+    return EXIT_FAILURE;
+  }
+
+  // both engines are set up from the ELF and the seed alone, nothing else about the run applies to them
+  if (!verify.empty()
+      && (!watch.empty() || !profile.empty() || !trace.empty() || !coverage.empty() || heatmap || stats || !record_mmio.empty()
+          || !replay_mmio.empty() || cores > 1)) {
+    std::cerr << "--verify_engine can't be combined with "
+                 "--watch, --profile, --trace, --coverage, --heatmap, --stats, --record_mmio, --replay_mmio or --cores\n";
+    return EXIT_FAILURE;
+  }
+
+  // the other cores run on threads of their own, which none of the per run tooling follows
+  if (cores > 1
+      && (!watch.empty() || !profile.empty() || !trace.empty() || !coverage.empty() || heatmap || stats || !record_mmio.empty()
+          || !replay_mmio.empty())) {
+    std::cerr << "--cores can't be combined with "
+                 "--watch, --profile, --trace, --coverage, --heatmap, --stats, --record_mmio or --replay_mmio\n";
+    return EXIT_FAILURE;
+  }
+
   auto logger = spdlog::stdout_color_mt("console");
 
+  std::cerr << "Attempting to load file: " << file << '\n';
 
-  if (args.size() == 2) {
-    std::cerr << "Attempting to load file: " << args[1] << '\n';
+  const auto loaded_files{ cpp_box::load_unknown(file, *logger) };
+  const auto load_address = static_cast<std::uint32_t>(cpp_box::system::Memory_Map::USER_RAM_START);
+  const auto entry_point  = static_cast<std::uint32_t>(loaded_files.entry_point) + load_address;
 
-    const auto loaded_files{ cpp_box::load_unknown(std::filesystem::path{ args[1] }, *logger) };
+  if (!verify.empty()) {
+    const auto verify_seed = seed ? *seed : cpp_box::system::Random_Device{}.seed;
+    std::cerr << "Random device seed: " << verify_seed << '\n';
+    return verify_engine(loaded_files, verify, verify_seed, verify_interval);
+  }
 
-    auto sys = std::make_unique<cpp_box::arm::System<cpp_box::system::TOTAL_RAM, std::vector<std::uint8_t>>>(
-      loaded_files.image, static_cast<std::uint32_t>(cpp_box::system::Memory_Map::USER_RAM_START));
+  if (cores > 1) {
+    const auto smp_seed = seed ? *seed : cpp_box::system::Random_Device{}.seed;
+    std::cerr << "Random device seed: " << smp_seed << '\n';
 
+    auto machine = std::make_unique<cpp_box::arm::SMP_System<cpp_box::system::TOTAL_RAM>>(loaded_files.image, load_address, cores, smp_seed);
+    cpp_box::system::setup_hardware_registers(machine->core(0));
 
-    logger->trace("setting up registers");
-    sys->write_word(static_cast<std::uint32_t>(cpp_box::system::Memory_Map::RAM_SIZE), cpp_box::system::TOTAL_RAM);
-    sys->write_half_word(static_cast<std::uint32_t>(cpp_box::system::Memory_Map::SCREEN_WIDTH), 64);
-    sys->write_half_word(static_cast<std::uint32_t>(cpp_box::system::Memory_Map::SCREEN_HEIGHT), 64);
-    sys->write_byte(static_cast<std::uint32_t>(cpp_box::system::Memory_Map::SCREEN_BPP), 32);
-    sys->write_word(static_cast<std::uint32_t>(cpp_box::system::Memory_Map::SCREEN_BUFFER), cpp_box::system::DEFAULT_SCREEN_BUFFER);
-    //dump_rom(RAM);
+    const auto results = machine->run(entry_point, std::numeric_limits<std::uint64_t>::max());
+    for (std::size_t core = 0; core < results.size(); ++core) {
+      std::cout << "Core " << core << " instructions executed: " << results[core].instructions << '\n';
+      if (results[core].reason != cpp_box::arm::Stop_Reason::Exited) {
+        std::cout << "Core " << core << " stopped: " << cpp_box::arm::to_string(results[core].reason) << '\n';
+      }
+    }
+    return EXIT_SUCCESS;
+  }
 
-//    auto last_registers = sys->registers;
-    int opcount         = 0;
-    const auto tracer =
-      [&opcount]([[maybe_unused]] const auto & /*t_sys*/, [[maybe_unused]] const auto /*t_pc*/, [[maybe_unused]] const auto /*t_ins*/) { ++opcount; };
+  std::vector<cpp_box::arm::Watchpoint> watchpoints;
+  for (const auto &spec : watch) {
+    if (const auto watchpoint = parse_watchpoint(spec); watchpoint) {
+      watchpoints.push_back(*watchpoint);
+    } else {
+      std::cerr << "Unable to parse watchpoint: '" << spec << "'\n";
+      return EXIT_FAILURE;
+    }
+  }
 
-//    cpp_box::utility::runtime_assert(sys->SP() == cpp_box::system::STACK_START);
-    sys->run(static_cast<std::uint32_t>(loaded_files.entry_point) + static_cast<std::uint32_t>(cpp_box::system::Memory_Map::USER_RAM_START), tracer);
+  const auto random_device = seed ? cpp_box::system::Random_Device{ *seed } : cpp_box::system::Random_Device{};
+  std::cerr << "Random device seed: " << random_device.seed << '\n';
 
-    std::cout << "Total instructions executed: " << opcount << '\n';
+  MMIO mmio{ random_device };
+  if (!replay_mmio.empty()) {
+    auto log = cpp_box::system::MMIO_Log::load(replay_mmio);
+    if (!log) {
+      std::cerr << "Unable to read MMIO log: " << replay_mmio << '\n';
+      return EXIT_FAILURE;
+    }
+    mmio = MMIO{ random_device, cpp_box::system::MMIO_Mode::Replay, std::make_shared<cpp_box::system::MMIO_Log>(std::move(*log)) };
+  } else if (!record_mmio.empty()) {
+    mmio = MMIO{ random_device, cpp_box::system::MMIO_Mode::Record, std::make_shared<cpp_box::system::MMIO_Log>() };
+  }
+
+  const auto unwind_method = [&]() -> std::optional<cpp_box::Unwinder::Method> {
+    if (unwind == "none") { return cpp_box::Unwinder::Method::None; }
+    if (unwind == "fp") { return cpp_box::Unwinder::Method::Frame_Pointer; }
+    if (unwind == "exidx") { return cpp_box::Unwinder::Method::Tables; }
+    return std::nullopt;
+  }();
+
+  if (!unwind_method) {
+    std::cerr << "Unknown unwind method: '" << unwind << "'\n";
+    return EXIT_FAILURE;
+  }
 
-    //dump_state(sys, last_registers);
-    // if ((++opcount) % 1000 == 0) { std::cout << opcount << '\n'; }
+  const Run_Options options{ trace, watchpoints, mmio, profile, sample_interval, top, *unwind_method, coverage, stats };
+
+  // the page table lookups watchpoints need, and the counting, on every load and store are only paid for when asked for
+  if (host_counters) {
+    run_host_counted(loaded_files, options);
+  } else if (watchpoints.empty() && !heatmap) {
+    run_single_core<cpp_box::arm::NO_MEMORY_HOOKS>(loaded_files, options, *logger);
+  } else if (!heatmap) {
+    run_single_core<Watchpoints>(loaded_files, options, *logger);
+  } else if (watchpoints.empty()) {
+    run_single_core<Page_Heatmap>(loaded_files, options, *logger);
+  } else {
+    run_single_core<cpp_box::arm::Memory_Hooks_Set<Watchpoints, Page_Heatmap>>(loaded_files, options, *logger);
+  }
+
+  if (!record_mmio.empty() && !mmio.log->save(record_mmio)) {
+    std::cerr << "Unable to write MMIO log: " << record_mmio << '\n';
+    return EXIT_FAILURE;
   }
+
+  //dump_state(sys, last_registers);
+  // if ((++opcount) % 1000 == 0) { std::cout << opcount << '\n'; }
 }
@@ -0,0 +1,375 @@
+#include "../include/cpp_box/arm.hpp"
+#include "../include/cpp_box/elf_reader.hpp"
+#include "../include/cpp_box/memory_map.hpp"
+#include "../include/cpp_box/utility.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <clara.hpp>
+
+#include <spdlog/sinks/null_sink.h>
+#include <spdlog/spdlog.h>
+
+namespace {
+
+using System = cpp_box::arm::System<cpp_box::system::TOTAL_RAM, std::vector<std::uint8_t>>;
+
+// every benchmark cycles through this many randomized inputs, a power of two so that picking
+// the next one is a mask rather than a division
+constexpr std::size_t input_count = 4096;
+constexpr std::size_t input_mask  = input_count - 1;
+
+// far from both ends of RAM, so the loads and stores of randomized instructions stay inside it
+constexpr std::uint32_t register_base = cpp_box::system::TOTAL_RAM / 2;
+
+struct Settings
+{
+  std::size_t samples{ 15 };
+  double sample_seconds{ 0.02 };
+  std::string filter;
+};
+
+// results are folded into this so that the compiler can't throw the work away
+volatile std::uint32_t sink = 0;
+
+struct Measurement
+{
+  std::string name;
+  std::size_t iterations{ 0 };      // per sample
+  std::vector<double> nanoseconds{};  // per operation, one per sample
+
+  [[nodiscard]] static double median_of(std::vector<double> values)
+  {
+    if (values.empty()) { return 0; }
+    std::sort(values.begin(), values.end());
+    const auto middle = values.size() / 2;
+    return values.size() % 2 == 1 ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+  }
+
+  [[nodiscard]] double median() const { return median_of(nanoseconds); }
+
+  // median absolute deviation, unlike the standard deviation a few preempted samples barely move it
+  [[nodiscard]] double mad() const
+  {
+    const auto center = median();
+    std::vector<double> deviations;
+    for (const auto sample : nanoseconds) { deviations.push_back(std::abs(sample - center)); }
+    return median_of(deviations);
+  }
+
+  [[nodiscard]] double min() const { return nanoseconds.empty() ? 0 : *std::min_element(nanoseconds.begin(), nanoseconds.end()); }
+};
+
+template<typename Operation> double time_iterations(Operation &operation, const std::size_t iterations)
+{
+  std::uint32_t result = 0;
+  const auto start     = std::chrono::steady_clock::now();
+  for (std::size_t iteration = 0; iteration < iterations; ++iteration) { result += operation(iteration & input_mask); }
+  const auto finish = std::chrono::steady_clock::now();
+  sink              = sink + result;
+  return std::chrono::duration<double>(finish - start).count();
+}
+
+// Doubles the iteration count until one sample takes long enough to time reliably, then takes
+// `samples` samples of that many iterations. The calibration runs double as the warm-up.
+template<typename Operation> std::optional<Measurement> measure(const Settings &settings, std::string name, Operation &&operation)
+{
+  if (name.find(settings.filter) == std::string::npos) { return std::nullopt; }
+
+  Measurement measurement{ std::move(name) };
+  measurement.iterations = 1;
+  while (time_iterations(operation, measurement.iterations) < settings.sample_seconds && measurement.iterations < (std::size_t{ 1 } << 30)) {
+    measurement.iterations *= 2;
+  }
+
+  for (std::size_t sample = 0; sample < settings.samples; ++sample) {
+    const auto seconds = time_iterations(operation, measurement.iterations);
+    measurement.nanoseconds.push_back(seconds * 1e9 / static_cast<double>(measurement.iterations));
+  }
+
+  return measurement;
+}
+
+struct Inputs
+{
+  explicit Inputs(const std::uint32_t seed) : generator{ seed } {}
+
+  std::mt19937 generator;
+
+  [[nodiscard]] std::uint32_t random() { return static_cast<std::uint32_t>(generator()); }
+
+  template<typename Generate> auto make(Generate &&generate)
+  {
+    std::vector<decltype(generate())> values;
+    for (std::size_t idx = 0; idx < input_count; ++idx) { values.push_back(generate()); }
+    return values;
+  }
+
+  // random instructions of one type, always executed and never touching the PC
+  std::vector<cpp_box::arm::Instruction> instructions(const cpp_box::arm::Instruction_Type type)
+  {
+    const auto &table = System::lookup_table;
+    const auto entry  = std::find_if(table.begin(), table.end(), [type](const auto &elem) { return elem.type == type; });
+
+    return make([&] {
+      while (true) {
+        auto value = (random() & ~entry->mask) | entry->expected;
+        value      = (value & 0x0FFFFFFFu) | (static_cast<std::uint32_t>(cpp_box::arm::Condition::AL) << 28);
+
+        // the register fields of every format are in these nibbles, keep r15 out of them
+        for (const auto shift : { 0u, 8u, 12u, 16u }) {
+          if (((value >> shift) & 0xFu) == 0xFu) { value &= ~(1u << shift); }
+        }
+        if (type == cpp_box::arm::Instruction_Type::Load_And_Store_Multiple) { value = (value & ~0x8000u) | 0x1u; }
+        // an immediate offset keeps the address within 4KB of the base register, a shifted
+        // register offset could be anywhere
+        if (type == cpp_box::arm::Instruction_Type::Single_Data_Transfer) { value &= ~(1u << 25); }
+
+        if (System::decode(cpp_box::arm::Instruction{ value }) == type) { return cpp_box::arm::Instruction{ value }; }
+      }
+    });
+  }
+
+  [[nodiscard]] std::uint32_t ram_address() { return (random() % (cpp_box::system::TOTAL_RAM - 0x2000)) + 0x1000; }
+};
+
+// a system whose registers all point into the middle of RAM
+std::unique_ptr<System> make_system()
+{
+  auto sys = std::make_unique<System>();
+  cpp_box::system::setup_hardware_registers(*sys);
+  for (std::uint32_t reg = 0; reg < 15; ++reg) { sys->registers[reg] = register_base + reg * 64; }
+  return sys;
+}
+
+// Runs one `process` overload over randomized instructions of its type. Anything that addresses
+// memory gets its registers put back before every instruction, so that write back and loads
+// can't walk a base register out of RAM, and that copy is part of what gets timed. The others
+// only get them put back every pass over the inputs.
+template<typename Type> auto process_operation(Inputs &inputs, const cpp_box::arm::Instruction_Type type)
+{
+  constexpr bool addresses_memory = !std::is_same_v<Type, cpp_box::arm::Data_Processing> && !std::is_same_v<Type, cpp_box::arm::Multiply_Long>
+                                    && !std::is_same_v<Type, cpp_box::arm::Branch>;
+
+  return [instructions = inputs.instructions(type), sys = make_system(), start = std::array<std::uint32_t, 16>{}](const std::size_t idx) mutable {
+    if (start[0] == 0) { start = sys->registers; }
+    if (addresses_memory || idx == 0) {
+      sys->registers = start;
+      sys->CSPR      = 0;
+    }
+    sys->process(Type{ instructions[idx] });
+    return sys->registers[idx & 0xF];
+  };
+}
+
+void print(const Measurement &measurement)
+{
+  const auto median = measurement.median();
+  std::cout << fmt::format("{:<36} {:>10.2f} {:>9.2f} {:>6.1f}% {:>10.2f} {:>14}\n",
+                           measurement.name,
+                           median,
+                           measurement.mad(),
+                           median > 0 ? measurement.mad() / median * 100 : 0.0,
+                           measurement.min(),
+                           measurement.iterations);
+}
+
+void write_json(std::ostream &os, const std::vector<Measurement> &measurements)
+{
+  os << "[\n";
+  for (std::size_t idx = 0; idx < measurements.size(); ++idx) {
+    const auto &measurement = measurements[idx];
+    os << fmt::format(R"(  {{ "name": "{}", "median_ns": {:.3f}, "mad_ns": {:.3f}, "min_ns": {:.3f}, "iterations": {}, "samples": {} }})",
+                      measurement.name,
+                      measurement.median(),
+                      measurement.mad(),
+                      measurement.min(),
+                      measurement.iterations,
+                      measurement.nanoseconds.size())
+       << (idx + 1 == measurements.size() ? "\n" : ",\n");
+  }
+  os << "]\n";
+}
+
+}  // namespace
+
+int main(const int argc, const char *argv[])
+{
+  using clara::Opt;
+  using clara::Arg;
+  using clara::Args;
+  using clara::Help;
+  bool showHelp{ false };
+  Settings settings;
+  std::uint32_t seed{ 1 };
+  std::filesystem::path elf_file;
+  std::filesystem::path output;
+
+  auto cli = Help(showHelp) | Opt(settings.filter, "text")["--filter"]("only run the benchmarks with <text> in their name")
+             | Opt(settings.samples, "count")["--samples"]("timed samples per benchmark, defaults to 15")
+             | Opt(settings.sample_seconds, "seconds")["--sample_seconds"]("minimum length of one sample, defaults to 0.02")
+             | Opt(seed, "seed")["--seed"]("seed for the randomized inputs, defaults to 1")
+             | Opt(output, "file")["--output"]("also write the results to <file> as JSON")
+             | Arg(elf_file, "file")("ELF object for the ELF reader and symbol resolution benchmarks, they are skipped without one");
+
+  const auto result = cli.parse(Args(argc, argv));
+  if (!result) {
+    std::cerr << "Error in command line: " << result.errorMessage() << '\n';
+    return EXIT_FAILURE;
+  }
+
+  if (showHelp) {
+    std::cout << cli << '\n';
+    return EXIT_SUCCESS;
+  }
+
+  if (settings.samples == 0) {
+    std::cerr << "--samples must be at least 1\n";
+    return EXIT_FAILURE;
+  }
+
+  using cpp_box::arm::Instruction_Type;
+
+  Inputs inputs{ seed };
+  std::vector<Measurement> measurements;
+  const auto add = [&](std::optional<Measurement> measurement) {
+    if (measurement) {
+      print(*measurement);
+      measurements.push_back(std::move(*measurement));
+    }
+  };
+
+  std::cout << fmt::format("{:<36} {:>10} {:>9} {:>7} {:>10} {:>14}\n", "benchmark", "median ns", "MAD ns", "MAD", "min ns", "iterations");
+
+  add(measure(settings, "decode", [words = inputs.make([&] { return cpp_box::arm::Instruction{ inputs.random() }; })](const std::size_t idx) {
+    return static_cast<std::uint32_t>(System::decode(words[idx]));
+  }));
+
+  add(measure(settings,
+              "check_condition",
+              [conditions = inputs.make([&] { return std::pair{ static_cast<cpp_box::arm::Condition>(inputs.random() % 15), inputs.random() & 0xF0000000u }; })](
+                const std::size_t idx) { return static_cast<std::uint32_t>(System::check_condition(conditions[idx].first, conditions[idx].second)); }));
+
+  {
+    struct Shift
+    {
+      bool c_flag;
+      cpp_box::arm::Shift_Type type;
+      std::uint32_t amount;
+      std::uint32_t value;
+    };
+    auto sys = make_system();
+    add(measure(settings,
+                "shift_register",
+                [&sys, shifts = inputs.make([&] {
+                   return Shift{ (inputs.random() & 1u) != 0, static_cast<cpp_box::arm::Shift_Type>(inputs.random() & 3u), inputs.random() % 40, inputs.random() };
+                 })](const std::size_t idx) {
+                  const auto &shift = shifts[idx];
+                  return sys->shift_register(shift.c_flag, shift.type, shift.amount, shift.value).second;
+                }));
+  }
+
+  {
+    auto sys = make_system();
+    add(measure(settings, "read_word", [&sys, addresses = inputs.make([&] { return inputs.ram_address() & ~3u; })](const std::size_t idx) {
+      return sys->read_word(addresses[idx]);
+    }));
+    add(measure(settings, "write_word", [&sys, addresses = inputs.make([&] { return inputs.ram_address() & ~3u; })](const std::size_t idx) {
+      sys->write_word(addresses[idx], static_cast<std::uint32_t>(idx));
+      return addresses[idx];
+    }));
+  }
+
+  add(measure(settings, "process(Data_Processing)", process_operation<cpp_box::arm::Data_Processing>(inputs, Instruction_Type::Data_Processing)));
+  add(measure(settings, "process(Multiply_Long)", process_operation<cpp_box::arm::Multiply_Long>(inputs, Instruction_Type::Multiply_Long)));
+  add(measure(settings, "process(Single_Data_Transfer)", process_operation<cpp_box::arm::Single_Data_Transfer>(inputs, Instruction_Type::Single_Data_Transfer)));
+  add(measure(settings, "process(Single_Data_Swap)", process_operation<cpp_box::arm::Single_Data_Swap>(inputs, Instruction_Type::Single_Data_Swap)));
+  add(measure(settings, "process(Load_And_Store_Multiple)", process_operation<cpp_box::arm::Load_And_Store_Multiple>(inputs, Instruction_Type::Load_And_Store_Multiple)));
+  add(measure(settings, "process(Branch)", process_operation<cpp_box::arm::Branch>(inputs, Instruction_Type::Branch)));
+
+  // the same mix of instructions through the dispatching overload, as the interpreter loop runs them
+  add(measure(settings,
+              "process(Instruction)",
+              [instructions = [&] {
+                 std::vector<cpp_box::arm::Instruction> mix;
+                 for (const auto type : { Instruction_Type::Data_Processing,
+                                          Instruction_Type::Data_Processing,
+                                          Instruction_Type::Single_Data_Transfer,
+                                          Instruction_Type::Load_And_Store_Multiple,
+                                          Instruction_Type::Multiply_Long,
+                                          Instruction_Type::Single_Data_Swap }) {
+                   const auto some = inputs.instructions(type);
+                   mix.insert(mix.end(), some.begin(), some.begin() + input_count / 6);
+                 }
+                 while (mix.size() < input_count) { mix.push_back(mix[mix.size() % 16]); }
+                 std::shuffle(mix.begin(), mix.end(), inputs.generator);
+                 return mix;
+               }(),
+               sys   = make_system(),
+               start = std::array<std::uint32_t, 16>{}](const std::size_t idx) mutable {
+                // every instruction, as above, since the memory instructions in the mix would
+                // otherwise use base registers the data processing ones had just overwritten
+                if (start[0] == 0) { start = sys->registers; }
+                sys->registers = start;
+                sys->process(instructions[idx]);
+                return sys->registers[idx & 0xF];
+              }));
+
+  {
+    auto sys = make_system();
+    for (std::uint32_t loc = 0; loc < 4096; loc += 4) { sys->write_word(loc + 0x1000, inputs.random()); }
+    // entries are decoded as they're first fetched, so the refill alone only empties the cache.
+    // Fetching all of them after it costs what refilling used to, and what running straight
+    // through 4KB of new code does.
+    add(measure(settings, "I_Cache::fill_cache + 1024 fetches", [&sys](const std::size_t idx) {
+      sys->i_cache.fill_cache(*sys);
+      auto types = static_cast<std::uint32_t>(idx);
+      for (std::uint32_t loc = 0x1000; loc < 0x2000; loc += 4) { types += static_cast<std::uint32_t>(sys->i_cache.fetch(loc, *sys).type); }
+      return types;
+    }));
+  }
+
+  if (!elf_file.empty()) {
+    const auto original = cpp_box::utility::read_file(elf_file);
+    if (original.size() < 64 || !cpp_box::elf::File_Header{ { original.data(), original.size() } }.is_elf_file()) {
+      std::cerr << "Not an ELF file: " << elf_file << '\n';
+      return EXIT_FAILURE;
+    }
+    const cpp_box::elf::File_Header file_header{ { original.data(), original.size() } };
+
+    add(measure(settings, "elf::File_Header iteration", [&file_header](const std::size_t /*idx*/) {
+      const auto sh_string_table = file_header.sh_string_table();
+      std::uint32_t total        = 0;
+      for (const auto &section_header : file_header.section_headers()) {
+        total += static_cast<std::uint32_t>(section_header.name(sh_string_table).size() + section_header.offset());
+        for (const auto &symbol : section_header.symbol_table_entries()) { total += static_cast<std::uint32_t>(symbol.value()); }
+        for (const auto &relocation : section_header.relocation_table_entries()) { total += static_cast<std::uint32_t>(relocation.file_offset()); }
+      }
+      return total;
+    }));
+
+    // relocating an already relocated branch gives the same branch, so one copy can be resolved over and over
+    auto logger = std::make_shared<spdlog::logger>("microbench", std::make_shared<spdlog::sinks::null_sink_mt>());
+    logger->set_level(spdlog::level::off);
+    auto copy = original;
+    add(measure(settings, "resolve_symbols", [&](const std::size_t idx) {
+      cpp_box::utility::resolve_symbols(copy, file_header, *logger);
+      return static_cast<std::uint32_t>(copy[idx % copy.size()]);
+    }));
+  }
+
+  if (!output.empty()) {
+    std::ofstream ofs{ output };
+    write_json(ofs, measurements);
+  }
+}
@@ -1,11 +1,23 @@
 #include "../include/cpp_box/arm.hpp"
 #include "../include/cpp_box/compiler.hpp"
 #include "../include/cpp_box/elf_reader.hpp"
+#include "../include/cpp_box/execution_counts.hpp"
+#include "../include/cpp_box/memory_heatmap.hpp"
 #include "../include/cpp_box/memory_map.hpp"
+#include "../include/cpp_box/mmio.hpp"
+#include "../include/cpp_box/paged_ram.hpp"
+#include "../include/cpp_box/rewind.hpp"
 #include "../include/cpp_box/state_machine.hpp"
+#include "../include/cpp_box/stats.hpp"
+#include "../include/cpp_box/timeline.hpp"
+#include "../include/cpp_box/timing.hpp"
 #include "../include/cpp_box/utility.hpp"
+#include "../include/cpp_box/watchpoints.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <future>
@@ -13,9 +25,13 @@
 #include <iostream>
 #include <map>
 #include <memory>
+#include <numeric>
+#include <optional>
 #include <random>
+#include <set>
 #include <sstream>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "imgui/lib/imgui-SFML.h"
@@ -34,44 +50,43 @@
 #include <spdlog/spdlog.h>
 
 
-struct MMIO_Devices
-{
-  struct Random_Generator
-  {
-    std::uniform_int_distribution<std::uint32_t> random_word;
+using MMIO_Devices = cpp_box::system::Recorded_MMIO<cpp_box::system::Random_Device>;
 
-    std::random_device r;
-    std::default_random_engine generator{ r() };
-  };
-
-  std::unique_ptr<Random_Generator> generator = std::make_unique<Random_Generator>();
-
-  [[nodiscard]] constexpr bool is_mmio_range(const std::uint32_t loc) const noexcept
-  {
-    return loc == static_cast<std::uint32_t>(cpp_box::system::Memory_Map::RANDOM_DEVICE);
-  }
+// where the guest's MMIO reads come from, see mmio.hpp
+struct MMIO_Config
+{
+  std::optional<std::uint32_t> seed;
+  cpp_box::system::MMIO_Mode mode{ cpp_box::system::MMIO_Mode::Live };
+  std::shared_ptr<cpp_box::system::MMIO_Log> log;
 
-  [[nodiscard]] std::uint32_t read_word([[maybe_unused]] const std::uint32_t loc) const noexcept
-  {
-    return generator->random_word(generator->generator);
-  }
-  [[nodiscard]] std::uint16_t read_half_word([[maybe_unused]] const std::uint32_t loc) const noexcept
-  {
-    return static_cast<std::uint16_t>(generator->random_word(generator->generator));
-  }
-  [[nodiscard]] std::uint8_t read_byte([[maybe_unused]] const std::uint32_t loc) const noexcept
+  // fresh devices for every reset, which start over from the beginning of the log
+  [[nodiscard]] MMIO_Devices make() const
   {
-    return static_cast<std::uint8_t>(generator->random_word(generator->generator));
+    return MMIO_Devices{ seed ? cpp_box::system::Random_Device{ *seed } : cpp_box::system::Random_Device{}, mode, log };
   }
 };
 
-struct Box
+using Watchpoints  = cpp_box::arm::Watchpoints<cpp_box::system::TOTAL_RAM>;
+using Page_Heatmap = cpp_box::arm::Page_Heatmap<cpp_box::system::TOTAL_RAM>;
+
+// Guest RAM is a plain std::vector unless stepping back is wanted. Rewinding needs Paged_RAM
+// so that checkpoints share pages, which costs a reference count check on every guest store.
+// Watchpoints are always there, only hooking the pages they cover, but the heatmap sees every
+// load and store and Emulator_Stats every instruction, so they're only compiled in when asked for.
+template<typename RAM_Type, typename Memory_Hooks, typename Stats> struct Box
 {
+  static constexpr bool rewinding   = cpp_box::arm::has_shared_pages_v<RAM_Type>;
+  static constexpr bool has_heatmap = std::is_base_of_v<Page_Heatmap, Memory_Hooks>;
+  static constexpr bool has_stats   = std::is_same_v<Stats, cpp_box::arm::Emulator_Stats>;
+
+  using System = cpp_box::arm::System<cpp_box::system::TOTAL_RAM, RAM_Type, MMIO_Devices, cpp_box::arm::ARM7TDMI_Timing, Memory_Hooks, Stats>;
 
   struct Inputs
   {
     bool reset_pressed{ false };
     bool step_pressed{ false };
+    bool step_back_pressed{ false };
+    bool run_back_pressed{ false };
     bool source_changed{ false };
   };
 
@@ -105,16 +120,31 @@ struct Box
     };
 
 
+    MMIO_Config mmio_config;
     cpp_box::Loaded_Files loaded_files;
     Timer static_timer{ 0.5f };
 
     bool build_good() const noexcept { return loaded_files.good_binary; }
-    std::unique_ptr<cpp_box::arm::System<cpp_box::system::TOTAL_RAM, std::vector<std::uint8_t>, MMIO_Devices>> sys;
+    std::unique_ptr<System> sys;
+    cpp_box::arm::Rewind_History<System> history;
     std::vector<Goal> goals;
     std::size_t current_goal{ 0 };
 
+    // source lines, so they survive rebuilding and resetting
+    std::set<int> breakpoint_lines;
+    std::vector<cpp_box::arm::Watchpoint> watchpoints;
+
+    // how often each instruction of the image ran, and each source line's share of that, indexed by line number
+    cpp_box::arm::Execution_Counts execution_counts;
+    std::vector<double> line_heat;
+
+    // what the emulator did during the last frame, and since the last reset
+    cpp_box::arm::Emulator_Stats frame_stats;
+    cpp_box::arm::Emulator_Stats total_stats;
+
     sf::Texture texture;
     sf::Sprite sprite;
+    std::vector<std::uint8_t> screen;
 
     static constexpr auto FPS               = 30;
     static constexpr const auto opsPerFrame = 30'000'000 / FPS;
@@ -166,21 +196,147 @@ struct Box
     void reset()
     {
       m_logger.trace("reset()");
-      sys =
-        std::make_unique<decltype(sys)::element_type>(loaded_files.image, static_cast<std::uint32_t>(cpp_box::system::Memory_Map::USER_RAM_START));
+      sys = std::make_unique<System>(
+        loaded_files.image, static_cast<std::uint32_t>(cpp_box::system::Memory_Map::USER_RAM_START), mmio_config.make());
+      m_logger.info("Random device seed: {}", sys->mmio_callback.devices.seed);
 
       sys->setup_run(static_cast<std::uint32_t>(loaded_files.entry_point) + static_cast<std::uint32_t>(cpp_box::system::Memory_Map::USER_RAM_START));
       cpp_box::utility::runtime_assert(sys->SP() == cpp_box::system::STACK_START);
       m_logger.trace("setting up registers");
-      sys->write_word(static_cast<std::uint32_t>(cpp_box::system::Memory_Map::RAM_SIZE), cpp_box::system::TOTAL_RAM);
-      sys->write_half_word(static_cast<std::uint32_t>(cpp_box::system::Memory_Map::SCREEN_WIDTH), 64);
-      sys->write_half_word(static_cast<std::uint32_t>(cpp_box::system::Memory_Map::SCREEN_HEIGHT), 64);
-      sys->write_byte(static_cast<std::uint32_t>(cpp_box::system::Memory_Map::SCREEN_BPP), 32);
-      sys->write_word(static_cast<std::uint32_t>(cpp_box::system::Memory_Map::SCREEN_BUFFER), cpp_box::system::DEFAULT_SCREEN_BUFFER);
+      cpp_box::system::setup_hardware_registers(*sys);
+      arm_breakpoints();
+      arm_watchpoints();
+      if constexpr (rewinding) { history.reset(*sys); }
+      execution_counts = cpp_box::arm::Execution_Counts{ static_cast<std::uint32_t>(cpp_box::system::Memory_Map::USER_RAM_START),
+                                                         static_cast<std::uint32_t>(loaded_files.image.size()) };
+      line_heat.clear();
+      frame_stats.reset();
+      total_stats.reset();
+    }
+
+    // Runs forward, counting the instructions executed. Instructions re-executed to step back
+    // aren't counted, the ones run again after that are.
+    void run_for(const std::uint64_t instructions)
+    {
+      last_registers = sys->registers;
+      last_CSPR      = sys->CSPR;
+
+      const auto result = [&] {
+        const cpp_box::Timeline::Scope scope{ cpp_box::timeline(), "emulate", "run" };
+        if constexpr (rewinding) {
+          return history.run_for(*sys, instructions, execution_counts);
+        } else {
+          return sys->run_for(instructions, execution_counts);
+        }
+      }();
+      if (result.reason == cpp_box::arm::Stop_Reason::Breakpoint) { execution_counts.undo_last(); }
+      check_stop(result);
+      collect_stats();
+      update_line_heat();
+      update_display();
+    }
+
+    void collect_stats()
+    {
+      if constexpr (has_stats) {
+        frame_stats = sys->stats;
+        total_stats += sys->stats;
+        sys->stats.reset();
+      }
+    }
+
+    void update_line_heat()
+    {
+      const auto counts = execution_counts.counts();
+      const auto total  = std::accumulate(counts.begin(), counts.end(), std::uint64_t{ 0 });
+
+      line_heat.clear();
+      if (total == 0) { return; }
+
+      for (std::size_t idx = 0; idx < counts.size(); ++idx) {
+        if (counts[idx] == 0) { continue; }
+
+        const auto location = loaded_files.location_data.find(static_cast<std::uint32_t>(idx * 4));
+        if (location == loaded_files.location_data.end() || location->second.line_number <= 0) { continue; }
+
+        const auto line = static_cast<std::size_t>(location->second.line_number);
+        if (line >= line_heat.size()) { line_heat.resize(line + 1); }
+        line_heat[line] += static_cast<double>(counts[idx]) / static_cast<double>(total);
+      }
+    }
+
+    // rewinding brings back the watchpoints from that point in time, these are the ones the user wants now
+    void arm_watchpoints()
+    {
+      sys->memory_hooks.clear();
+      for (const auto &watchpoint : watchpoints) { sys->memory_hooks.add(watchpoint); }
+    }
+
+    // checkpoints also bring back the stats from their point in time, which have already been counted
+    void step_back()
+    {
+      if (rewinding && history.step_back(*sys)) {
+        arm_watchpoints();
+        if constexpr (has_stats) { sys->stats.reset(); }
+      }
+    }
+
+    void run_back_to_breakpoint()
+    {
+      if (rewinding && history.run_back_to_breakpoint(*sys)) {
+        arm_watchpoints();
+        if constexpr (has_stats) { sys->stats.reset(); }
+      }
     }
 
     void reset_static_timer() { static_timer.reset(); }
 
+    void arm_breakpoints()
+    {
+      sys->clear_breakpoints();
+      for (const auto line : breakpoint_lines) {
+        for (const auto loc : cpp_box::line_addresses(loaded_files, line)) {
+          if (!sys->add_breakpoint(loc + static_cast<std::uint32_t>(cpp_box::system::Memory_Map::USER_RAM_START))) {
+            m_logger.warn("Too many breakpoints, ignoring the rest of line {}", line);
+          }
+        }
+      }
+    }
+
+    void toggle_breakpoint(const int line)
+    {
+      if (breakpoint_lines.erase(line) == 0) { breakpoint_lines.insert(line); }
+      arm_breakpoints();
+    }
+
+    void add_watchpoint(const cpp_box::arm::Watchpoint watchpoint)
+    {
+      watchpoints.push_back(watchpoint);
+      sys->memory_hooks.add(watchpoint);
+    }
+
+    void remove_watchpoint(const std::size_t index)
+    {
+      sys->memory_hooks.remove(watchpoints[index]);
+      watchpoints.erase(std::next(watchpoints.begin(), static_cast<std::ptrdiff_t>(index)));
+    }
+
+    // pause on anything other than running out of this frame's budget or the program ending
+    void check_stop(const cpp_box::arm::Run_Result result)
+    {
+      if (result.reason == cpp_box::arm::Stop_Reason::Unhandled_Instruction) {
+        m_logger.error("Unhandled instruction at PC: {:#010x}", sys->PC() - 8);
+        paused = true;
+      } else if (result.reason == cpp_box::arm::Stop_Reason::Breakpoint) {
+        m_logger.info("Breakpoint at PC: {:#010x}", sys->PC() - 4);
+        paused = true;
+      } else if (result.reason == cpp_box::arm::Stop_Reason::Watchpoint) {
+        const auto &hit = sys->memory_hooks.hits.back();
+        m_logger.info("Watchpoint at PC: {:#010x}, {} of {:#010x}", hit.pc, hit.write ? "write" : "read", hit.address);
+        paused = true;
+      }
+    }
+
     void rescale_display(const float new_scale_factor, const float new_sprite_scale_factor)
     {
       if (scale_factor != new_scale_factor || sprite_scale_factor != new_sprite_scale_factor) {
@@ -191,11 +347,12 @@ struct Box
       }
     }
 
-    Status(spdlog::logger &logger, const std::filesystem::path &path, std::vector<Goal> t_goals)
+    Status(spdlog::logger &logger, const std::filesystem::path &path, std::vector<Goal> t_goals, MMIO_Config t_mmio_config)
       : m_logger{ logger }
+      , mmio_config{ std::move(t_mmio_config) }
       , loaded_files{ cpp_box::load_unknown(path, m_logger) }
-      , sys{ std::make_unique<decltype(sys)::element_type>(loaded_files.image,
-                                                           static_cast<std::uint32_t>(cpp_box::system::Memory_Map::USER_RAM_START)) }
+      , sys{ std::make_unique<System>(
+          loaded_files.image, static_cast<std::uint32_t>(cpp_box::system::Memory_Map::USER_RAM_START), mmio_config.make()) }
       , goals{ std::move(t_goals) }
     {
       m_logger.trace("Creating Status Object");
@@ -208,12 +365,16 @@ struct Box
     {
       const auto last_state = current_state;
       current_state         = state_machine.transition(current_state, *this, inputs);
-      if (last_state != current_state) { m_logger.debug("StateTransition {} -> {}", to_string(last_state), to_string(current_state)); }
+      if (last_state != current_state) {
+        m_logger.debug("StateTransition {} -> {}", to_string(last_state), to_string(current_state));
+        cpp_box::timeline().instant(to_string(current_state), "state");
+      }
       return current_state;
     }
 
     void update_display()
     {
+      const cpp_box::Timeline::Scope scope{ cpp_box::timeline(), "update display", "run" };
       sf::Vector2u size{ sys->read_half_word(static_cast<std::uint32_t>(cpp_box::system::Memory_Map::SCREEN_WIDTH)),
                          sys->read_half_word(static_cast<std::uint32_t>(cpp_box::system::Memory_Map::SCREEN_HEIGHT)) };
       if (size != texture.getSize()) {
@@ -224,11 +385,23 @@ struct Box
 
       if (const auto display_loc = sys->read_word(static_cast<std::uint32_t>(cpp_box::system::Memory_Map::SCREEN_BUFFER));
           cpp_box::system::TOTAL_RAM - display_loc >= size.x * size.y * 4) {
-        texture.update(&sys->builtin_ram[display_loc]);
-      } else {
+        texture.update(screen_pixels(display_loc, size.x * size.y * 4));
+      } else if (display_loc < cpp_box::system::TOTAL_RAM) {
         // write as many lines as we can if we're past the end of RAM
         const auto pixels_to_write = std::min(size.x * size.y, (cpp_box::system::TOTAL_RAM - display_loc) / 4);
-        texture.update(&sys->builtin_ram[display_loc], 0, 0, size.x, pixels_to_write / size.x);
+        texture.update(screen_pixels(display_loc, pixels_to_write * 4), 0, 0, size.x, pixels_to_write / size.x);
+      }
+    }
+
+    // paged RAM has to be gathered up before handing it over
+    const std::uint8_t *screen_pixels(const std::uint32_t loc, const std::size_t bytes)
+    {
+      if constexpr (rewinding) {
+        screen.resize(bytes);
+        sys->builtin_ram.copy_out(loc, screen.data(), screen.size());
+        return screen.data();
+      } else {
+        return &sys->builtin_ram[loc];
       }
     }
 
@@ -289,6 +462,13 @@ struct Box
       ImGui::Button("Continuously Step");
       inputs.step_pressed = inputs.step_pressed || ImGui::IsItemActive();
 
+      if constexpr (rewinding) {
+        ImGui::SameLine();
+        inputs.step_back_pressed = ImGui::Button("Step Back");
+        ImGui::SameLine();
+        inputs.run_back_pressed = ImGui::Button("Run Back To Breakpoint");
+      }
+
       ImGui::SameLine();
       inputs.reset_pressed = ImGui::Button("Reset");
 
@@ -298,6 +478,8 @@ struct Box
       ImGui::InputFloat("Output Zoom", &sprite_scale_factor, 0.5f, 0.0f, 1);
       const auto elapsedSeconds = status.framerateClock.restart().asSeconds();
       text(true, "{:2.2f} FPS ~{:2.2f} Mhz", 1 / elapsedSeconds, status.opsPerFrame / elapsedSeconds / 1000000);
+      // what the program would have cost on real hardware, as opposed to how fast we emulate it
+      text(true, "{} modeled ARM7TDMI cycles", status.sys->timing.cycles());
 
       status.rescale_display(scale_factor, sprite_scale_factor);
     }
@@ -310,6 +492,74 @@ struct Box
     }
     ImGui::End();
 
+    if constexpr (has_stats) {
+      ImGui::Begin("Emulator Stats", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+      {
+        const auto &frame = status.frame_stats;
+        const auto &total = status.total_stats;
+        const auto row    = [this](const std::string_view label, const std::uint64_t frame_count, const std::uint64_t total_count) {
+          text(true, "{:<30} {:>12} {:>14}", label, frame_count, total_count);
+        };
+
+        text(true, "{:<30} {:>12} {:>14}", "", "last frame", "since reset");
+        row("I-cache hits", frame.cache_hits(), total.cache_hits());
+        row("I-cache misses", frame.cache_misses, total.cache_misses);
+        row("I-cache refills", frame.cache_refills, total.cache_refills);
+        row("invalid memory writes", frame.invalid_writes, total.invalid_writes);
+
+        total.for_each_mmio_register([&](const std::uint32_t loc, const std::uint64_t reads) {
+          row(fmt::format("MMIO reads from {:#010x}", loc), frame.mmio_reads_from(loc), reads);
+        });
+        if (total.other_mmio_reads != 0) { row("MMIO reads from other registers", frame.other_mmio_reads, total.other_mmio_reads); }
+
+        for (std::size_t type = 0; type < total.instructions.size(); ++type) {
+          if (total.instructions[type] == 0) { continue; }
+          row(cpp_box::arm::to_string(static_cast<cpp_box::arm::Instruction_Type>(type)), frame.instructions[type], total.instructions[type]);
+        }
+      }
+      ImGui::End();
+    }
+
+    if constexpr (has_heatmap) {
+      ImGui::Begin("Memory Heatmap", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+      {
+        auto &heatmap         = static_cast<Page_Heatmap &>(status.sys->memory_hooks);
+        constexpr auto across = std::size_t{ 64 };  // 256KB per row
+        const auto cell       = 4 * status.scale_factor;
+
+        text(true, "{} pages touched ({} KB)", heatmap.pages_touched(), heatmap.pages_touched() * Page_Heatmap::page_size / 1024);
+        ImGui::SameLine();
+        if (ImGui::Button("Reset Counts")) { heatmap.reset_counts(); }
+
+        // log scaled, so that the stack and the screen don't wash out everything else. Red is writes, green reads.
+        std::uint64_t most = 1;
+        for (std::size_t page = 0; page < Page_Heatmap::page_count; ++page) { most = std::max({ most, heatmap.reads(page), heatmap.writes(page) }); }
+        const auto intensity = [scale = std::log1p(static_cast<float>(most))](const std::uint64_t count) {
+          return count == 0 ? 0 : static_cast<int>(64 + 191 * std::log1p(static_cast<float>(count)) / scale);
+        };
+
+        const auto origin = ImGui::GetCursorScreenPos();
+        auto *draw_list   = ImGui::GetWindowDrawList();
+        for (std::size_t page = 0; page < Page_Heatmap::page_count; ++page) {
+          const ImVec2 min{ origin.x + static_cast<float>(page % across) * cell, origin.y + static_cast<float>(page / across) * cell };
+          draw_list->AddRectFilled(
+            min, { min.x + cell - 1, min.y + cell - 1 }, IM_COL32(intensity(heatmap.writes(page)), intensity(heatmap.reads(page)), 32, 255));
+        }
+        const auto rows = (Page_Heatmap::page_count + across - 1) / across;
+        ImGui::Dummy({ static_cast<float>(across) * cell, static_cast<float>(rows) * cell });
+
+        if (ImGui::IsItemHovered()) {
+          const auto mouse = ImGui::GetMousePos();
+          const auto page  = static_cast<std::size_t>((mouse.y - origin.y) / cell) * across + static_cast<std::size_t>((mouse.x - origin.x) / cell);
+          if (page < Page_Heatmap::page_count) {
+            ImGui::SetTooltip(
+              "%s", fmt::format("{:#010x}: {} reads, {} writes", page * Page_Heatmap::page_size, heatmap.reads(page), heatmap.writes(page)).c_str());
+          }
+        }
+      }
+      ImGui::End();
+    }
+
     ImGui::Begin("State", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
     {
       if (ImGui::CollapsingHeader("Registers")) {
@@ -367,6 +617,8 @@ struct Box
         const auto object_loc      = pc - static_cast<uint32_t>(cpp_box::system::Memory_Map::USER_RAM_START);
         const auto current_linenum = status.loaded_files.location_data[object_loc].line_number;
         ImGui::BeginChild("Active Source", { ImGui::GetContentRegionAvailWidth(), 300 });
+        // lines are shaded relative to the hottest one, so that something always stands out
+        const auto hottest = status.line_heat.empty() ? 0.0 : *std::max_element(status.line_heat.begin(), status.line_heat.end());
         std::size_t endl  = 0;
         std::size_t begin = 0;
         int linenum       = 1;
@@ -374,13 +626,70 @@ struct Box
           begin                   = std::exchange(endl, status.loaded_files.src.find('\n', endl));
           const auto line         = status.loaded_files.src.substr(begin, endl - begin);
           const auto current_line = linenum == current_linenum;
-          text(current_line, "{:4}: {}", linenum, line);
+          const auto heat = static_cast<std::size_t>(linenum) < status.line_heat.size() ? status.line_heat[static_cast<std::size_t>(linenum)] : 0.0;
+          if (heat > 0.0) {
+            const auto pos = ImGui::GetCursorScreenPos();
+            ImGui::GetWindowDrawList()->AddRectFilled(pos,
+                                                      { pos.x + ImGui::GetContentRegionAvailWidth(), pos.y + ImGui::GetTextLineHeight() },
+                                                      IM_COL32(255, 64, 0, static_cast<int>(32 + 160 * heat / hottest)));
+          }
+          const auto share = heat > 0.0 ? fmt::format("{:5.1f}%", heat * 100) : std::string(6, ' ');
+          text(current_line, "{}{:4} {}: {}", status.breakpoint_lines.count(linenum) != 0 ? '*' : ' ', linenum, share, line);
+          if (ImGui::IsItemClicked()) { status.toggle_breakpoint(linenum); }
           if (current_line) { ImGui::SetScrollHere(); }
           if (endl != std::string::npos) { ++endl; }
           ++linenum;
         }
         ImGui::EndChild();
       }
+
+      if (ImGui::CollapsingHeader("Watchpoints")) {
+        static std::array<char, 11> address{ "0x00000000" };
+        static int length = 4;
+        static bool watch_reads{ false };
+        static bool watch_writes{ true };
+
+        ImGui::PushItemWidth(100);
+        ImGui::InputText("Address", address.data(), address.size(), ImGuiInputTextFlags_CharsHexadecimal);
+        ImGui::SameLine();
+        ImGui::InputInt("Length", &length);
+        ImGui::PopItemWidth();
+        ImGui::Checkbox("Read", &watch_reads);
+        ImGui::SameLine();
+        ImGui::Checkbox("Write", &watch_writes);
+        ImGui::SameLine();
+        if (ImGui::Button("Watch") && length > 0 && (watch_reads || watch_writes)) {
+          const auto start = static_cast<std::uint32_t>(std::strtoul(address.data(), nullptr, 16));
+          const auto kind  = watch_reads ? (watch_writes ? cpp_box::arm::Watch::Access : cpp_box::arm::Watch::Read) : cpp_box::arm::Watch::Write;
+          status.add_watchpoint({ start, start + static_cast<std::uint32_t>(length), kind });
+        }
+
+        for (std::size_t index = 0; index < status.watchpoints.size(); ++index) {
+          const auto &watchpoint = status.watchpoints[index];
+          const auto kind        = static_cast<std::uint32_t>(watchpoint.kind);
+          text(true, "{:08x}-{:08x} {}{}", watchpoint.start, watchpoint.end, (kind & 0b01) != 0 ? 'r' : ' ', (kind & 0b10) != 0 ? 'w' : ' ');
+          ImGui::SameLine();
+          ImGui::PushID(static_cast<int>(index));
+          const auto removed = ImGui::SmallButton("Remove");
+          ImGui::PopID();
+          if (removed) {
+            status.remove_watchpoint(index);
+            break;
+          }
+        }
+
+        for (const auto &hit : status.sys->memory_hooks.hits) {
+          const auto line = status.loaded_files.location_data[hit.pc - static_cast<std::uint32_t>(cpp_box::system::Memory_Map::USER_RAM_START)].line_number;
+          text(false,
+               "{:08x}: {} {:08x} {:x} -> {:x} (line {})",
+               hit.pc,
+               hit.write ? "write" : "read ",
+               hit.address,
+               hit.old_value,
+               hit.new_value,
+               line);
+        }
+      }
     }
     ImGui::End();
 
@@ -397,6 +706,7 @@ struct Box
         const auto source_changed =
           ImGui::InputTextMultiline("", status.loaded_files.src.data(), status.loaded_files.src.size(), ImGui::GetContentRegionAvail());
         status.needs_build = status.needs_build || source_changed;
+        if (source_changed) { cpp_box::timeline().instant("edit", "input"); }
       }
       ImGui::EndChild();
       ImGui::SameLine();
@@ -487,7 +797,7 @@ struct Box
 
     sf::Clock deltaClock;
 
-    Status status{ *console, original_path, generate_goals() };
+    Status status{ *console, original_path, generate_goals(), mmio_config };
     window.setFramerateLimit(Status::FPS);
 
     while (window.isOpen()) {
@@ -502,13 +812,9 @@ struct Box
 
       ImGui::SFML::Update(window, deltaClock.restart());
 
-      switch (status.next_state(draw_interface(status))) {
-      case Status::States::Running:
-        status.last_registers = status.sys->registers;
-        status.last_CSPR      = status.sys->CSPR;
-        for (int i = 0; i < status.opsPerFrame && status.sys->operations_remaining(); ++i) { status.sys->next_operation(); }
-        status.update_display();
-        break;
+      const auto inputs = draw_interface(status);
+      switch (status.next_state(inputs)) {
+      case Status::States::Running: status.run_for(status.opsPerFrame); break;
       case Status::States::Begin_Build:
         status.future_build = std::async(
           std::launch::async,
@@ -524,6 +830,7 @@ struct Box
         break;
       case Status::States::Parse_Build_Results:
         if (!status.needs_build) {
+          const cpp_box::Timeline::Scope scope{ cpp_box::timeline(), "wait for build", "compile" };
           status.loaded_files = status.future_build.get();
           console->info("Results Loaded");
         } else {
@@ -531,7 +838,18 @@ struct Box
           console->info("Skipping results loading, build needed");
         }
         break;
-      case Status::States::Paused: break;
+      case Status::States::Paused:
+        if (inputs.step_back_pressed || inputs.run_back_pressed) {
+          status.last_registers = status.sys->registers;
+          status.last_CSPR      = status.sys->CSPR;
+          if (inputs.step_back_pressed) {
+            status.step_back();
+          } else {
+            status.run_back_to_breakpoint();
+          }
+          status.update_display();
+        }
+        break;
       case Status::States::Reset:
         status.reset();
         status.update_display();
@@ -539,12 +857,7 @@ struct Box
       case Status::States::Start: break;
       case Status::States::Reset_Timer: status.reset_static_timer(); break;
       case Status::States::Step_One:
-        if (status.sys->operations_remaining()) {
-          status.last_registers = status.sys->registers;
-          status.last_CSPR      = status.sys->CSPR;
-          status.sys->next_operation();
-          status.update_display();
-        }
+        if (status.sys->operations_remaining()) { status.run_for(1); }
         break;
       case Status::States::Static: {
         const auto texture_size = status.texture.getSize();
@@ -560,6 +873,7 @@ struct Box
         break;
       }
 
+      const cpp_box::Timeline::Scope scope{ cpp_box::timeline(), "render", "gui" };
       window.clear();
 
       ImGui::SFML::Render(window);
@@ -577,16 +891,64 @@ struct Box
   std::filesystem::path clang_compiler{};
   std::filesystem::path freestanding_stdlib{};
   std::filesystem::path hardware_lib{};
+  MMIO_Config mmio_config{};
 
-  Box(std::filesystem::path t_clang_compiler, std::filesystem::path t_freestanding_stdlib, std::filesystem::path t_hardware_lib)
+  Box(std::filesystem::path t_clang_compiler, std::filesystem::path t_freestanding_stdlib, std::filesystem::path t_hardware_lib, MMIO_Config t_mmio_config)
     : clang_compiler{ std::move(t_clang_compiler) }
     , freestanding_stdlib{ std::move(t_freestanding_stdlib) }
     , hardware_lib{ std::move(t_hardware_lib) }
+    , mmio_config{ std::move(t_mmio_config) }
   {
   }
 };
 
 
+// what to compile in, picked on the command line
+struct Box_Options
+{
+  bool rewind{ false };
+  bool heatmap{ false };
+  bool stats{ false };
+};
+
+template<typename RAM_Type, typename Memory_Hooks, typename Stats>
+void run_box(const std::filesystem::path &clang_compiler,
+             const std::filesystem::path &freestanding_stdlib,
+             const std::filesystem::path &hardware_lib,
+             const MMIO_Config &mmio_config,
+             const std::filesystem::path &initial_file)
+{
+  Box<RAM_Type, Memory_Hooks, Stats> box(clang_compiler, freestanding_stdlib, hardware_lib, mmio_config);
+  box.event_loop(initial_file);
+}
+
+template<typename RAM_Type, typename Memory_Hooks, typename... Params> void select_stats(const Box_Options &options, const Params &... params)
+{
+  if (options.stats) {
+    run_box<RAM_Type, Memory_Hooks, cpp_box::arm::Emulator_Stats>(params...);
+  } else {
+    run_box<RAM_Type, Memory_Hooks, cpp_box::arm::NO_STATS>(params...);
+  }
+}
+
+template<typename RAM_Type, typename... Params> void select_memory_hooks(const Box_Options &options, const Params &... params)
+{
+  if (options.heatmap) {
+    select_stats<RAM_Type, cpp_box::arm::Memory_Hooks_Set<Watchpoints, Page_Heatmap>>(options, params...);
+  } else {
+    select_stats<RAM_Type, Watchpoints>(options, params...);
+  }
+}
+
+template<typename... Params> void run_box(const Box_Options &options, const Params &... params)
+{
+  if (options.rewind) {
+    select_memory_hooks<cpp_box::arm::Paged_RAM<cpp_box::system::TOTAL_RAM>>(options, params...);
+  } else {
+    select_memory_hooks<std::vector<std::uint8_t>>(options, params...);
+  }
+}
+
 int main(const int argc, const char *argv[])
 {
   using clara::Opt;
@@ -600,9 +962,22 @@ int main(const int argc, const char *argv[])
   std::filesystem::path user_provided_freestanding_stdlib;
   std::filesystem::path user_provided_hardware_lib;
 
+  MMIO_Config mmio_config;
+  Box_Options box_options;
+  std::filesystem::path record_mmio;
+  std::filesystem::path replay_mmio;
+  std::filesystem::path timeline;
+
   auto cli = Help(showHelp) | Opt(user_provided_clang, "path")["--clang_compiler"]("compile C++ with <clang_compiler>")
              | Opt(user_provided_freestanding_stdlib, "path")["--freestanding_stdlib"]("freestanding stdlib implementation to use")
              | Opt(user_provided_hardware_lib, "path")["--hardware_lib"]("hardware lib implementation to use")
+             | Opt([&](const std::uint32_t value) { mmio_config.seed = value; }, "seed")["--seed"]("seed the random device the same way on every reset")
+             | Opt(record_mmio, "file")["--record_mmio"]("record the MMIO values read since the last reset to <file> on exit")
+             | Opt(replay_mmio, "file")["--replay_mmio"]("replay the MMIO values recorded in <file> after every reset")
+             | Opt(timeline, "file")["--timeline"]("write a Chrome trace_event timeline of building and running to <file> on exit")
+             | Opt(box_options.rewind)["--rewind"]("allow stepping backwards, at some cost to emulation speed")
+             | Opt(box_options.heatmap)["--heatmap"]("count the loads and stores to each page of memory, at some cost to emulation speed")
+             | Opt(box_options.stats)["--stats"]("show what the emulator spends its time on, at some cost to emulation speed")
              | Arg(initialFile, "file")("load <file> as an initial program");
 
   auto result = cli.parse(Args(argc, argv));
@@ -626,7 +1001,30 @@ int main(const int argc, const char *argv[])
     std::cout << "Using compiler: '" << clang_compiler << "'\n";
   }
 
-  Box box(clang_compiler, user_provided_freestanding_stdlib, user_provided_hardware_lib);
+  if (!replay_mmio.empty()) {
+    auto log = cpp_box::system::MMIO_Log::load(replay_mmio);
+    if (!log) {
+      std::cerr << "Unable to read MMIO log: " << replay_mmio << '\n';
+      return EXIT_FAILURE;
+    }
+    mmio_config.mode = cpp_box::system::MMIO_Mode::Replay;
+    mmio_config.log  = std::make_shared<cpp_box::system::MMIO_Log>(std::move(*log));
+  } else if (!record_mmio.empty()) {
+    mmio_config.mode = cpp_box::system::MMIO_Mode::Record;
+    mmio_config.log  = std::make_shared<cpp_box::system::MMIO_Log>();
+  }
+
+  if (!timeline.empty()) { cpp_box::timeline().enable(); }
+
+  run_box(box_options, clang_compiler, user_provided_freestanding_stdlib, user_provided_hardware_lib, mmio_config, initialFile);
+
+  if (!timeline.empty() && !cpp_box::timeline().write(timeline)) {
+    std::cerr << "Unable to write timeline: " << timeline << '\n';
+    return EXIT_FAILURE;
+  }
 
-  box.event_loop(initialFile);
+  if (!record_mmio.empty() && !mmio_config.log->save(record_mmio)) {
+    std::cerr << "Unable to write MMIO log: " << record_mmio << '\n';
+    return EXIT_FAILURE;
+  }
 }
@@ -0,0 +1,260 @@
+#include "../include/cpp_box/arm.hpp"
+#include "../include/cpp_box/elf_reader.hpp"
+#include "../include/cpp_box/memory_map.hpp"
+#include "../include/cpp_box/symbols.hpp"
+#include "../include/cpp_box/thread_pool.hpp"
+#include "../include/cpp_box/trace.hpp"
+#include "../include/cpp_box/trace_analysis.hpp"
+#include "../include/cpp_box/utility.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <clara.hpp>
+#include <fmt/format.h>
+
+namespace {
+
+using cpp_box::arm::reg_bit;
+using cpp_box::arm::Trace_Record;
+
+// Read only view of a whole file, mapped where the platform allows it so multi gigabyte
+// traces don't have to be read up front
+class Mapped_File
+{
+public:
+  explicit Mapped_File(const std::filesystem::path &path)
+  {
+#if defined(_WIN32)
+    m_fallback = cpp_box::utility::read_file(path);
+    m_data     = m_fallback.data();
+    m_size     = m_fallback.size();
+#else
+    const auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) { return; }
+
+    struct stat file_stat
+    {
+    };
+    if (::fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+      auto *mapped = ::mmap(nullptr, static_cast<std::size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapped != MAP_FAILED) {
+        m_data = static_cast<const std::uint8_t *>(mapped);
+        m_size = static_cast<std::size_t>(file_stat.st_size);
+      }
+    }
+    ::close(fd);
+#endif
+  }
+
+  ~Mapped_File()
+  {
+#if !defined(_WIN32)
+    if (m_data != nullptr) { ::munmap(const_cast<std::uint8_t *>(m_data), m_size); }
+#endif
+  }
+
+  Mapped_File(Mapped_File &&)      = delete;
+  Mapped_File(const Mapped_File &) = delete;
+  Mapped_File &operator=(const Mapped_File &) = delete;
+  Mapped_File &operator=(Mapped_File &&) = delete;
+
+  [[nodiscard]] const std::uint8_t *data() const noexcept { return m_data; }
+  [[nodiscard]] std::size_t size() const noexcept { return m_size; }
+
+private:
+  const std::uint8_t *m_data{ nullptr };
+  std::size_t m_size{ 0 };
+#if defined(_WIN32)
+  std::vector<std::uint8_t> m_fallback;
+#endif
+};
+
+std::string register_names(const std::uint16_t registers)
+{
+  std::string names;
+  for (std::uint32_t reg = 0; reg < 15; ++reg) {
+    if ((registers & reg_bit(reg)) != 0) { names += fmt::format("{}r{}", names.empty() ? "" : " ", reg); }
+  }
+  return names.empty() ? "-" : names;
+}
+
+struct Function_Stats
+{
+  std::string name;
+  std::uint64_t instructions{ 0 };
+  std::uint64_t memory_accesses{ 0 };
+  std::uint32_t lowest_address{ 0xFFFF'FFFF };
+  std::uint32_t highest_address{ 0 };
+  std::uint16_t live_on_entry{ 0 };
+};
+
+struct Loop
+{
+  std::uint32_t head;
+  std::uint32_t latch;
+  std::uint64_t iterations;
+  std::uint64_t instructions;
+};
+
+}  // namespace
+
+int main(const int argc, const char *argv[])
+{
+  using clara::Opt;
+  using clara::Arg;
+  using clara::Args;
+  using clara::Help;
+  bool showHelp{ false };
+  std::filesystem::path trace_file;
+  std::filesystem::path elf_file;
+  std::filesystem::path pc_report;
+  std::size_t threads{ std::thread::hardware_concurrency() };
+  std::size_t top{ 20 };
+
+  auto cli = Help(showHelp) | Opt(elf_file, "file")["--elf"]("ELF file the trace was recorded from, for function names")
+             | Opt(threads, "count")["--threads"]("number of worker threads, defaults to the number of cores")
+             | Opt(top, "count")["--top"]("how many functions and loops to report")
+             | Opt(pc_report, "file")["--pc_report"]("write per instruction counts and live registers to <file> as CSV")
+             | Arg(trace_file, "trace")("binary trace written by arm_emu --trace");
+
+  const auto result = cli.parse(Args(argc, argv));
+  if (!result) {
+    std::cerr << "Error in command line: " << result.errorMessage() << '\n';
+    return EXIT_FAILURE;
+  }
+
+  if (showHelp || trace_file.empty()) {
+    std::cout << cli << '\n';
+    return showHelp ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+
+  const Mapped_File trace{ trace_file };
+  cpp_box::arm::Trace_Header header;
+  const cpp_box::arm::Trace_Header expected_header{};
+  if (trace.size() < sizeof(header)) {
+    std::cerr << "Unable to read trace: " << trace_file << '\n';
+    return EXIT_FAILURE;
+  }
+  std::memcpy(&header, trace.data(), sizeof(header));
+  if (header.magic != expected_header.magic || header.version != expected_header.version || header.record_size != sizeof(Trace_Record)) {
+    std::cerr << "Not a supported trace file: " << trace_file << '\n';
+    return EXIT_FAILURE;
+  }
+
+  // the header keeps the records 4 byte aligned within the mapping
+  const auto *records = reinterpret_cast<const Trace_Record *>(trace.data() + sizeof(header));
+  const auto total    = (trace.size() - sizeof(header)) / sizeof(Trace_Record);
+
+  cpp_box::Symbol_Table symbols;
+  std::vector<std::uint8_t> elf_data;
+  if (!elf_file.empty()) {
+    elf_data = cpp_box::utility::read_file(elf_file);
+    const cpp_box::elf::File_Header file_header{ { elf_data.data(), elf_data.size() } };
+    if (elf_data.size() >= 64 && file_header.is_elf_file()) {
+      symbols = cpp_box::Symbol_Table{ file_header, static_cast<std::uint32_t>(cpp_box::system::Memory_Map::USER_RAM_START) };
+    } else {
+      std::cerr << "Not an ELF file, functions will be unnamed: " << elf_file << '\n';
+    }
+  }
+
+  // a few chunks per thread so a slow one doesn't hold everything up
+  const auto chunk_count = std::clamp<std::size_t>(std::max<std::size_t>(threads, 1) * 4, 1, std::max<std::size_t>(total, 1));
+  std::vector<cpp_box::arm::Chunk_Stats> chunks(chunk_count);
+  {
+    cpp_box::utility::Work_Stealing_Pool pool{ threads };
+    for (std::size_t chunk = 0; chunk < chunk_count; ++chunk) {
+      pool.submit([&, chunk] { chunks[chunk] = cpp_box::arm::analyze_chunk(records, total * chunk / chunk_count, total * (chunk + 1) / chunk_count, total); });
+    }
+    pool.wait();
+  }
+
+  const auto [pcs, back_edges, pages] = cpp_box::arm::merge_chunks(chunks);
+
+  std::map<std::string, Function_Stats> functions;
+  for (const auto &[pc, stats] : pcs) {
+    const auto *symbol = symbols.lookup(pc);
+    auto &function     = functions[symbol != nullptr ? symbol->name : std::string{ "<unknown>" }];
+    function.name      = symbol != nullptr ? symbol->name : "<unknown>";
+    function.instructions += stats.count;
+    function.memory_accesses += stats.memory_accesses;
+    function.lowest_address  = std::min(function.lowest_address, stats.lowest_address);
+    function.highest_address = std::max(function.highest_address, stats.highest_address);
+    if (symbol != nullptr && symbol->start == pc) { function.live_on_entry = stats.live; }
+  }
+
+  std::vector<Function_Stats> by_instructions;
+  for (auto &[name, function] : functions) { by_instructions.push_back(std::move(function)); }
+  std::sort(by_instructions.begin(), by_instructions.end(), [](const auto &lhs, const auto &rhs) { return lhs.instructions > rhs.instructions; });
+
+  std::vector<Loop> loops;
+  for (const auto &[edge, iterations] : back_edges) {
+    Loop loop{ static_cast<std::uint32_t>(edge >> 32), static_cast<std::uint32_t>(edge), iterations, 0 };
+    for (auto pc = loop.head; pc <= loop.latch; pc += 4) {
+      if (const auto stats = pcs.find(pc); stats != pcs.end()) { loop.instructions += stats->second.count; }
+    }
+    loops.push_back(loop);
+  }
+  std::sort(loops.begin(), loops.end(), [](const auto &lhs, const auto &rhs) { return lhs.instructions > rhs.instructions; });
+
+  const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  const auto percent = [total](const std::uint64_t count) { return total > 0 ? 100.0 * static_cast<double>(count) / static_cast<double>(total) : 0.0; };
+
+  std::cout << fmt::format("{} instructions traced, analyzed in {:.3f}s on {} threads\n\n", total, seconds, threads);
+
+  std::cout << "Functions by instructions executed:\n";
+  std::cout << fmt::format("  {:>14} {:>7} {:>12}  {:<23} {:<24} {}\n", "instructions", "%", "accesses", "addresses", "live on entry", "function");
+  for (std::size_t idx = 0; idx < std::min(top, by_instructions.size()); ++idx) {
+    const auto &function = by_instructions[idx];
+    const auto addresses = function.memory_accesses > 0 ? fmt::format("{:#010x}-{:#010x}", function.lowest_address, function.highest_address) : "-";
+    std::cout << fmt::format("  {:>14} {:>6.2f}% {:>12}  {:<23} {:<24} {}\n",
+                             function.instructions,
+                             percent(function.instructions),
+                             function.memory_accesses,
+                             addresses,
+                             register_names(function.live_on_entry),
+                             function.name);
+  }
+
+  std::cout << "\nHot loops:\n";
+  std::cout << fmt::format("  {:>14} {:>7} {:>12}  {}\n", "instructions", "%", "iterations", "loop");
+  for (std::size_t idx = 0; idx < std::min(top, loops.size()); ++idx) {
+    const auto &loop = loops[idx];
+    std::cout << fmt::format("  {:>14} {:>6.2f}% {:>12}  {} .. {}\n",
+                             loop.instructions,
+                             percent(loop.instructions),
+                             loop.iterations,
+                             symbols.describe(loop.head),
+                             symbols.describe(loop.latch));
+  }
+
+  std::cout << "\nMemory accessed:\n";
+  for (const auto &range : cpp_box::arm::memory_ranges(pages)) {
+    std::cout << fmt::format("  {:#010x}-{:#010x} {:>14} accesses\n", range.begin, range.end, range.accesses);
+  }
+
+  if (!pc_report.empty()) {
+    std::map<std::uint32_t, cpp_box::arm::PC_Stats> ordered{ pcs.begin(), pcs.end() };
+    std::ofstream ofs{ pc_report };
+    ofs << "pc,location,count,memory_accesses,live_registers\n";
+    for (const auto &[pc, stats] : ordered) {
+      ofs << fmt::format("{:#010x},{},{},{},{}\n", pc, symbols.describe(pc), stats.count, stats.memory_accesses, register_names(stats.live));
+    }
+  }
+}
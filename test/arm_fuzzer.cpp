@@ -0,0 +1,99 @@
+#include "../include/cpp_box/arm.hpp"
+#include "../include/cpp_box/differential.hpp"
+#include "../include/cpp_box/paged_ram.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Runs every input as a stream of instructions on a small System and checks either the lockstep
+// or the paged engine against it, picked by a hash of the input, aborting on the first thing
+// they disagree about. Prints nothing, and the reference and lockstep Systems are reset between
+// inputs instead of being rebuilt, so the time goes into executing inputs.
+//
+// An input is 64 bytes of initial state, r0 - r12 and then the flags, followed by the program,
+// which is loaded at 0. Missing state bytes are 0.
+
+namespace {
+
+constexpr std::size_t ram_size         = 16384;
+constexpr std::size_t state_size       = 64;
+constexpr std::size_t max_program_size = 4096;  // what the I-cache holds from address 0
+constexpr std::uint64_t max_instructions = 512;
+
+using Hooks     = cpp_box::arm::Dirty_Pages<ram_size>;
+using Reference = cpp_box::arm::System<ram_size, std::vector<std::uint8_t>, cpp_box::arm::NO_MMIO, cpp_box::arm::NO_TIMING, Hooks>;
+using Paged     = cpp_box::arm::System<ram_size, cpp_box::arm::Paged_RAM<ram_size>, cpp_box::arm::NO_MMIO, cpp_box::arm::NO_TIMING, Hooks>;
+
+template<typename System> void set_up(System &sys, const std::array<std::uint8_t, state_size> &state)
+{
+  const auto word = [&state](const std::size_t idx) {
+    std::uint32_t value{};
+    std::memcpy(&value, &state[idx * 4], sizeof(value));
+    return value;
+  };
+
+  sys.setup_run(0);
+  for (std::uint32_t reg = 0; reg < 13; ++reg) { sys.registers[reg] = word(reg); }
+  sys.CSPR = word(13) & 0xF0000000;
+}
+
+// puts a System that already ran an input back the way a freshly built one would start the
+// next, without reallocating its RAM
+void reset(Reference &sys, const std::basic_string_view<std::uint8_t> program, const std::array<std::uint8_t, state_size> &state)
+{
+  std::fill(sys.builtin_ram.begin(), sys.builtin_ram.end(), std::uint8_t{ 0 });
+  sys.registers            = {};
+  sys.invalid_memory_write = false;
+  sys.stop_reason          = cpp_box::arm::Stop_Reason::Exited;
+  sys.memory_hooks.clear();
+
+  sys.load_image(program.data(), program.size(), 0);
+  sys.i_cache.fill_cache(sys);
+  set_up(sys, state);
+}
+
+// FNV-1a, so that the same input always goes to the same engine
+std::uint32_t hash(const std::uint8_t *data, const std::size_t size) noexcept
+{
+  std::uint32_t value = 2166136261U;
+  for (std::size_t idx = 0; idx < size; ++idx) { value = (value ^ data[idx]) * 16777619U; }
+  return value;
+}
+
+template<typename Candidate> void check(Reference &reference, Candidate &candidate)
+{
+  cpp_box::arm::Differential differential{ reference, candidate, max_instructions };
+  if (differential.run_for(max_instructions)) { std::abort(); }
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t *data, std::size_t size)
+{
+  std::array<std::uint8_t, state_size> state{};
+  const auto state_bytes = std::min(size, state_size);
+  std::memcpy(state.data(), data, state_bytes);
+  const std::basic_string_view<std::uint8_t> program{ data + state_bytes, std::min(size - state_bytes, max_program_size) };
+
+  // RAM is a std::vector so that the sanitizer notices anything reaching past its end
+  static Reference reference;
+  reset(reference, program, state);
+
+  if (hash(data, size) & 1U) {
+    // every lane runs the same program, so they never split up
+    static cpp_box::arm::Lockstep_Engine<Reference, 2> lockstep{ reference };
+    for (std::size_t lane = 0; lane < lockstep.lanes.size(); ++lane) { reset(lockstep.lanes.lane(lane), program, state); }
+    check(reference, lockstep);
+  } else {
+    Paged paged{ std::make_shared<const cpp_box::arm::Shared_Image>(program) };
+    set_up(paged, state);
+    check(reference, paged);
+  }
+
+  return 0;
+}
@@ -2,6 +2,23 @@
 #include <catch2/catch.hpp>
 
 #include <cpp_box/arm.hpp>
+#include <cpp_box/coverage.hpp>
+#include <cpp_box/differential.hpp>
+#include <cpp_box/execution_counts.hpp>
+#include <cpp_box/lockstep.hpp>
+#include <cpp_box/memory_heatmap.hpp>
+#include <cpp_box/mmio.hpp>
+#include <cpp_box/paged_ram.hpp>
+#include <cpp_box/profiler.hpp>
+#include <cpp_box/rewind.hpp>
+#include <cpp_box/smp.hpp>
+#include <cpp_box/stats.hpp>
+#include <cpp_box/symbols.hpp>
+#include <cpp_box/timing.hpp>
+#include <cpp_box/trace.hpp>
+#include <cpp_box/trace_analysis.hpp>
+#include <cpp_box/unwind.hpp>
+#include <cpp_box/watchpoints.hpp>
 
 template<bool B> bool static_test()
 {
@@ -176,6 +193,49 @@ TEST_CASE("test lsr")
   REQUIRE(TEST(sys.registers[3] == 5));
 }
 
+TEST_CASE("Test scaled register offsets")
+{
+  CONSTEXPR auto sys = run_instruction(cpp_box::arm::Instruction{ 0xe3a00064 },  // mov r0, #100
+                                       cpp_box::arm::Instruction{ 0xe3a01003 },  // mov r1, #3
+                                       cpp_box::arm::Instruction{ 0xe3a02055 },  // mov r2, #85
+                                       cpp_box::arm::Instruction{ 0xe7802181 },  // str r2, [r0, r1, lsl #3]
+                                       cpp_box::arm::Instruction{ 0xe7904181 },  // ldr r4, [r0, r1, lsl #3]
+                                       cpp_box::arm::Instruction{ 0xe7903101 }   // ldr r3, [r0, r1, lsl #2]
+  );
+  // the shift amount is bits 11 - 7, so these are offsets of 24 and 12
+  REQUIRE(TEST(sys.read_word(124) == 85));
+  REQUIRE(TEST(sys.read_word(106) == 0));
+  REQUIRE(TEST(sys.registers[4] == 85));
+  REQUIRE(TEST(sys.registers[3] == 0));
+}
+
+TEST_CASE("Test signed overflow flag")
+{
+  // most negative minus one overflows, so lt holds even though the result is positive
+  CONSTEXPR auto sub = run_instruction(cpp_box::arm::Instruction{ 0xe3a01102 },  // mov r1, #0x80000000
+                                       cpp_box::arm::Instruction{ 0xe3510001 },  // cmp r1, #1
+                                       cpp_box::arm::Instruction{ 0xb3a05001 }   // movlt r5, #1
+  );
+  REQUIRE(TEST(sub.v_flag() == true));
+  REQUIRE(TEST(sub.n_flag() == false));
+  REQUIRE(TEST(sub.registers[5] == 1));
+
+  CONSTEXPR auto add = run_instruction(cpp_box::arm::Instruction{ 0xe3e01102 },  // mvn r1, #0x80000000
+                                       cpp_box::arm::Instruction{ 0xe2913001 }   // adds r3, r1, #1
+  );
+  REQUIRE(TEST(add.v_flag() == true));
+  REQUIRE(TEST(add.registers[3] == 0x80000000));
+
+  // a borrow alone isn't an overflow
+  CONSTEXPR auto borrow = run_instruction(cpp_box::arm::Instruction{ 0xe3a01000 },  // mov r1, #0
+                                          cpp_box::arm::Instruction{ 0xe3510001 },  // cmp r1, #1
+                                          cpp_box::arm::Instruction{ 0xb3a05001 }   // movlt r5, #1
+  );
+  REQUIRE(TEST(borrow.v_flag() == false));
+  REQUIRE(TEST(borrow.c_flag() == false));
+  REQUIRE(TEST(borrow.registers[5] == 1));
+}
+
 TEST_CASE("Test sub instruction with shift")
 {
   CONSTEXPR auto systest7 = run_instruction(cpp_box::arm::Instruction{ 0xe2800001 },  // add r0, r0, #1
@@ -318,4 +378,996 @@ TEST_CASE("Test arbitrary code")
   REQUIRE(TEST(thing.read_byte(1001) == 12));  // NOLINT This suppresses an initialization warning from catch2
 }
 
+TEST_CASE("Test swap")
+{
+  // 0:  e3a01064  mov r1, #100
+  // 4:  e3a02005  mov r2, #5
+  // 8:  e5812000  str r2, [r1]
+  // c:  e3a03c17  mov r3, #5888
+  // 10: e1010093  swp r0, r3, [r1]
+  // 14: e5914000  ldr r4, [r1]
+  // 18: e1415092  swpb r5, r2, [r1]
+  // 1c: e5916000  ldr r6, [r1]
+  // 20: e1a0f00e  mov pc, lr
+  CONSTEXPR auto system = run(0x64, 0x10, 0xa0, 0xe3, 0x05, 0x20, 0xa0, 0xe3, 0x00, 0x20, 0x81, 0xe5, 0x17, 0x3c, 0xa0, 0xe3, 0x93, 0x00, 0x01, 0xe1, 0x00,
+                              0x40, 0x91, 0xe5, 0x92, 0x50, 0x41, 0xe1, 0x00, 0x60, 0x91, 0xe5, 0x0e, 0xf0, 0xa0, 0xe1);
+  REQUIRE(TEST(system.registers[0] == 5));
+  REQUIRE(TEST(system.registers[4] == 0x1700));
+  REQUIRE(TEST(system.registers[5] == 0));
+  REQUIRE(TEST(system.registers[6] == 0x1705));
+}
+
+template<typename... T> CONSTEXPR auto run_timed(T... bytes)
+{
+  std::array<uint8_t, sizeof...(T)> data{ static_cast<std::uint8_t>(bytes)... };
+  cpp_box::arm::System<1024, std::array<std::uint8_t, 1024>, cpp_box::arm::NO_MMIO, cpp_box::arm::ARM7TDMI_Timing> system{ data };
+  system.run(0);
+  return system;
+}
+
+TEST_CASE("Test ARM7TDMI cycle counting")
+{
+  // 0:  e3a00003  mov r0, #3             1S
+  // 4:  e3a01000  mov r1, #0             1S
+  // 8:  e0811000  add r1, r1, r0         1S      x3
+  // c:  e2500001  subs r0, r0, #1        1S      x3
+  // 10: 1afffffc  bne loop               2S+1N   x2, 1S when not taken
+  // 14: e52d1004  str r1, [sp, #-4]!     2N
+  // 18: e49d0004  ldr r0, [sp], #4       1S+1N+1I
+  // 1c: e1a0f00e  mov pc, lr             2S+1N
+  CONSTEXPR auto system = run_timed(0x03, 0x00, 0xa0, 0xe3, 0x00, 0x10, 0xa0, 0xe3, 0x00, 0x10, 0x81, 0xe0, 0x01, 0x00, 0x50, 0xe2,
+                                    0xfc, 0xff, 0xff, 0x1a, 0x04, 0x10, 0x2d, 0xe5, 0x04, 0x00, 0x9d, 0xe4, 0x0e, 0xf0, 0xa0, 0xe1);
+  REQUIRE(TEST(system.registers[0] == 6));
+  REQUIRE(TEST(system.timing.s_cycles == 16));
+  REQUIRE(TEST(system.timing.n_cycles == 6));
+  REQUIRE(TEST(system.timing.i_cycles == 1));
+  REQUIRE(TEST(system.timing.cycles() == 23));
+}
+
+TEST_CASE("Test multiply early termination")
+{
+  using cpp_box::arm::ARM7TDMI_Timing;
+  REQUIRE(TEST(ARM7TDMI_Timing::multiplier_cycles(true, 0xFF) == 1));
+  REQUIRE(TEST(ARM7TDMI_Timing::multiplier_cycles(true, 0xFFFF) == 2));
+  REQUIRE(TEST(ARM7TDMI_Timing::multiplier_cycles(true, 0xFFFFFF) == 3));
+  REQUIRE(TEST(ARM7TDMI_Timing::multiplier_cycles(true, 0xFFFFFFFF) == 4));
+  REQUIRE(TEST(ARM7TDMI_Timing::multiplier_cycles(false, 0xFFFFFFFF) == 1));
+  REQUIRE(TEST(ARM7TDMI_Timing::multiplier_cycles(false, 0xFFFF8000) == 2));
+}
+
 #endif
+
+TEST_CASE("Test accesses at the top of the address space")
+{
+  // addresses within a word of 0xFFFFFFFF used to wrap around the bounds checks and land past the end of RAM
+  CONSTEXPR auto direct = [] {
+    cpp_box::arm::System system{};
+    for (std::uint32_t loc = 0xFFFF'FFFD; loc != 0; ++loc) {
+      system.write_word(loc, 0xFFFF'FFFF);
+      system.write_half_word(loc, 0xFFFF);
+    }
+    return system;
+  }();
+  REQUIRE(TEST(direct.invalid_memory_write));
+  REQUIRE(TEST(direct.read_word(0xFFFF'FFFD) == 0));
+  REQUIRE(TEST(direct.read_half_word(0xFFFF'FFFF) == 0));
+  REQUIRE(TEST(direct.read_word(1020) == 0));
+
+  CONSTEXPR auto swapped = run_instruction(cpp_box::arm::Instruction{ 0xe3e00001 },  // mvn r0, #1
+                                           cpp_box::arm::Instruction{ 0xe3a02005 },  // mov r2, #5
+                                           cpp_box::arm::Instruction{ 0xe1001092 }   // swp r1, r2, [r0]
+  );
+  REQUIRE(TEST(swapped.invalid_memory_write));
+  REQUIRE(TEST(swapped.registers[1] == 0));
+  REQUIRE(TEST(swapped.read_word(1020) == 0));
+}
+
+TEST_CASE("Test bulk image loading")
+{
+  const std::array<std::uint8_t, 8> image{ 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08 };
+  cpp_box::arm::System<> system{};
+
+  system.load_image(image.data(), image.size(), 16);
+  REQUIRE(system.read_word(16) == 0x04030201);
+  REQUIRE(system.read_word(20) == 0x08070605);
+  REQUIRE(!system.invalid_memory_write);
+
+  // only the part that fits is loaded
+  system.load_image(image.data(), image.size(), 1020);
+  REQUIRE(system.read_word(1020) == 0x04030201);
+  REQUIRE(system.invalid_memory_write);
+}
+
+TEST_CASE("Test breakpoints")
+{
+  // the program from "Test ARM7TDMI cycle counting", a loop running 3 times
+  const std::array<std::uint8_t, 32> program{ 0x03, 0x00, 0xa0, 0xe3, 0x00, 0x10, 0xa0, 0xe3, 0x00, 0x10, 0x81, 0xe0, 0x01, 0x00, 0x50, 0xe2,
+                                              0xfc, 0xff, 0xff, 0x1a, 0x04, 0x10, 0x2d, 0xe5, 0x04, 0x00, 0x9d, 0xe4, 0x0e, 0xf0, 0xa0, 0xe1 };
+  cpp_box::arm::System<> system{ program };
+  REQUIRE(system.add_breakpoint(0x08));
+  REQUIRE(system.add_breakpoint(0x10));
+
+  std::vector<std::uint32_t> stops;
+  std::uint64_t executed = 0;
+  auto result            = system.run(0);
+  for (; result.reason == cpp_box::arm::Stop_Reason::Breakpoint; result = system.run_for(1000)) {
+    stops.push_back(system.PC() - 4);
+    executed += result.instructions;
+  }
+  executed += result.instructions;
+
+  REQUIRE(result.reason == cpp_box::arm::Stop_Reason::Exited);
+  REQUIRE(executed == 14);
+  REQUIRE(system.registers[0] == 6);
+  // the bne stops even when its condition fails
+  REQUIRE(stops == std::vector<std::uint32_t>{ 0x08, 0x10, 0x08, 0x10, 0x08, 0x10 });
+
+  // removing the breakpoint we're stopped at doesn't let the run go through the next one
+  REQUIRE(system.run(0).reason == cpp_box::arm::Stop_Reason::Breakpoint);
+  REQUIRE(system.PC() - 4 == 0x08);
+  const auto stopped = system;
+  system.remove_breakpoint(0x08);
+  result = system.run_for(1000);
+  REQUIRE(result.reason == cpp_box::arm::Stop_Reason::Breakpoint);
+  REQUIRE(result.instructions == 2);
+  REQUIRE(system.PC() - 4 == 0x10);
+
+  // nor does going back to when we were stopped there, the way Rewind_History restores
+  system                  = stopped;
+  system.breakpoints[0]   = 0x10;
+  system.breakpoint_count = 1;
+  system.i_cache.fill_cache(system);
+  result = system.run_for(1000);
+  REQUIRE(result.reason == cpp_box::arm::Stop_Reason::Breakpoint);
+  REQUIRE(result.instructions == 2);
+  REQUIRE(system.PC() - 4 == 0x10);
+
+  // moving the PC away from a breakpoint we stopped at forgets about stepping over it
+  REQUIRE(system.add_breakpoint(0x08));
+  system.PC() = 0x04 + 4;
+  REQUIRE(system.run_for(1000).instructions == 1);
+  REQUIRE(system.PC() - 4 == 0x08);
+
+  system.remove_breakpoint(0x08);
+  system.remove_breakpoint(0x10);
+  REQUIRE(system.breakpoint_count == 0);
+  REQUIRE(system.run(0).instructions == 14);
+}
+
+TEST_CASE("Test lazy instruction cache")
+{
+  // ldr r1, [pc, #12]; str r1, [pc]; mov r0, #1; mov r0, #2; mov pc, lr; then the word add r0, r0, #10,
+  // which the str writes over the mov r0, #2
+  const std::array<std::uint8_t, 24> program{ 0x0c, 0x10, 0x9f, 0xe5, 0x00, 0x10, 0x8f, 0xe5, 0x01, 0x00, 0xa0, 0xe3,
+                                              0x02, 0x00, 0xa0, 0xe3, 0x0e, 0xf0, 0xa0, 0xe1, 0x0a, 0x00, 0x80, 0xe2 };
+  cpp_box::arm::System<1024,
+                       std::array<std::uint8_t, 1024>,
+                       cpp_box::arm::NO_MMIO,
+                       cpp_box::arm::NO_TIMING,
+                       cpp_box::arm::NO_MEMORY_HOOKS,
+                       cpp_box::arm::Emulator_Stats>
+    system{ program };
+  system.stats.reset();
+
+  // entries are only decoded the first time they're fetched, so the store is seen
+  REQUIRE(system.run(0).reason == cpp_box::arm::Stop_Reason::Exited);
+  REQUIRE(system.registers[0] == 11);
+  REQUIRE(system.stats.cache_refills == 0);
+  REQUIRE(system.stats.cache_misses == 0);
+
+  // after that they stay as they were decoded until the cache is refilled
+  system.write_word(8, 0xe3a00005);  // mov r0, #5
+  REQUIRE(system.run(0).reason == cpp_box::arm::Stop_Reason::Exited);
+  REQUIRE(system.registers[0] == 11);
+
+  system.i_cache.fill_cache(system);
+  REQUIRE(system.run(0).reason == cpp_box::arm::Stop_Reason::Exited);
+  REQUIRE(system.registers[0] == 15);
+  REQUIRE(system.stats.cache_refills == 1);
+
+  // a breakpoint is still decoded into its entry up front, and stays there after the store
+  REQUIRE(system.add_breakpoint(12));
+  system.write_word(12, 0xe3a00002);  // mov r0, #2
+  REQUIRE(system.run(0).reason == cpp_box::arm::Stop_Reason::Breakpoint);
+  REQUIRE(system.PC() - 4 == 12);
+  REQUIRE(system.run_for(1000).reason == cpp_box::arm::Stop_Reason::Exited);
+  REQUIRE(system.registers[0] == 15);
+}
+
+TEST_CASE("Test execution counts")
+{
+  // the program from "Test breakpoints", with its loop at 0x08 - 0x10
+  const std::array<std::uint8_t, 32> program{ 0x03, 0x00, 0xa0, 0xe3, 0x00, 0x10, 0xa0, 0xe3, 0x00, 0x10, 0x81, 0xe0, 0x01, 0x00, 0x50, 0xe2,
+                                              0xfc, 0xff, 0xff, 0x1a, 0x04, 0x10, 0x2d, 0xe5, 0x04, 0x00, 0x9d, 0xe4, 0x0e, 0xf0, 0xa0, 0xe1 };
+  cpp_box::arm::System<> system{ program };
+  REQUIRE(system.add_breakpoint(0x10));
+
+  cpp_box::arm::Execution_Counts counts{ 0, 32 };
+  system.setup_run(0);
+  for (auto result = system.run_for(1000, counts); result.reason == cpp_box::arm::Stop_Reason::Breakpoint; result = system.run_for(1000, counts)) {
+    counts.undo_last();
+  }
+
+  REQUIRE(counts.counts() == std::vector<std::uint64_t>{ 1, 1, 3, 3, 3, 1, 1, 1 });
+  counts.clear();
+  REQUIRE(counts.counts() == std::vector<std::uint64_t>(8));
+}
+
+TEST_CASE("Test coverage bitmap")
+{
+  // the program from "Test breakpoints", with 4 bytes of padding that never run
+  const std::array<std::uint8_t, 36> program{ 0x03, 0x00, 0xa0, 0xe3, 0x00, 0x10, 0xa0, 0xe3, 0x00, 0x10, 0x81, 0xe0, 0x01, 0x00, 0x50, 0xe2, 0xfc, 0xff,
+                                              0xff, 0x1a, 0x04, 0x10, 0x2d, 0xe5, 0x04, 0x00, 0x9d, 0xe4, 0x0e, 0xf0, 0xa0, 0xe1, 0x00, 0x00, 0x00, 0x00 };
+  cpp_box::arm::System<> system{ program };
+
+  cpp_box::arm::Coverage coverage{ 0, 36 };
+  REQUIRE(system.run(0, coverage).reason == cpp_box::arm::Stop_Reason::Exited);
+
+  for (std::uint32_t offset = 0; offset < 32; offset += 4) { REQUIRE(coverage.covered(offset)); }
+  REQUIRE(!coverage.covered(32));
+  REQUIRE(!coverage.covered(1024));
+}
+
+TEST_CASE("Test emulator stats")
+{
+  // the program from "Test breakpoints"
+  const std::array<std::uint8_t, 32> program{ 0x03, 0x00, 0xa0, 0xe3, 0x00, 0x10, 0xa0, 0xe3, 0x00, 0x10, 0x81, 0xe0, 0x01, 0x00, 0x50, 0xe2,
+                                              0xfc, 0xff, 0xff, 0x1a, 0x04, 0x10, 0x2d, 0xe5, 0x04, 0x00, 0x9d, 0xe4, 0x0e, 0xf0, 0xa0, 0xe1 };
+  cpp_box::arm::System<1024,
+                       std::array<std::uint8_t, 1024>,
+                       cpp_box::arm::NO_MMIO,
+                       cpp_box::arm::NO_TIMING,
+                       cpp_box::arm::NO_MEMORY_HOOKS,
+                       cpp_box::arm::Emulator_Stats>
+    system{ program };
+
+  REQUIRE(system.run(0).instructions == 14);
+  REQUIRE(system.stats.fetches == 14);
+  REQUIRE(system.stats.cache_hits() == 14);
+  REQUIRE(system.stats.cache_misses == 0);
+  REQUIRE(system.stats.instruction_count(cpp_box::arm::Instruction_Type::Data_Processing) == 9);
+  REQUIRE(system.stats.instruction_count(cpp_box::arm::Instruction_Type::Branch) == 3);
+  REQUIRE(system.stats.instruction_count(cpp_box::arm::Instruction_Type::Single_Data_Transfer) == 2);
+
+  system.write_word(1024, 0);
+  REQUIRE(system.stats.invalid_writes == 1);
+
+  // the instruction a breakpoint stops in front of is only counted once it executes
+  system.stats.reset();
+  REQUIRE(system.add_breakpoint(0x14));
+  const auto stopped = system.run(0);
+  REQUIRE(stopped.reason == cpp_box::arm::Stop_Reason::Breakpoint);
+  REQUIRE(system.stats.fetches == stopped.instructions);
+  REQUIRE(system.run_for(1000).reason == cpp_box::arm::Stop_Reason::Exited);
+  REQUIRE(system.stats.fetches == 14);
+  system.clear_breakpoints();
+
+  cpp_box::arm::Emulator_Stats total;
+  total += system.stats;
+  total += system.stats;
+  REQUIRE(total.fetches == 28);
+  system.stats.reset();
+  REQUIRE(system.stats.fetches == 0);
+
+  // MMIO reads are kept in address order without allocating, past the fixed number of registers
+  // they're only counted together
+  cpp_box::arm::Emulator_Stats mmio;
+  mmio.mmio_read(0x14);
+  mmio.mmio_read(0x10);
+  mmio.mmio_read(0x14);
+  REQUIRE(mmio.mmio_registers == 2);
+  REQUIRE(mmio.mmio_reads[0] == std::pair<std::uint32_t, std::uint64_t>{ 0x10, 1 });
+  REQUIRE(mmio.mmio_reads_from(0x14) == 2);
+  for (std::uint32_t loc = 0; loc < cpp_box::arm::Emulator_Stats::max_mmio_registers; ++loc) { mmio.mmio_read(0x100 + loc); }
+  REQUIRE(mmio.mmio_registers == cpp_box::arm::Emulator_Stats::max_mmio_registers);
+  REQUIRE(mmio.other_mmio_reads == 2);
+
+  total += mmio;
+  REQUIRE(total.mmio_reads_from(0x14) == 2);
+  REQUIRE(total.other_mmio_reads == 2);
+}
+
+TEST_CASE("Test watchpoints")
+{
+  // the program from "Test breakpoints", which pushes and pops its result at the end
+  const std::array<std::uint8_t, 32> program{ 0x03, 0x00, 0xa0, 0xe3, 0x00, 0x10, 0xa0, 0xe3, 0x00, 0x10, 0x81, 0xe0, 0x01, 0x00, 0x50, 0xe2,
+                                              0xfc, 0xff, 0xff, 0x1a, 0x04, 0x10, 0x2d, 0xe5, 0x04, 0x00, 0x9d, 0xe4, 0x0e, 0xf0, 0xa0, 0xe1 };
+  cpp_box::arm::System<1024, std::array<std::uint8_t, 1024>, cpp_box::arm::NO_MMIO, cpp_box::arm::NO_TIMING, cpp_box::arm::Watchpoints<1024>> system{
+    program
+  };
+  system.memory_hooks.add({ 1016, 1024, cpp_box::arm::Watch::Access });
+  REQUIRE(system.memory_hooks.is_hooked(1016));
+
+  auto result = system.run(0);
+  REQUIRE(result.reason == cpp_box::arm::Stop_Reason::Watchpoint);
+  REQUIRE(system.memory_hooks.hits.size() == 1);
+  const auto write = system.memory_hooks.hits[0];
+  REQUIRE(write.write);
+  REQUIRE(write.pc == 0x14);
+  REQUIRE(write.address == 1019);
+  REQUIRE(write.old_value == 0);
+  REQUIRE(write.new_value == 6);
+
+  result = system.run_for(1000);
+  REQUIRE(result.reason == cpp_box::arm::Stop_Reason::Watchpoint);
+  const auto read = system.memory_hooks.hits[1];
+  REQUIRE(!read.write);
+  REQUIRE(read.pc == 0x18);
+  REQUIRE(read.new_value == 6);
+
+  system.memory_hooks.clear();
+  REQUIRE(system.run_for(1000).reason == cpp_box::arm::Stop_Reason::Exited);
+  REQUIRE(system.registers[0] == 6);
+}
+
+TEST_CASE("Test page heatmap")
+{
+  // the program from "Test breakpoints", which pushes and pops its result at the end
+  const std::array<std::uint8_t, 32> program{ 0x03, 0x00, 0xa0, 0xe3, 0x00, 0x10, 0xa0, 0xe3, 0x00, 0x10, 0x81, 0xe0, 0x01, 0x00, 0x50, 0xe2,
+                                              0xfc, 0xff, 0xff, 0x1a, 0x04, 0x10, 0x2d, 0xe5, 0x04, 0x00, 0x9d, 0xe4, 0x0e, 0xf0, 0xa0, 0xe1 };
+  using Hooks = cpp_box::arm::Memory_Hooks_Set<cpp_box::arm::Watchpoints<8192>, cpp_box::arm::Page_Heatmap<8192>>;
+  cpp_box::arm::System<8192, std::array<std::uint8_t, 8192>, cpp_box::arm::NO_MMIO, cpp_box::arm::NO_TIMING, Hooks> system{ program };
+  system.memory_hooks.add({ 0, 4, cpp_box::arm::Watch::Access });
+
+  // instruction fetches aren't counted, only the push and the pop near the top of the stack
+  REQUIRE(system.run(0).reason == cpp_box::arm::Stop_Reason::Exited);
+  REQUIRE(system.memory_hooks.hits.empty());
+  REQUIRE(system.memory_hooks.reads(0) == 0);
+  REQUIRE(system.memory_hooks.reads(1) == 1);
+  REQUIRE(system.memory_hooks.writes(1) == 1);
+  REQUIRE(system.memory_hooks.pages_touched() == 1);
+
+  system.memory_hooks.reset_counts();
+  REQUIRE(system.memory_hooks.pages_touched() == 0);
+
+  // on its own the heatmap doesn't need stores to read what they overwrite, next to watchpoints they do
+  static_assert(!cpp_box::arm::Page_Heatmap<8192>::wants_old_value);
+  static_assert(Hooks::wants_old_value);
+  cpp_box::arm::System<8192, std::array<std::uint8_t, 8192>, cpp_box::arm::NO_MMIO, cpp_box::arm::NO_TIMING, cpp_box::arm::Page_Heatmap<8192>> heatmap_only{
+    program
+  };
+  REQUIRE(heatmap_only.run(0).reason == cpp_box::arm::Stop_Reason::Exited);
+  REQUIRE(heatmap_only.registers[0] == 6);
+  REQUIRE(heatmap_only.memory_hooks.reads(1) == 1);
+  REQUIRE(heatmap_only.memory_hooks.writes(1) == 1);
+}
+
+TEST_CASE("Test reverse execution")
+{
+  // the program from "Test breakpoints"
+  const std::array<std::uint8_t, 32> program{ 0x03, 0x00, 0xa0, 0xe3, 0x00, 0x10, 0xa0, 0xe3, 0x00, 0x10, 0x81, 0xe0, 0x01, 0x00, 0x50, 0xe2,
+                                              0xfc, 0xff, 0xff, 0x1a, 0x04, 0x10, 0x2d, 0xe5, 0x04, 0x00, 0x9d, 0xe4, 0x0e, 0xf0, 0xa0, 0xe1 };
+  cpp_box::arm::System<> system{ program };
+  system.setup_run(0);
+
+  // small enough to force the checkpoints to be thinned out
+  cpp_box::arm::Rewind_History<cpp_box::arm::System<>> history{ 3 * sizeof(cpp_box::arm::System<>), 2 };
+  history.reset(system);
+
+  std::vector<std::array<std::uint32_t, 16>> states{ system.registers };
+  while (history.run_for(system, 1).reason == cpp_box::arm::Stop_Reason::Budget_Exhausted) { states.push_back(system.registers); }
+  states.push_back(system.registers);
+  REQUIRE(history.now() == 14);
+  REQUIRE(history.checkpoint_count() <= 3);
+  REQUIRE(history.interval() > 2);
+
+  while (history.step_back(system)) { REQUIRE(system.registers == states[history.now()]); }
+  REQUIRE(history.now() == 0);
+
+  REQUIRE(history.run_for(system, 1000).reason == cpp_box::arm::Stop_Reason::Exited);
+  REQUIRE(system.registers[0] == 6);
+
+  // the last time through the loop
+  REQUIRE(system.add_breakpoint(0x08));
+  REQUIRE(history.run_back_to_breakpoint(system));
+  REQUIRE(history.now() == 8);
+  REQUIRE(system.PC() - 4 == 0x08);
+  REQUIRE(system.registers[0] == 1);
+
+  // continues from the breakpoint, as if we had stopped there going forward
+  REQUIRE(history.run_for(system, 1000).reason == cpp_box::arm::Stop_Reason::Exited);
+  REQUIRE(history.now() == 14);
+}
+
+TEST_CASE("Test checkpoint memory accounting")
+{
+  // the program from "Test breakpoints", which only writes to the stack
+  const std::array<std::uint8_t, 32> program{ 0x03, 0x00, 0xa0, 0xe3, 0x00, 0x10, 0xa0, 0xe3, 0x00, 0x10, 0x81, 0xe0, 0x01, 0x00, 0x50, 0xe2,
+                                              0xfc, 0xff, 0xff, 0x1a, 0x04, 0x10, 0x2d, 0xe5, 0x04, 0x00, 0x9d, 0xe4, 0x0e, 0xf0, 0xa0, 0xe1 };
+  using Paged_System = cpp_box::arm::System<16384, cpp_box::arm::Paged_RAM<16384>>;
+  constexpr auto page_size = cpp_box::arm::Page_Size;
+
+  Paged_System system{ program };
+  system.setup_run(0);
+
+  // the program's page and the zero page mapped everywhere else
+  cpp_box::arm::Rewind_History<Paged_System> history{ 1024 * 1024, 1 };
+  history.reset(system);
+  REQUIRE(history.memory_used() == sizeof(Paged_System) + 2 * page_size);
+
+  // a checkpoint after every instruction, all of them sharing the same two pages
+  REQUIRE(history.run_for(system, 4).reason == cpp_box::arm::Stop_Reason::Budget_Exhausted);
+  REQUIRE(history.checkpoint_count() == 5);
+  REQUIRE(history.memory_used() == 5 * sizeof(Paged_System) + 2 * page_size);
+
+  // pushing onto the stack copies its page, which the checkpoints after it share
+  REQUIRE(history.run_for(system, 1000).reason == cpp_box::arm::Stop_Reason::Exited);
+  REQUIRE(history.checkpoint_count() == 15);
+  REQUIRE(history.memory_used() == 15 * sizeof(Paged_System) + 3 * page_size);
+
+  // dropping checkpoints lets go of the stack page once nothing references it
+  REQUIRE(history.step_back(system));
+  history.seek(system, 4);
+  REQUIRE(history.checkpoint_count() == 5);
+  REQUIRE(history.memory_used() == 5 * sizeof(Paged_System) + 2 * page_size);
+
+  // thinned out to fit the budget, still counting shared pages once
+  cpp_box::arm::Rewind_History<Paged_System> small{ 4 * sizeof(Paged_System) + 3 * page_size, 1 };
+  system = Paged_System{ program };
+  system.setup_run(0);
+  small.reset(system);
+  REQUIRE(small.run_for(system, 1000).reason == cpp_box::arm::Stop_Reason::Exited);
+  REQUIRE(small.memory_used() <= 4 * sizeof(Paged_System) + 3 * page_size);
+  REQUIRE(small.memory_used() == small.checkpoint_count() * sizeof(Paged_System) + 3 * page_size);
+}
+
+TEST_CASE("Test MMIO record and replay")
+{
+  // 0: e3a01000  mov r1, #0
+  // 4: e5910010  ldr r0, [r1, #16]
+  // 8: e5d12010  ldrb r2, [r1, #16]
+  // c: e0200002  eor r0, r0, r2
+  // 10: e1a0f00e  mov pc, lr
+  const std::array<std::uint8_t, 20> program{ 0x00, 0x10, 0xa0, 0xe3, 0x10, 0x00, 0x91, 0xe5, 0x10, 0x20,
+                                              0xd1, 0xe5, 0x02, 0x00, 0x20, 0xe0, 0x0e, 0xf0, 0xa0, 0xe1 };
+  using MMIO   = cpp_box::system::Recorded_MMIO<cpp_box::system::Random_Device>;
+  using System = cpp_box::arm::System<1024, std::array<std::uint8_t, 1024>, MMIO>;
+
+  const auto run = [&](MMIO mmio) {
+    System system{ program, 0, std::move(mmio) };
+    system.run(0);
+    return system.registers[0];
+  };
+
+  // seeded runs repeat
+  REQUIRE(run(MMIO{ cpp_box::system::Random_Device{ 42 } }) == run(MMIO{ cpp_box::system::Random_Device{ 42 } }));
+
+  const auto log      = std::make_shared<cpp_box::system::MMIO_Log>();
+  const auto recorded = run(MMIO{ cpp_box::system::Random_Device{}, cpp_box::system::MMIO_Mode::Record, log });
+  REQUIRE(log->data.size() == 5);
+
+  // the devices aren't consulted when replaying
+  const MMIO replaying{ cpp_box::system::Random_Device{ 1 }, cpp_box::system::MMIO_Mode::Replay, log };
+  REQUIRE(run(replaying) == recorded);
+
+  // running past the end of the log is reported
+  log->data.resize(4);
+  System system{ program, 0, MMIO{ replaying } };
+  system.run(0);
+  REQUIRE(system.mmio_callback.exhausted());
+}
+
+TEST_CASE("Test watched stores to MMIO")
+{
+  // 0: e3a01000  mov r1, #0
+  // 4: e5810010  str r0, [r1, #16]
+  // 8: e5c10010  strb r0, [r1, #16]
+  // c: e1a0f00e  mov pc, lr
+  const std::array<std::uint8_t, 16> program{ 0x00, 0x10, 0xa0, 0xe3, 0x10, 0x00, 0x81, 0xe5, 0x10, 0x00, 0xc1, 0xe5, 0x0e, 0xf0, 0xa0, 0xe1 };
+  using MMIO = cpp_box::system::Recorded_MMIO<cpp_box::system::Random_Device>;
+  cpp_box::arm::System<1024, std::array<std::uint8_t, 1024>, MMIO, cpp_box::arm::NO_TIMING, cpp_box::arm::Watchpoints<1024>> system{
+    program, 0, MMIO{ cpp_box::system::Random_Device{ 42 }, cpp_box::system::MMIO_Mode::Record, std::make_shared<cpp_box::system::MMIO_Log>() }
+  };
+  system.memory_hooks.stop_on_hit = false;
+  system.memory_hooks.add({ 16, 20, cpp_box::arm::Watch::Write });
+
+  // the old value of the random device isn't read, which would have used up a number
+  REQUIRE(system.run(0).reason == cpp_box::arm::Stop_Reason::Exited);
+  REQUIRE(system.memory_hooks.hits.size() == 2);
+  REQUIRE(system.memory_hooks.hits[0].old_value == 0);
+  REQUIRE(system.memory_hooks.hits[1].old_value == 0);
+  REQUIRE(system.mmio_callback.log->data.empty());
+}
+
+TEST_CASE("Test shared copy-on-write pages")
+{
+  // 0: e3a000e9  mov r0, #233
+  // 4: e1a0f00e  mov pc, lr
+  const std::array<std::uint8_t, 8> program{ 0xe9, 0x00, 0xa0, 0xe3, 0x0e, 0xf0, 0xa0, 0xe1 };
+  const auto image = std::make_shared<const cpp_box::arm::Shared_Image>(std::basic_string_view<std::uint8_t>{ program.data(), program.size() });
+
+  using System = cpp_box::arm::System<8192, cpp_box::arm::Paged_RAM<8192>>;
+  System first{ image, 4096 };
+  System second{ image, 4096 };
+  REQUIRE(first.builtin_ram.private_pages() == 0);
+  REQUIRE(first.builtin_ram.predecoded(4096) != nullptr);
+
+  first.run(4096);
+  REQUIRE(first.registers[0] == 233);
+
+  // writes only ever land in the writer's own copy of the page
+  first.write_word(4096, 0);
+  REQUIRE(first.read_word(4096) == 0);
+  REQUIRE(second.read_word(4096) == 0xe3a000e9);
+  REQUIRE(first.builtin_ram.private_pages() == 1);
+  REQUIRE(second.builtin_ram.private_pages() == 0);
+
+  // and the shared decoding no longer applies to the modified page
+  REQUIRE(first.builtin_ram.predecoded(4096) == nullptr);
+  REQUIRE(second.builtin_ram.predecoded(4096) != nullptr);
+
+  // an image running off the end of RAM is reported like a copied one, whether or not its
+  // pages line up
+  REQUIRE(!first.invalid_memory_write);
+  REQUIRE(System{ image, 8190 }.invalid_memory_write);
+  REQUIRE(System{ image, 8192 }.invalid_memory_write);
+  REQUIRE(cpp_box::arm::System<8192>{ program, 8190 }.invalid_memory_write);
+
+  // and the part past the end has no shared decoding to hand out
+  const std::vector<std::uint8_t> two_pages(8192);
+  System overhanging{ std::make_shared<const cpp_box::arm::Shared_Image>(std::basic_string_view<std::uint8_t>{ two_pages.data(), two_pages.size() }), 4096 };
+  REQUIRE(overhanging.invalid_memory_write);
+  REQUIRE(overhanging.builtin_ram.predecoded(4096) != nullptr);
+  REQUIRE(overhanging.builtin_ram.predecoded(8192) == nullptr);
+}
+
+TEST_CASE("Test lockstep lanes match scalar execution")
+{
+  const auto sweep = [](const auto &program, const std::uint64_t max_instructions) {
+    cpp_box::arm::System<> prototype{ program };
+    prototype.setup_run(0);
+
+    cpp_box::arm::Lockstep_System<cpp_box::arm::System<>, 4> lanes{ prototype };
+    for (std::uint32_t lane = 0; lane < lanes.size(); ++lane) { lanes.lane(lane).registers[0] = lane + 1; }
+    const auto results = lanes.run_for(max_instructions);
+
+    for (std::uint32_t lane = 0; lane < lanes.size(); ++lane) {
+      auto scalar         = prototype;
+      scalar.registers[0] = lane + 1;
+      const auto expected = scalar.run_for(max_instructions);
+
+      REQUIRE(results[lane].reason == expected.reason);
+      REQUIRE(results[lane].instructions == expected.instructions);
+      REQUIRE(lanes.lane(lane).registers == scalar.registers);
+      REQUIRE(lanes.lane(lane).CSPR == scalar.CSPR);
+    }
+
+    return lanes.lockstep_instructions();
+  };
+
+  // 0:  e0801100  add r1, r0, r0, lsl #2
+  // 4:  e22120ff  eor r2, r1, #255
+  // 8:  e0420000  sub r0, r2, r0
+  // c:  e18000a1  orr r0, r0, r1, lsr #1
+  // 10: e1a0f00e  mov pc, lr
+  const std::array<std::uint8_t, 20> straight_line{ 0x00, 0x11, 0x80, 0xe0, 0xff, 0x20, 0x21, 0xe2, 0x00, 0x00, 0x42, 0xe0, 0xa1, 0x00, 0x80, 0xe1, 0x0e, 0xf0, 0xa0, 0xe1 };
+
+  // no branches, so every lane stays in lockstep to the end
+  REQUIRE(sweep(straight_line, 100) == 4 * 5);
+
+  // 0:  e3a01000  mov r1, #0
+  // 4:  e0811000  add r1, r1, r0   <- loop
+  // 8:  e2500001  subs r0, r0, #1
+  // c:  1afffffc  bne loop
+  // 10: e1a00001  mov r0, r1
+  // 14: e1a0f00e  mov pc, lr
+  const std::array<std::uint8_t, 24> loop{ 0x00, 0x10, 0xa0, 0xe3, 0x00, 0x10, 0x81, 0xe0, 0x01, 0x00, 0x50, 0xe2,
+                                           0xfc, 0xff, 0xff, 0x1a, 0x01, 0x00, 0xa0, 0xe1, 0x0e, 0xf0, 0xa0, 0xe1 };
+
+  // every `bne` drops the lane that is done looping, the rest carry on together
+  REQUIRE(sweep(loop, 100) == (4 * 4) + (3 * 3) + (2 * 3) + 2);
+  REQUIRE(sweep(loop, 6) == (4 * 4) + (3 * 2));
+
+  // 0:  e1a01200  lsl r1, r0, #4
+  // 4:  e2812064  add r2, r1, #100
+  // 8:  e92d4006  push {r1, r2, lr}
+  // c:  e0843291  umull r3, r4, r1, r2
+  // 10: e52d3004  push {r3}
+  // 14: e49d5004  pop {r5}
+  // 18: eb000003  bl f
+  // 1c: e8bd4006  pop {r1, r2, lr}
+  // 20: e0850004  add r0, r5, r4
+  // 24: e0800006  add r0, r0, r6
+  // 28: e1a0f00e  mov pc, lr
+  // 2c: e0826001  add r6, r2, r1   <- f
+  // 30: e1a0f00e  mov pc, lr
+  const std::array<std::uint8_t, 52> scalar_instructions{ 0x00, 0x12, 0xa0, 0xe1, 0x64, 0x20, 0x81, 0xe2, 0x06, 0x40, 0x2d, 0xe9, 0x91, 0x32, 0x84, 0xe0,
+                                                          0x04, 0x30, 0x2d, 0xe5, 0x04, 0x50, 0x9d, 0xe4, 0x03, 0x00, 0x00, 0xeb, 0x06, 0x40, 0xbd, 0xe8,
+                                                          0x04, 0x00, 0x85, 0xe0, 0x06, 0x00, 0x80, 0xe0, 0x0e, 0xf0, 0xa0, 0xe1, 0x01, 0x60, 0x82, 0xe0,
+                                                          0x0e, 0xf0, 0xa0, 0xe1 };
+
+  // loads, stores, multiplies and calls run on each lane's own System, which only sees the
+  // registers they use, all lanes stay together and end up exactly where scalar runs do
+  REQUIRE(sweep(scalar_instructions, 100) == 4 * 13);
+  REQUIRE(sweep(scalar_instructions, 5) == 4 * 5);
+}
+
+TEST_CASE("Test differential execution")
+{
+  // the program from "Test breakpoints", which pushes and pops its result at the end
+  std::array<std::uint8_t, 32> program{ 0x03, 0x00, 0xa0, 0xe3, 0x00, 0x10, 0xa0, 0xe3, 0x00, 0x10, 0x81, 0xe0, 0x01, 0x00, 0x50, 0xe2,
+                                        0xfc, 0xff, 0xff, 0x1a, 0x04, 0x10, 0x2d, 0xe5, 0x04, 0x00, 0x9d, 0xe4, 0x0e, 0xf0, 0xa0, 0xe1 };
+  // two pages, so that the stack isn't on the same page as the code that differs
+  using System =
+    cpp_box::arm::System<8192, std::array<std::uint8_t, 8192>, cpp_box::arm::NO_MMIO, cpp_box::arm::NO_TIMING, cpp_box::arm::Dirty_Pages<8192>>;
+  const auto make_system = [](const auto &image) {
+    System system{ image };
+    system.setup_run(0);
+    return system;
+  };
+
+  // engines that agree, compared at block boundaries and every few instructions
+  for (const auto interval : { std::uint64_t{ 0 }, std::uint64_t{ 1 }, std::uint64_t{ 5 } }) {
+    auto reference = make_system(program);
+    cpp_box::arm::Lockstep_Engine<System, 4> candidate{ make_system(program) };
+    cpp_box::arm::Differential differential{ reference, candidate, interval };
+    REQUIRE(!differential.run_for(1000));
+    REQUIRE(differential.instructions() == 14);
+    REQUIRE(candidate.lanes.lane(0).registers[0] == 6);
+  }
+
+  // a candidate that pushes r0 instead of r1
+  auto broken = program;
+  broken[21]  = 0x00;
+
+  // at block boundaries the difference shows up once the function returns, after the loop
+  auto reference = make_system(program);
+  auto candidate = make_system(broken);
+  const auto found = cpp_box::arm::Differential{ reference, candidate, 0 }.run_for(1000);
+  REQUIRE(found);
+  REQUIRE(found->last_match == 8);
+  REQUIRE(found->instructions == 14);
+  REQUIRE(found->pc == 0x1c);
+
+  // starting over from the last match and comparing every instruction finds the push itself
+  reference = make_system(program);
+  candidate = make_system(broken);
+  cpp_box::arm::Differential narrowed{ reference, candidate, 1 };
+  narrowed.skip(found->last_match);
+  const auto first = narrowed.run_for(found->instructions - found->last_match);
+  REQUIRE(first);
+  REQUIRE(first->instructions == 12);
+  REQUIRE(first->pc == 0x14);
+  REQUIRE(first->differences.size() == 1);
+  REQUIRE(first->differences[0].kind == cpp_box::arm::Divergence::Kind::Memory);
+  REQUIRE(first->differences[0].where == 8191 - 4);
+  REQUIRE(first->differences[0].expected == 6);
+  REQUIRE(first->differences[0].actual == 0);
+}
+
+TEST_CASE("Test cores sharing memory")
+{
+  // core 0 starts every other core at `worker`, runs `worker` itself and waits for the others to
+  // finish. `worker` takes a SWP spin lock 250 times, and each time bumps a shared counter and
+  // sets its core's bit in a shared mask
+  //
+  // 0:  e3a05018  mov r5, #24             ; CORE_COUNT
+  // 4:  e5956000  ldr r6, [r5]
+  // 8:  e3a07c01  mov r7, #256            ; CORE_START
+  // c:  e28f804c  add r8, pc, #76         ; worker
+  // 10: e3a09001  mov r9, #1
+  // 14: e1590006  cmp r9, r6              ; start:
+  // 18: aa000002  bge started
+  // 1c: e7878109  str r8, [r7, r9, lsl #2]
+  // 20: e2899001  add r9, r9, #1
+  // 24: eafffffa  b start
+  // 28: e1a0b00e  mov r11, lr             ; started:
+  // 2c: eb00000b  bl worker
+  // 30: e1a0e00b  mov lr, r11
+  // 34: e3a09001  mov r9, #1
+  // 38: e1590006  cmp r9, r6              ; join:
+  // 3c: aa000004  bge joined
+  // 40: e7970109  ldr r0, [r7, r9, lsl #2]
+  // 44: e3500000  cmp r0, #0
+  // 48: 1afffffa  bne join
+  // 4c: e2899001  add r9, r9, #1
+  // 50: eafffff8  b join
+  // 54: e3a01a03  mov r1, #12288          ; joined:
+  // 58: e5910004  ldr r0, [r1, #4]
+  // 5c: e1a0f00e  mov pc, lr
+  // 60: e3a01a03  mov r1, #12288          ; worker:
+  // 64: e3a03001  mov r3, #1
+  // 68: e3a04014  mov r4, #20             ; CORE_ID
+  // 6c: e5944000  ldr r4, [r4]
+  // 70: e3a0a0fa  mov r10, #250
+  // 74: e1010093  swp r0, r3, [r1]        ; lock:
+  // 78: e3500000  cmp r0, #0
+  // 7c: 1afffffc  bne lock
+  // 80: e5910004  ldr r0, [r1, #4]
+  // 84: e2800001  add r0, r0, #1
+  // 88: e5810004  str r0, [r1, #4]
+  // 8c: e5910008  ldr r0, [r1, #8]
+  // 90: e1800413  orr r0, r0, r3, lsl r4
+  // 94: e5810008  str r0, [r1, #8]
+  // 98: e3a00000  mov r0, #0
+  // 9c: e5810000  str r0, [r1]
+  // a0: e25aa001  subs r10, r10, #1
+  // a4: 1afffff2  bne lock
+  // a8: e1a0f00e  mov pc, lr
+  const std::vector<std::uint32_t> words{ 0xe3a05018, 0xe5956000, 0xe3a07c01, 0xe28f804c, 0xe3a09001, 0xe1590006, 0xaa000002, 0xe7878109, 0xe2899001,
+                                          0xeafffffa, 0xe1a0b00e, 0xeb00000b, 0xe1a0e00b, 0xe3a09001, 0xe1590006, 0xaa000004, 0xe7970109, 0xe3500000,
+                                          0x1afffffa, 0xe2899001, 0xeafffff8, 0xe3a01a03, 0xe5910004, 0xe1a0f00e, 0xe3a01a03, 0xe3a03001, 0xe3a04014,
+                                          0xe5944000, 0xe3a0a0fa, 0xe1010093, 0xe3500000, 0x1afffffc, 0xe5910004, 0xe2800001, 0xe5810004, 0xe5910008,
+                                          0xe1800413, 0xe5810008, 0xe3a00000, 0xe5810000, 0xe25aa001, 0x1afffff2, 0xe1a0f00e };
+  std::vector<std::uint8_t> image;
+  for (const auto word : words) {
+    for (std::uint32_t byte = 0; byte < 4; ++byte) { image.push_back(static_cast<std::uint8_t>(word >> (byte * 8))); }
+  }
+
+  constexpr std::uint32_t load_address = 0x1000;
+  cpp_box::arm::SMP_System<1024 * 1024 * 4> machine{ image, load_address, 4 };
+  const auto results = machine.run(load_address, 10'000'000);
+
+  for (const auto &result : results) { REQUIRE(result.reason == cpp_box::arm::Stop_Reason::Exited); }
+  REQUIRE(machine.core(0).registers[0] == 4 * 250);
+  REQUIRE(machine.core(0).read_word(0x3008) == 0b1111);
+}
+
+TEST_CASE("Test SMP random devices")
+{
+  // 0: e3a01000  mov r1, #0
+  // 4: e5910010  ldr r0, [r1, #16]
+  // 8: e1a0f00e  mov pc, lr
+  const std::array<std::uint8_t, 12> program{ 0x00, 0x10, 0xa0, 0xe3, 0x10, 0x00, 0x91, 0xe5, 0x0e, 0xf0, 0xa0, 0xe1 };
+
+  // core n gets the seed + n
+  cpp_box::arm::SMP_System<8192> machine{ program, 0, 2, 42 };
+  REQUIRE(machine.core(0).mmio_callback.random.seed == 42);
+  REQUIRE(machine.core(1).mmio_callback.random.seed == 43);
+
+  REQUIRE(machine.run(0, 100)[0].reason == cpp_box::arm::Stop_Reason::Exited);
+  REQUIRE(machine.core(0).registers[0] == std::mt19937{ 42 }());
+}
+
+TEST_CASE("Test shared memory accesses")
+{
+  // every size at every alignment lands on the same bytes as in plain memory
+  using Shared = cpp_box::arm::System<64, cpp_box::arm::Shared_RAM<64>>;
+  using Plain  = cpp_box::arm::System<64>;
+  Shared shared;
+  Plain plain;
+
+  std::uint32_t value = 0x12345678;
+  for (std::uint32_t loc = 0; loc < 60; ++loc) {
+    value            = value * 1664525U + 1013904223U;
+    const auto write = [loc, value](auto &system) {
+      switch (loc % 3) {
+      case 0: system.write_word(loc, value); break;
+      case 1: system.write_half_word(loc, static_cast<std::uint16_t>(value)); break;
+      case 2: system.write_byte(loc, static_cast<std::uint8_t>(value)); break;
+      }
+    };
+    write(shared);
+    write(plain);
+
+    for (std::uint32_t read = 0; read < 60; ++read) {
+      REQUIRE(shared.read_word(read) == plain.read_word(read));
+      REQUIRE(shared.read_half_word(read) == plain.read_half_word(read));
+      REQUIRE(shared.read_byte(read) == plain.read_byte(read));
+    }
+  }
+
+  // a copy is the same memory
+  auto other = shared;
+  other.write_word(5, 0xCAFEF00D);
+  REQUIRE(shared.read_word(5) == 0xCAFEF00D);
+  REQUIRE(shared.exchange_word(5, 1) == 0xCAFEF00D);
+  REQUIRE(other.exchange_byte(5, 2) == 1);
+  REQUIRE(shared.read_word(5) == 2);
+}
+
+TEST_CASE("Test trace ring buffer ordering", "[trace]")
+{
+  // small enough that the producer has to wait for the consumer many times over
+  auto ring = std::make_unique<cpp_box::arm::SPSC_Ring<std::uint32_t, 64, 16>>();
+  constexpr std::uint32_t count = 100'000;
+
+  std::thread producer{ [&ring] {
+    for (std::uint32_t value = 0; value < count; ++value) { ring->push(value); }
+    ring->publish();
+  } };
+
+  std::uint32_t expected = 0;
+  bool in_order          = true;
+  while (expected < count) {
+    ring->drain([&](const std::uint32_t *values, const std::size_t size) {
+      for (std::size_t idx = 0; idx < size; ++idx) { in_order = in_order && values[idx] == expected++; }
+    });
+  }
+
+  producer.join();
+  REQUIRE(in_order);
+  REQUIRE(expected == count);
+}
+
+TEST_CASE("Test trace analysis across chunks", "[trace]")
+{
+  using cpp_box::arm::reg_bit;
+  constexpr auto no_register = cpp_box::arm::Trace_Record::no_register;
+
+  // a loop going round twice, with r1 set before it and only read after it
+  const std::vector<cpp_box::arm::Trace_Record> records{
+    { 0x100, 0xe3a01001, 0, 1, 1, 0, {} },            // mov r1, #1
+    { 0x104, 0xe5932000, 0xFFFF'F004, 0, 2, 1, {} },  // ldr r2, [r3]
+    { 0x108, 0x1afffffd, 0, 0, no_register, 0, {} },  // bne 0x104
+    { 0x104, 0xe5932000, 0x1000, 0, 2, 1, {} },       // ldr r2, [r3]
+    { 0x108, 0x1afffffd, 0, 0, no_register, 0, {} },  // bne 0x104
+    { 0x10c, 0xe0810002, 0, 0, 0, 0, {} },            // add r0, r1, r2
+  };
+
+  const auto analyze = [&records](const std::vector<std::size_t> &splits) {
+    std::vector<cpp_box::arm::Chunk_Stats> chunks;
+    std::size_t begin = 0;
+    for (const auto end : splits) {
+      chunks.push_back(cpp_box::arm::analyze_chunk(records.data(), begin, end, records.size()));
+      begin = end;
+    }
+    return cpp_box::arm::merge_chunks(chunks);
+  };
+
+  const auto whole = analyze({ records.size() });
+  REQUIRE(whole.pcs.at(0x100).live == reg_bit(3));
+  REQUIRE(whole.pcs.at(0x104).live == (reg_bit(1) | reg_bit(3)));
+  REQUIRE(whole.pcs.at(0x10c).live == (reg_bit(1) | reg_bit(2)));
+  REQUIRE(whole.pcs.at(0x104).count == 2);
+  REQUIRE(whole.pcs.at(0x104).lowest_address == 0x1000);
+  REQUIRE(whole.pcs.at(0x104).highest_address == 0xFFFF'F004);
+  REQUIRE(whole.back_edges.size() == 1);
+  REQUIRE(whole.back_edges.at(cpp_box::arm::edge_key(0x104, 0x108)) == 1);
+  REQUIRE(whole.pages == std::map<std::uint32_t, std::uint64_t>{ { 0x1, 1 }, { 0xFFFFF, 1 } });
+
+  // however the trace is cut up, the result is the same
+  for (const auto &splits : std::vector<std::vector<std::size_t>>{ { 1, 6 }, { 2, 6 }, { 3, 6 }, { 4, 6 }, { 5, 6 }, { 1, 2, 3, 4, 5, 6 } }) {
+    const auto split = analyze(splits);
+    REQUIRE(split.pcs.size() == whole.pcs.size());
+    for (const auto &[pc, stats] : whole.pcs) {
+      REQUIRE(split.pcs.at(pc).count == stats.count);
+      REQUIRE(split.pcs.at(pc).memory_accesses == stats.memory_accesses);
+      REQUIRE(split.pcs.at(pc).lowest_address == stats.lowest_address);
+      REQUIRE(split.pcs.at(pc).highest_address == stats.highest_address);
+      REQUIRE(split.pcs.at(pc).live == stats.live);
+    }
+    REQUIRE(split.back_edges == whole.back_edges);
+    REQUIRE(split.pages == whole.pages);
+  }
+}
+
+TEST_CASE("Test trace memory ranges", "[trace]")
+{
+  const auto ranges = cpp_box::arm::memory_ranges({ { 0x1, 2 }, { 0x2, 3 }, { 0x5, 1 }, { 0xFFFFE, 1 }, { 0xFFFFF, 4 } });
+  REQUIRE(ranges.size() == 3);
+  REQUIRE(ranges[0].begin == 0x1000);
+  REQUIRE(ranges[0].end == 0x3000);
+  REQUIRE(ranges[0].accesses == 5);
+  REQUIRE(ranges[1].begin == 0x5000);
+  REQUIRE(ranges[1].end == 0x6000);
+  REQUIRE(ranges[1].accesses == 1);
+
+  // the top page ends past what 32 bits hold
+  REQUIRE(ranges[2].begin == 0xFFFF'E000);
+  REQUIRE(ranges[2].end == 0x1'0000'0000);
+  REQUIRE(ranges[2].accesses == 5);
+}
+
+TEST_CASE("Test symbol lookup")
+{
+  // "a" has no size so it runs up to "b", and "c" being last has nothing to run up to
+  const cpp_box::Symbol_Table symbols{ { { "b", 0x200, 0x10 }, { "a", 0x100, 0 }, { "c", 0x300, 0 } } };
+
+  REQUIRE(symbols.lookup(0xFF) == nullptr);
+  REQUIRE(symbols.lookup(0x100)->name == "a");
+  REQUIRE(symbols.lookup(0x1FF)->name == "a");
+  REQUIRE(symbols.lookup(0x200)->name == "b");
+  REQUIRE(symbols.lookup(0x20F)->name == "b");
+  REQUIRE(symbols.lookup(0x210) == nullptr);
+  REQUIRE(symbols.lookup(0x300) == nullptr);
+
+  REQUIRE(symbols.describe(0x204) == "b+0x4");
+  REQUIRE(symbols.describe(0x210) == "0x00000210");
+}
+
+TEST_CASE("Test sampling profile reports")
+{
+  const cpp_box::Symbol_Table symbols{ { { "main", 0x100, 0x100 }, { "work", 0x200, 0x100 }, { "leaf", 0x300, 0x100 } } };
+
+  cpp_box::Sampling_Profile profile;
+  profile.add_sample({ 0x310, 0x210, 0x110 });
+  profile.add_sample({ 0x320, 0x220, 0x120 });
+  profile.add_sample({ 0x320, 0x220, 0x120 });
+  profile.add_sample({ 0x210, 0x250, 0x110 });  // work calling itself
+  profile.add_sample({ 0x900 });
+  profile.add_sample({ 0x950 });
+  REQUIRE(profile.sample_count() == 6);
+
+  // outermost first, with the addresses within each function merged
+  std::ostringstream collapsed;
+  profile.write_collapsed(collapsed, symbols);
+  REQUIRE(collapsed.str() == "0x00000900 1\n0x00000950 1\nmain;work;leaf 3\nmain;work;work 1\n");
+
+  const auto top = profile.top_functions(symbols, 10);
+  REQUIRE(top.size() == 5);
+  REQUIRE(top[0].name == "leaf");
+  REQUIRE(top[0].self == 3);
+  REQUIRE(top[0].total == 3);
+  // the recursive sample counts once towards its total
+  REQUIRE(top[1].name == "work");
+  REQUIRE(top[1].self == 1);
+  REQUIRE(top[1].total == 4);
+  // exactly tied, so in name order
+  REQUIRE(top[2].name == "0x00000900");
+  REQUIRE(top[3].name == "0x00000950");
+  REQUIRE(top[4].name == "main");
+  REQUIRE(top[4].self == 0);
+  REQUIRE(top[4].total == 4);
+
+  const auto top_two = profile.top_functions(symbols, 2);
+  REQUIRE(top_two.size() == 2);
+  REQUIRE(top_two[0].name == "leaf");
+  REQUIRE(top_two[1].name == "work");
+}
+
+TEST_CASE("Test stack unwinding")
+{
+  // six functions 0x40 bytes apart, then .ARM.exidx at 0x180 and .ARM.extab at 0x1c0
+  std::vector<std::uint8_t> image(0x200);
+  const auto put = [&image](const std::uint32_t loc, const std::uint32_t value) {
+    for (std::uint32_t byte = 0; byte < 4; ++byte) { image[loc + byte] = static_cast<std::uint8_t>(value >> (byte * 8)); }
+  };
+  const auto prel31 = [](const std::uint32_t target, const std::uint32_t place) { return (target - place) & 0x7FFF'FFFF; };
+  const auto entry  = [&](const std::uint32_t index, const std::uint32_t details) {
+    put(0x180 + index * 8, prel31(index * 0x40, 0x180 + index * 8));
+    put(0x180 + index * 8 + 4, details);
+  };
+  const auto extab = [&](const std::uint32_t index, const std::uint32_t table, const std::uint32_t first, const std::uint32_t second) {
+    entry(index, prel31(table, 0x180 + index * 8 + 4));
+    put(table, first);
+    put(table + 4, second);
+  };
+
+  entry(0, 0x80A8'B0B0);                         // pop {r4, r14}
+  entry(1, 0x8088'08B0);                         // pop {r7, r15}
+  extab(2, 0x1C0, 0x8101'B103, 0x0084'00B0);     // pop {r0, r1}, vsp += 4, pop {r14}
+  extab(3, 0x1C8, 0x8101'B201, 0x8400'B0B0);     // vsp += 0x208, pop {r14}
+  extab(4, 0x1D0, 0x8101'B301, 0xC801'8400);     // pop {d0-d1} with FSTMFDX, pop {d0-d1}, pop {r14}
+  entry(5, 1);                                   // EXIDX_CANTUNWIND
+
+  cpp_box::arm::System<4096> system{};
+  system.PC() = 0x010 + 4;
+  system.SP() = 0x800;
+  system.write_word(0x804, 0x054);  // saved r14
+  system.write_word(0x80C, 0x094);  // saved r15
+  system.write_word(0x81C, 0x0D4);
+  system.write_word(0xA28, 0x114);
+  system.write_word(0xA50, 0x154);
+
+  const cpp_box::Unwinder tables{ { image.data(), image.size() }, 0, 0x180, 6 * 8, cpp_box::Unwinder::Method::Tables };
+  REQUIRE(tables.has_tables());
+  std::vector<std::uint32_t> stack;
+  tables.unwind(system, stack);
+  REQUIRE(stack == std::vector<std::uint32_t>{ 0x010, 0x050, 0x090, 0x0D0, 0x110, 0x150 });
+
+  // "refuse to unwind" ends the walk in the function it's found in
+  entry(1, 0x8080'00B0);
+  const cpp_box::Unwinder refusing{ { image.data(), image.size() }, 0, 0x180, 6 * 8, cpp_box::Unwinder::Method::Tables };
+  refusing.unwind(system, stack);
+  REQUIRE(stack == std::vector<std::uint32_t>{ 0x010, 0x050 });
+
+  // r11 points at the caller's r11, with the return address after it, until one leaves the code
+  system.registers[11] = 0x900;
+  system.write_word(0x900, 0x920);
+  system.write_word(0x904, 0x054);
+  system.write_word(0x920, 0x940);
+  system.write_word(0x924, 0x094);
+  system.write_word(0x940, 0x960);
+  system.write_word(0x944, 0x500);
+  const cpp_box::Unwinder frame_pointers{ { image.data(), image.size() }, 0, 0, 0, cpp_box::Unwinder::Method::Frame_Pointer };
+  REQUIRE(!frame_pointers.has_tables());
+  frame_pointers.unwind(system, stack);
+  REQUIRE(stack == std::vector<std::uint32_t>{ 0x010, 0x050, 0x090 });
+
+  // a frame that points back down the stack ends the walk too
+  system.write_word(0x920, 0x900);
+  system.write_word(0x924, 0x094);
+  frame_pointers.unwind(system, stack);
+  REQUIRE(stack == std::vector<std::uint32_t>{ 0x010, 0x050, 0x090 });
+}